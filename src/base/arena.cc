@@ -0,0 +1,113 @@
+#include "base/arena.h"
+
+#include <cstdint>
+
+#include <glog/logging.h>
+
+using namespace std;
+
+namespace {
+
+thread_local Arena* currentArena = nullptr;
+thread_local int arenaScopeDepth = 0;
+
+char* alignUp(char* p, size_t alignment)
+{
+    uintptr_t x = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((x + alignment - 1) & ~(alignment - 1));
+}
+
+} // anonymous namespace
+
+const size_t Arena::DEFAULT_BLOCK_SIZE;
+const size_t Arena::MAX_FREE_LARGE_BLOCKS;
+
+Arena::Arena(size_t blockSize) :
+    blockSize_(blockSize),
+    currentBlockIndex_(0),
+    ptr_(nullptr),
+    end_(nullptr)
+{
+}
+
+Arena::~Arena()
+{
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+    DCHECK_EQ(0U, alignment & (alignment - 1)) << "alignment should be a power of 2";
+
+    char* p = alignUp(ptr_, alignment);
+    if (ptr_ && p + size <= end_) {
+        ptr_ = p + size;
+        return p;
+    }
+
+    if (size + alignment > blockSize_)
+        return allocateLarge(size, alignment);
+
+    // Move to the next block. Reuse the block if we have it already.
+    if (ptr_)
+        ++currentBlockIndex_;
+    if (currentBlockIndex_ == blocks_.size())
+        blocks_.emplace_back(new char[blockSize_]);
+
+    char* block = blocks_[currentBlockIndex_].get();
+    p = alignUp(block, alignment);
+    ptr_ = p + size;
+    end_ = block + blockSize_;
+    return p;
+}
+
+void* Arena::allocateLarge(size_t size, size_t alignment)
+{
+    // Reuse a large block freed by reset() if it's large enough.
+    for (size_t i = 0; i < freeLargeBlocks_.size(); ++i) {
+        if (freeLargeBlocks_[i].size < size + alignment)
+            continue;
+        largeBlocks_.push_back(std::move(freeLargeBlocks_[i]));
+        freeLargeBlocks_.erase(freeLargeBlocks_.begin() + i);
+        return alignUp(largeBlocks_.back().data.get(), alignment);
+    }
+
+    largeBlocks_.push_back(LargeBlock { size + alignment, unique_ptr<char[]>(new char[size + alignment]) });
+    return alignUp(largeBlocks_.back().data.get(), alignment);
+}
+
+void Arena::reset()
+{
+    // Keep only a few large blocks so that an unusually large allocation doesn't stay forever.
+    for (auto& block : largeBlocks_) {
+        if (freeLargeBlocks_.size() < MAX_FREE_LARGE_BLOCKS)
+            freeLargeBlocks_.push_back(std::move(block));
+    }
+    largeBlocks_.clear();
+    currentBlockIndex_ = 0;
+    ptr_ = nullptr;
+    end_ = nullptr;
+}
+
+// static
+Arena* Arena::current()
+{
+    return arenaScopeDepth > 0 ? currentArena : nullptr;
+}
+
+ArenaScope::ArenaScope()
+{
+    if (arenaScopeDepth++ > 0)
+        return;
+
+    // The arena lives until the thread exits, so its blocks are reused by the next scope.
+    static thread_local unique_ptr<Arena> arena(new Arena);
+    currentArena = arena.get();
+}
+
+ArenaScope::~ArenaScope()
+{
+    if (--arenaScopeDepth > 0)
+        return;
+
+    currentArena->reset();
+}
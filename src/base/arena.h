@@ -0,0 +1,108 @@
+#ifndef BASE_ARENA_H_
+#define BASE_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "base/noncopyable.h"
+
+// Arena is a bump allocator. Memory cannot be freed one by one; all the memory
+// is freed at once by reset(). The blocks are kept after reset(), so an arena that
+// is reset and reused doesn't call malloc once it has grown enough.
+class Arena : noncopyable {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~Arena();
+
+    void* allocate(size_t size, size_t alignment);
+    void reset();
+
+    // The number of blocks that have been taken from the global heap.
+    size_t numBlocks() const { return blocks_.size() + largeBlocks_.size() + freeLargeBlocks_.size(); }
+
+    // Returns the arena of the current thread while an ArenaScope is alive in this thread.
+    // Otherwise, returns nullptr.
+    static Arena* current();
+
+private:
+    friend class ArenaScope;
+
+    static const size_t MAX_FREE_LARGE_BLOCKS = 4;
+
+    struct LargeBlock {
+        size_t size;
+        std::unique_ptr<char[]> data;
+    };
+
+    void* allocateLarge(size_t size, size_t alignment);
+
+    const size_t blockSize_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    // Allocations larger than the block size. reset() moves them to |freeLargeBlocks_|
+    // so that the next large allocation can reuse them.
+    std::vector<LargeBlock> largeBlocks_;
+    std::vector<LargeBlock> freeLargeBlocks_;
+    size_t currentBlockIndex_;
+    char* ptr_;
+    char* end_;
+};
+
+// ArenaScope makes the arena of the current thread available with Arena::current().
+// ArenaScope can be nested. When the outermost ArenaScope is destroyed, the arena is reset.
+// So containers allocated in the arena must not outlive the outermost scope.
+class ArenaScope : noncopyable {
+public:
+    ArenaScope();
+    ~ArenaScope();
+};
+
+// ArenaAllocator is an STL allocator that allocates memory from an arena.
+// When no arena is given, it takes the arena of the current ArenaScope. If there is no
+// ArenaScope, it falls back to the global heap. So the same container type can be used
+// both in and out of a scope.
+template<typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator() : arena_(Arena::current()) {}
+    explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& allocator) : arena_(allocator.arena()) {}
+
+    T* allocate(size_t n)
+    {
+        if (arena_)
+            return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        if (!arena_)
+            ::operator delete(p);
+    }
+
+    // A copied container uses the arena of the current scope instead of the original one,
+    // so that a container can be copied out of the scope.
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+    Arena* arena() const { return arena_; }
+
+private:
+    Arena* arena_;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) { return lhs.arena() == rhs.arena(); }
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) { return lhs.arena() != rhs.arena(); }
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // BASE_ARENA_H_
@@ -0,0 +1,90 @@
+#include "base/arena.h"
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(ArenaTest, allocate)
+{
+    Arena arena(1024);
+
+    char* p = static_cast<char*>(arena.allocate(10, 1));
+    char* q = static_cast<char*>(arena.allocate(10, 1));
+    EXPECT_EQ(p + 10, q);
+
+    void* r = arena.allocate(8, 8);
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(r) % 8);
+    EXPECT_EQ(1U, arena.numBlocks());
+
+    // Doesn't fit in the current block.
+    arena.allocate(1000, 1);
+    EXPECT_EQ(2U, arena.numBlocks());
+
+    // Larger than the block size.
+    arena.allocate(4096, 1);
+    EXPECT_EQ(3U, arena.numBlocks());
+}
+
+TEST(ArenaTest, reset)
+{
+    Arena arena(1024);
+
+    void* p = arena.allocate(1000, 1);
+    arena.allocate(1000, 1);
+    void* large = arena.allocate(4096, 1);
+    EXPECT_EQ(3U, arena.numBlocks());
+
+    arena.reset();
+
+    // The blocks are reused after reset().
+    EXPECT_EQ(p, arena.allocate(1000, 1));
+    arena.allocate(1000, 1);
+    EXPECT_EQ(large, arena.allocate(2048, 1));
+    EXPECT_EQ(3U, arena.numBlocks());
+}
+
+TEST(ArenaTest, scope)
+{
+    EXPECT_TRUE(Arena::current() == nullptr);
+
+    {
+        ArenaScope scope;
+        Arena* arena = Arena::current();
+        ASSERT_TRUE(arena != nullptr);
+
+        {
+            ArenaScope nestedScope;
+            EXPECT_EQ(arena, Arena::current());
+        }
+
+        // The nested scope doesn't reset the arena.
+        EXPECT_EQ(arena, Arena::current());
+    }
+
+    EXPECT_TRUE(Arena::current() == nullptr);
+}
+
+TEST(ArenaTest, vector)
+{
+    ArenaVector<int> heapVector;
+    EXPECT_TRUE(heapVector.get_allocator().arena() == nullptr);
+
+    {
+        ArenaScope scope;
+
+        ArenaVector<int> v;
+        EXPECT_EQ(Arena::current(), v.get_allocator().arena());
+        for (int i = 0; i < 1000; ++i)
+            v.push_back(i);
+        for (int i = 0; i < 1000; ++i)
+            EXPECT_EQ(i, v[i]);
+
+        heapVector = v;
+    }
+
+    // The copy made in the scope is still available out of the scope.
+    ASSERT_EQ(1000U, heapVector.size());
+    EXPECT_EQ(999, heapVector.back());
+}
@@ -5,7 +5,12 @@
 #include <x86intrin.h>
 #endif
 
-#ifdef __AVX__
+#include "base/base.h"
+
+// Decomposer256 is available in a PUYOAI_PORTABLE build, too. See base/compiler_specific.h.
+#if defined(__AVX__) || defined(PORTABLE_AVX2_BMI2)
+
+#include <cstdint>
 
 namespace avx {
 
@@ -17,7 +22,127 @@ union Decomposer256 {
     std::uint8_t ui8[32];
 };
 
+#ifdef __AVX2__
+// Parallel bit-wise or operation for each 16 bits.
+// 0001xxxxxxxxxxxx --> 0001111111111111
+inline __m256i mm256_porr_epi16(__m256i x)
+{
+    x = _mm256_or_si256(x, _mm256_srli_epi16(x, 1));
+    x = _mm256_or_si256(x, _mm256_srli_epi16(x, 2));
+    x = _mm256_or_si256(x, _mm256_srli_epi16(x, 4));
+    x = _mm256_or_si256(x, _mm256_srli_epi16(x, 8));
+    return x;
+}
+
+// popcount 16 x 16bits
+inline __m256i mm256_popcnt_epi16(__m256i x)
+{
+    const __m256i mask4 = _mm256_set1_epi8(0x0F);
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+
+    __m256i low = _mm256_and_si256(mask4, x);
+    __m256i high = _mm256_and_si256(mask4, _mm256_srli_epi16(x, 4));
+
+    __m256i lowCount = _mm256_shuffle_epi8(lookup, low);
+    __m256i highCount = _mm256_shuffle_epi8(lookup, high);
+    __m256i count8 = _mm256_add_epi8(lowCount, highCount);
+
+    __m256i count16 = _mm256_add_epi8(count8, _mm256_slli_epi16(count8, 8));
+    return _mm256_srli_epi16(count16, 8);
+}
+#endif // __AVX2__
+
+#ifdef __AVX512BW__
+union Decomposer512 {
+    __m512i m;
+    std::uint64_t ui64[8];
+    std::uint32_t ui32[16];
+    std::uint16_t ui16[32];
+    std::uint8_t ui8[64];
+};
+
+// Same as mm256_porr_epi16, but for 32 x 16bits.
+inline __m512i mm512_porr_epi16(__m512i x)
+{
+    x = _mm512_or_si512(x, _mm512_srli_epi16(x, 1));
+    x = _mm512_or_si512(x, _mm512_srli_epi16(x, 2));
+    x = _mm512_or_si512(x, _mm512_srli_epi16(x, 4));
+    x = _mm512_or_si512(x, _mm512_srli_epi16(x, 8));
+    return x;
+}
+
+// popcount 32 x 16bits
+inline __m512i mm512_popcnt_epi16(__m512i x)
+{
+#ifdef __AVX512BITALG__
+    return _mm512_popcnt_epi16(x);
+#else
+    const __m512i mask4 = _mm512_set1_epi8(0x0F);
+    const __m512i lookup = _mm512_maskz_broadcast_i32x4(0xFFFF,
+        _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+
+    __m512i low = _mm512_and_si512(mask4, x);
+    __m512i high = _mm512_and_si512(mask4, _mm512_srli_epi16(x, 4));
+
+    __m512i lowCount = _mm512_shuffle_epi8(lookup, low);
+    __m512i highCount = _mm512_shuffle_epi8(lookup, high);
+    __m512i count8 = _mm512_add_epi8(lowCount, highCount);
+
+    __m512i count16 = _mm512_add_epi8(count8, _mm512_slli_epi16(count8, 8));
+    return _mm512_srli_epi16(count16, 8);
+#endif
+}
+
+// Same as sse::Compressor16, but for 32 x 16bits.
+class Compressor512 {
+public:
+    explicit Compressor512(__m512i mask) : mask_(mask)
+    {
+        __m512i m = mask;
+        __m512i mk = _mm512_slli_epi16(_mm512_ternarylogic_epi64(m, m, m, 0x55), 1);
+
+        for (int i = 0; i < 4; ++i) {
+            __m512i mp = _mm512_xor_si512(mk, _mm512_slli_epi16(mk, 1));
+            mp = _mm512_xor_si512(mp, _mm512_slli_epi16(mp, 2));
+            mp = _mm512_xor_si512(mp, _mm512_slli_epi16(mp, 4));
+            mp = _mm512_xor_si512(mp, _mm512_slli_epi16(mp, 8));
+
+            __m512i mv = _mm512_and_si512(mp, m);
+            // 0xBE: (m ^ mv) | (mv >> 2^i)
+            m = _mm512_ternarylogic_epi64(m, mv, shiftRight(mv, i), 0xBE);
+            mv_[i] = mv;
+            mk = _mm512_andnot_si512(mp, mk);
+        }
+    }
+
+    __m512i compress(__m512i x) const
+    {
+        x = _mm512_and_si512(x, mask_);
+        for (int i = 0; i < 4; ++i) {
+            __m512i t = _mm512_and_si512(x, mv_[i]);
+            x = _mm512_ternarylogic_epi64(x, t, shiftRight(t, i), 0xBE);
+        }
+        return x;
+    }
+
+private:
+    static __m512i shiftRight(__m512i x, int i)
+    {
+        switch (i) {
+        case 0: return _mm512_srli_epi16(x, 1);
+        case 1: return _mm512_srli_epi16(x, 2);
+        case 2: return _mm512_srli_epi16(x, 4);
+        default: return _mm512_srli_epi16(x, 8);
+        }
+    }
+
+    __m512i mask_;
+    __m512i mv_[4];
+};
+#endif // __AVX512BW__
+
 }
 
-#endif // __AVX__
+#endif // defined(__AVX__) || defined(PORTABLE_AVX2_BMI2)
 #endif // BASE_AVX_H_
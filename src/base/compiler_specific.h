@@ -37,4 +37,16 @@
 #define CLANG_ALWAYS_INLINE
 #endif
 
+// In a PUYOAI_PORTABLE build, the files are compiled only for SSE4.2, and only the functions
+// marked with TARGET_AVX2_BMI2 can use AVX2 and BMI2. Since the other functions, including
+// the inline functions shared with the other files, are not compiled with AVX2, such functions
+// are safe to link. Call them only after checking the CPU (see base/cpu_feature.h).
+// PORTABLE_AVX2_BMI2 is defined when TARGET_AVX2_BMI2 is effective.
+#if defined(PUYOAI_PORTABLE) && defined(COMPILER_GCC_COMPATIBLE)
+#define TARGET_AVX2_BMI2 __attribute__((target("avx2,bmi2")))
+#define PORTABLE_AVX2_BMI2 1
+#else
+#define TARGET_AVX2_BMI2
+#endif
+
 #endif // BASE_COMPILER_SPECIFIC_H_
@@ -0,0 +1,124 @@
+#include "base/cpu_feature.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace {
+
+// Runs CPUID with |leaf|, and stores EAX, EBX, ECX and EDX to |regs|.
+// Returns false if |leaf| is not supported.
+bool cpuid(unsigned int leaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (static_cast<unsigned int>(info[0]) < leaf)
+        return false;
+
+    __cpuidex(info, leaf, 0);
+    for (int i = 0; i < 4; ++i)
+        regs[i] = static_cast<unsigned int>(info[i]);
+    return true;
+#else
+    return __get_cpuid(leaf, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+#endif
+}
+
+bool isSlowPDEP()
+{
+    unsigned int regs[4];
+    if (!cpuid(0, regs))
+        return false;
+
+    // The vendor id is in EBX, EDX and ECX.
+    char vendor[13];
+    memcpy(vendor, &regs[1], 4);
+    memcpy(vendor + 4, &regs[3], 4);
+    memcpy(vendor + 8, &regs[2], 4);
+    vendor[12] = '\0';
+    if (strcmp(vendor, "AuthenticAMD") != 0)
+        return false;
+
+    if (!cpuid(1, regs))
+        return false;
+    unsigned int family = (regs[0] >> 8) & 0xF;
+    if (family == 0xF)
+        family += (regs[0] >> 20) & 0xFF;
+
+    return family < 0x19;
+}
+
+#if defined(_MSC_VER)
+struct CpuId {
+    CpuId()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        int maxId = info[0];
+
+        if (maxId >= 1) {
+            __cpuidex(info, 1, 0);
+            sse41 = (info[2] & (1 << 19)) != 0;
+        }
+        if (maxId >= 7) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+            bmi2 = (info[1] & (1 << 8)) != 0;
+        }
+    }
+
+    bool sse41 = false;
+    bool avx2 = false;
+    bool bmi2 = false;
+};
+
+const CpuId& cpuId()
+{
+    static const CpuId s_cpuId;
+    return s_cpuId;
+}
+#endif
+
+} // anonymous namespace
+
+namespace cpu_feature {
+
+bool hasSSE41()
+{
+#if defined(_MSC_VER)
+    return cpuId().sse41;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+bool hasAVX2()
+{
+#if defined(_MSC_VER)
+    return cpuId().avx2;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool hasBMI2()
+{
+#if defined(_MSC_VER)
+    return cpuId().bmi2;
+#else
+    return __builtin_cpu_supports("bmi2");
+#endif
+}
+
+bool hasSlowPDEP()
+{
+    static const bool s_slow = hasBMI2() && isSlowPDEP();
+    return s_slow;
+}
+
+} // namespace cpu_feature
@@ -0,0 +1,19 @@
+#ifndef BASE_CPU_FEATURE_H_
+#define BASE_CPU_FEATURE_H_
+
+// cpu_feature probes the instruction sets the running CPU supports.
+// Unlike __AVX2__ etc., these are checked at runtime, so they can be used to choose
+// the fastest implementation in a binary that is built for several CPUs.
+namespace cpu_feature {
+
+bool hasSSE41();
+bool hasAVX2();
+bool hasBMI2();
+
+// Returns true if the CPU has BMI2, but PDEP/PEXT are microcoded and slow there,
+// i.e. AMD CPUs before Zen3 (family 19h).
+bool hasSlowPDEP();
+
+}
+
+#endif // BASE_CPU_FEATURE_H_
@@ -0,0 +1,23 @@
+#include "base/cpu_feature.h"
+
+#include <gtest/gtest.h>
+
+TEST(CpuFeatureTest, compiledFeaturesAreAvailable)
+{
+    // This binary is running, so the instruction sets it was compiled with must be available.
+#ifdef __SSE4_1__
+    EXPECT_TRUE(cpu_feature::hasSSE41());
+#endif
+#ifdef __AVX2__
+    EXPECT_TRUE(cpu_feature::hasAVX2());
+#endif
+#ifdef __BMI2__
+    EXPECT_TRUE(cpu_feature::hasBMI2());
+#endif
+}
+
+TEST(CpuFeatureTest, slowPDEP)
+{
+    // Slow PDEP is only reported for CPUs that have PDEP at all.
+    EXPECT_TRUE(!cpu_feature::hasSlowPDEP() || cpu_feature::hasBMI2());
+}
@@ -0,0 +1,50 @@
+#ifndef BASE_DEADLINE_H_
+#define BASE_DEADLINE_H_
+
+#include <atomic>
+#include <limits>
+
+#include "base/noncopyable.h"
+#include "base/time.h"
+
+// Deadline is used to stop a long computation cooperatively.
+// The computation checks isExpired() from time to time, and gives up when it returns true.
+// A deadline expires when currentTime() reaches its time, or when cancel() is called.
+// All the methods can be called from any thread.
+class Deadline : noncopyable {
+public:
+    // Never expires unless cancel() is called.
+    Deadline() : time_(std::numeric_limits<double>::infinity()), expired_(false) {}
+    // Expires at |time| [s]. |time| is compared with currentTime().
+    explicit Deadline(double time) : time_(time), expired_(false) {}
+
+    double time() const { return time_; }
+
+    bool isExpired() const
+    {
+        if (expired_.load(std::memory_order_relaxed))
+            return true;
+        if (time_ == std::numeric_limits<double>::infinity() || currentTime() < time_)
+            return false;
+
+        // Once expired, we don't need to see the clock again.
+        expired_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Returns the time [s] until the deadline. 0 if already expired.
+    double remainingTime() const
+    {
+        if (isExpired())
+            return 0.0;
+        return time_ - currentTime();
+    }
+
+    void cancel() { expired_.store(true, std::memory_order_relaxed); }
+
+private:
+    const double time_;
+    mutable std::atomic<bool> expired_;
+};
+
+#endif // BASE_DEADLINE_H_
@@ -0,0 +1,50 @@
+#include "base/deadline.h"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "base/time.h"
+
+TEST(DeadlineTest, infinite)
+{
+    Deadline deadline;
+    EXPECT_FALSE(deadline.isExpired());
+    EXPECT_LT(1000000.0, deadline.remainingTime());
+
+    deadline.cancel();
+    EXPECT_TRUE(deadline.isExpired());
+    EXPECT_EQ(0.0, deadline.remainingTime());
+}
+
+TEST(DeadlineTest, expired)
+{
+    Deadline deadline(currentTime() - 1.0);
+    EXPECT_TRUE(deadline.isExpired());
+    EXPECT_EQ(0.0, deadline.remainingTime());
+}
+
+TEST(DeadlineTest, notExpiredYet)
+{
+    Deadline deadline(currentTime() + 1000.0);
+    EXPECT_FALSE(deadline.isExpired());
+    EXPECT_LT(0.0, deadline.remainingTime());
+}
+
+TEST(DeadlineTest, expiresLater)
+{
+    Deadline deadline(currentTime() + 0.01);
+    while (!deadline.isExpired())
+        std::this_thread::yield();
+
+    EXPECT_LE(deadline.time(), currentTime());
+}
+
+TEST(DeadlineTest, cancelFromAnotherThread)
+{
+    Deadline deadline(currentTime() + 1000.0);
+    std::thread th([&deadline]() { deadline.cancel(); });
+    th.join();
+
+    EXPECT_TRUE(deadline.isExpired());
+}
@@ -1,24 +1,70 @@
 #include "base/executor.h"
 
+#include <string>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "base/thread_affinity.h"
+#include "base/trace.h"
+#include "base/wait_group.h"
+#include "base/work_stealing_queue.h"
+
 DEFINE_int32(num_threads, 1, "The default number of threads");
+DEFINE_string(executor_affinity, "none",
+              "How the worker threads are pinned to the CPUs: none, compact (fill a socket first) or scatter (spread across sockets)");
+DEFINE_string(executor_cpus, "", "The CPUs the worker threads can use, e.g. 0-3,8. Empty means all");
+DEFINE_string(executor_reserved_cpus, "",
+              "The CPUs the worker threads must not use, e.g. the CPUs for the other AI or the duel server");
 
 using namespace std;
 
+namespace {
+
+// The number of times a thread tries to find a task before sleeping.
+const int MAX_SPIN_COUNT = 64;
+
+}
+
+struct Executor::Worker {
+    Worker(Executor* executor, size_t index) : executor(executor), index(index) {}
+
+    Executor* executor;
+    const size_t index;
+    WorkStealingQueue<Func*> tasks;
+};
+
+namespace {
+
+thread_local void* currentWorkerOfThread = nullptr;
+
+}
+
 // static
 unique_ptr<Executor> Executor::makeDefaultExecutor(bool automaticStart)
 {
-    Executor* executor = new Executor(FLAGS_num_threads);
+    AffinityConfig config;
+    CHECK(parseAffinityPolicy(FLAGS_executor_affinity, &config.policy))
+        << "unknown --executor_affinity: " << FLAGS_executor_affinity;
+    CHECK(parseCpuList(FLAGS_executor_cpus, &config.cpus))
+        << "malformed --executor_cpus: " << FLAGS_executor_cpus;
+    CHECK(parseCpuList(FLAGS_executor_reserved_cpus, &config.reservedCpus))
+        << "malformed --executor_reserved_cpus: " << FLAGS_executor_reserved_cpus;
+
+    vector<vector<int>> workerCpus = assignThreadCpus(CpuTopology::detect(), config, FLAGS_num_threads);
+    Executor* executor = new Executor(FLAGS_num_threads, std::move(workerCpus));
     if (automaticStart)
         executor->start();
 
     return unique_ptr<Executor>(executor);
 }
 
-Executor::Executor(int numThread) :
+Executor::Executor(int numThread, vector<vector<int>> workerCpus) :
     threads_(numThread),
+    workerCpus_(std::move(workerCpus)),
+    numInjectedTasks_(0),
+    numSleepingWorkers_(0),
+    numReadyWorkers_(0),
     shouldStop_(false),
     hasStarted_(false)
 {
@@ -28,6 +74,11 @@ Executor::~Executor()
 {
     if (hasStarted_)
         stop();
+
+    // Tasks that have not been run (e.g. the executor has not been started).
+    Func* f;
+    while ((f = take(nullptr)) != nullptr)
+        delete f;
 }
 
 void Executor::start()
@@ -35,11 +86,29 @@ void Executor::start()
     CHECK(!hasStarted_);
     hasStarted_ = true;
 
+    // Each worker is made in its own thread after the thread is pinned, so that the memory
+    // of the worker (e.g. its task queue) is on the NUMA node the worker runs on.
+    // The workers start running after all the workers are made, since they steal from each other.
+    workers_.resize(threads_.size());
     for (size_t i = 0; i < threads_.size(); ++i) {
-        threads_[i] = thread([this]() {
-                runWorkerLoop();
+        threads_[i] = thread([this, i]() {
+            if (i < workerCpus_.size() && !workerCpus_[i].empty() && !setCurrentThreadAffinity(workerCpus_[i]))
+                LOG(WARNING) << "failed to set the affinity of executor worker " << i;
+
+            Worker* worker = new Worker(this, i);
+            {
+                unique_lock<mutex> lock(mu_);
+                workers_[i].reset(worker);
+                ++numReadyWorkers_;
+                condVar_.notify_all();
+                condVar_.wait(lock, [this]() { return numReadyWorkers_ == workers_.size(); });
+            }
+            runWorkerLoop(worker);
         });
     }
+
+    unique_lock<mutex> lock(mu_);
+    condVar_.wait(lock, [this]() { return numReadyWorkers_ == workers_.size(); });
 }
 
 void Executor::stop()
@@ -47,7 +116,10 @@ void Executor::stop()
     CHECK(hasStarted_);
 
     shouldStop_ = true;
-    condVar_.notify_all();
+    {
+        lock_guard<mutex> lock(mu_);
+        condVar_.notify_all();
+    }
     for (size_t i = 0; i < threads_.size(); ++i) {
         if (threads_[i].joinable()) {
             threads_[i].join();
@@ -58,35 +130,150 @@ void Executor::stop()
 void Executor::submit(Executor::Func f)
 {
     CHECK(f) << "function should be callable";
-
-    unique_lock<mutex> lock(mu_);
-    tasks_.push_back(std::move(f));
-    condVar_.notify_one();
+    push(new Func(std::move(f)));
 }
 
-void Executor::runWorkerLoop()
+void Executor::submit(WaitGroup* wg, Executor::Func f)
 {
-    while (true) {
-        Func f = take();
-        if (!f)
-            break;
+    CHECK(f) << "function should be callable";
 
+    wg->add(1);
+    push(new Func([wg, f]() {
         f();
+        wg->done();
+    }));
+}
+
+void Executor::wait(WaitGroup* wg)
+{
+    Worker* worker = currentWorker();
+
+    int spinCount = 0;
+    TRACE_SCOPE("Executor::wait");
+    while (!wg->isDone()) {
+        if (Func* f = take(worker)) {
+            run(f);
+            spinCount = 0;
+            continue;
+        }
+
+        // The rest of the tasks are running in the other threads.
+        if (++spinCount >= MAX_SPIN_COUNT)
+            break;
+        this_thread::yield();
     }
+
+    wg->waitUntilDone();
 }
 
-Executor::Func Executor::take()
+void Executor::runWorkerLoop(Worker* worker)
 {
-    unique_lock<mutex> lock(mu_);
+    currentWorkerOfThread = worker;
+    Tracer::setThreadName("executor-worker-" + to_string(worker->index));
+
+    int spinCount = 0;
     while (true) {
-        if (!tasks_.empty())
-            break;
+        if (Func* f = take(worker)) {
+            run(f);
+            spinCount = 0;
+            continue;
+        }
+
+        if (++spinCount < MAX_SPIN_COUNT) {
+            this_thread::yield();
+            continue;
+        }
+
+        unique_lock<mutex> lock(mu_);
+        numSleepingWorkers_.fetch_add(1);
+        // Pairs with the fence in push(). Either this worker sees the pushed task,
+        // or push() sees this worker sleeping.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (hasTask()) {
+            numSleepingWorkers_.fetch_sub(1);
+            continue;
+        }
         if (shouldStop_)
-            return Func();
+            break;
         condVar_.wait(lock);
+        numSleepingWorkers_.fetch_sub(1);
+        spinCount = 0;
+    }
+
+    currentWorkerOfThread = nullptr;
+}
+
+void Executor::push(Func* f)
+{
+    if (Worker* worker = currentWorker()) {
+        worker->tasks.push(f);
+    } else {
+        lock_guard<mutex> lock(injectedMu_);
+        injectedTasks_.push_back(f);
+        numInjectedTasks_.fetch_add(1, memory_order_relaxed);
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (numSleepingWorkers_.load() > 0) {
+        lock_guard<mutex> lock(mu_);
+        condVar_.notify_one();
+    }
+}
+
+Executor::Func* Executor::take(Worker* worker)
+{
+    Func* f;
+    if (worker && worker->tasks.pop(&f))
+        return f;
+
+    if (numInjectedTasks_.load(memory_order_relaxed) > 0) {
+        lock_guard<mutex> lock(injectedMu_);
+        if (!injectedTasks_.empty()) {
+            f = injectedTasks_.front();
+            injectedTasks_.pop_front();
+            numInjectedTasks_.fetch_sub(1, memory_order_relaxed);
+            return f;
+        }
+    }
+
+    // Steal from the next worker, so that the victims are spread.
+    size_t offset = worker ? worker->index : 0;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker* victim = workers_[(offset + i + 1) % workers_.size()].get();
+        if (victim != worker && victim->tasks.steal(&f))
+            return f;
+    }
+
+    return nullptr;
+}
+
+bool Executor::hasTask()
+{
+    {
+        lock_guard<mutex> lock(injectedMu_);
+        if (!injectedTasks_.empty())
+            return true;
     }
 
-    Func f = std::move(tasks_.front());
-    tasks_.pop_front();
-    return f;
+    for (const auto& worker : workers_) {
+        if (!worker->tasks.empty())
+            return true;
+    }
+
+    return false;
+}
+
+void Executor::run(Func* f)
+{
+    TRACE_SCOPE("Executor::run");
+    unique_ptr<Func> task(f);
+    (*task)();
+}
+
+Executor::Worker* Executor::currentWorker() const
+{
+    Worker* worker = static_cast<Worker*>(currentWorkerOfThread);
+    if (worker && worker->executor == this)
+        return worker;
+    return nullptr;
 }
@@ -5,38 +5,74 @@
 #include <condition_variable>
 #include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
 #include "base/noncopyable.h"
 
+class WaitGroup;
+
 // Executor is an implementation of thread pool.
-// This implementation might have certain overhead. It's not intended to be used for
-// a lot of micro tasks. Please submit coarse tasks.
+// Each worker thread has its own work-stealing queue. A task submitted from a worker thread
+// is pushed to the worker's queue, and idle workers steal tasks from the others.
+// A task submitted from outside goes to a shared queue. So fine-grained tasks submitted from
+// a running task are cheap, while tasks submitted from outside still take a lock.
 class Executor : noncopyable {
 public:
     typedef std::function<void (void)> Func;
 
     static std::unique_ptr<Executor> makeDefaultExecutor(bool automaticStart = true);
 
-    explicit Executor(int numThread);
+    // |workerCpus[i]| is the CPU set the i-th worker is pinned to. See base/thread_affinity.h.
+    // The worker is not pinned if it's empty or not given.
+    explicit Executor(int numThread, std::vector<std::vector<int>> workerCpus = std::vector<std::vector<int>>());
     ~Executor();
 
     void start();
+    // Runs all the submitted tasks, and stops the worker threads.
     void stop();
 
     void submit(Func);
+    // Submits a task as a part of |wg|. wg->done() is called after the task has run.
+    void submit(WaitGroup* wg, Func);
+
+    // Waits until |wg| is done. The caller runs the submitted tasks while waiting,
+    // so a running task can submit subtasks and wait for them (nested fork/join).
+    void wait(WaitGroup* wg);
 
 private:
-    void runWorkerLoop();
-    Func take();
+    struct Worker;
+
+    void runWorkerLoop(Worker*);
+    void push(Func*);
+    // |worker| can be nullptr when called from a thread that is not a worker of this executor.
+    Func* take(Worker* worker);
+    bool hasTask();
+    void run(Func*);
+
+    Worker* currentWorker() const;
 
+    // Made in start(). Each worker is made in its own thread.
+    std::vector<std::unique_ptr<Worker>> workers_;
     std::vector<std::thread> threads_;
+    std::vector<std::vector<int>> workerCpus_;
+
+    // Tasks submitted from non-worker threads.
+    std::mutex injectedMu_;
+    std::deque<Func*> injectedTasks_;
+    // The size of injectedTasks_. Used to skip taking injectedMu_ when it's empty.
+    std::atomic<int> numInjectedTasks_;
+
+    // Idle workers wait on condVar_.
     std::mutex mu_;
     std::condition_variable condVar_;
+    std::atomic<int> numSleepingWorkers_;
+    // The number of workers made in start(). Guarded by mu_.
+    size_t numReadyWorkers_;
+
     std::atomic<bool> shouldStop_;
-    std::deque<Func> tasks_;
     bool hasStarted_;
 };
 
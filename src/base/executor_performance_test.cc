@@ -0,0 +1,68 @@
+#include "base/executor.h"
+
+#include <atomic>
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "base/time.h"
+#include "base/wait_group.h"
+
+using namespace std;
+
+namespace {
+
+const int N = 1000000;
+
+void showOverhead(const char* name, double beginTime, double endTime)
+{
+    cout << name << ": " << (endTime - beginTime) / N * 1e9 << " [ns/task]" << endl;
+}
+
+} // anonymous namespace
+
+// Tasks are submitted from outside of the executor. They go through the shared queue.
+TEST(ExecutorPerformanceTest, submitFromOutside)
+{
+    Executor executor(4);
+    executor.start();
+
+    atomic<int> count(0);
+    WaitGroup wg;
+
+    double beginTime = currentTime();
+    for (int i = 0; i < N; ++i)
+        executor.submit(&wg, [&count]() { count.fetch_add(1, memory_order_relaxed); });
+    executor.wait(&wg);
+    double endTime = currentTime();
+
+    EXPECT_EQ(N, count);
+    showOverhead("submit from outside", beginTime, endTime);
+}
+
+// Tasks are submitted from a running task. They go through the work-stealing queue.
+TEST(ExecutorPerformanceTest, submitFromTask)
+{
+    const int NUM_PARENTS = 100;
+
+    Executor executor(4);
+    executor.start();
+
+    atomic<int> count(0);
+    WaitGroup wg;
+
+    double beginTime = currentTime();
+    for (int i = 0; i < NUM_PARENTS; ++i) {
+        executor.submit(&wg, [&executor, &count]() {
+            WaitGroup childrenWg;
+            for (int j = 0; j < N / NUM_PARENTS; ++j)
+                executor.submit(&childrenWg, [&count]() { count.fetch_add(1, memory_order_relaxed); });
+            executor.wait(&childrenWg);
+        });
+    }
+    executor.wait(&wg);
+    double endTime = currentTime();
+
+    EXPECT_EQ(N, count);
+    showOverhead("submit from task", beginTime, endTime);
+}
@@ -0,0 +1,103 @@
+#include "base/executor.h"
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+
+#include "base/thread_affinity.h"
+#include "base/wait_group.h"
+
+using namespace std;
+
+namespace {
+
+int fib(Executor* executor, int n)
+{
+    if (n < 2)
+        return n;
+
+    // Fork a subtask, and join it.
+    int x;
+    WaitGroup wg;
+    executor->submit(&wg, [executor, n, &x]() { x = fib(executor, n - 1); });
+    int y = fib(executor, n - 2);
+    executor->wait(&wg);
+
+    return x + y;
+}
+
+} // anonymous namespace
+
+TEST(ExecutorTest, submit)
+{
+    const int N = 1000;
+    atomic<int> count(0);
+
+    Executor executor(4);
+    executor.start();
+    for (int i = 0; i < N; ++i)
+        executor.submit([&count]() { ++count; });
+    executor.stop();
+
+    EXPECT_EQ(N, count);
+}
+
+TEST(ExecutorTest, submitWithWaitGroup)
+{
+    const int N = 1000;
+    atomic<int> count(0);
+
+    Executor executor(4);
+    executor.start();
+
+    WaitGroup wg;
+    for (int i = 0; i < N; ++i)
+        executor.submit(&wg, [&count]() { ++count; });
+    executor.wait(&wg);
+
+    EXPECT_EQ(N, count);
+}
+
+TEST(ExecutorTest, nestedForkJoin)
+{
+    for (int numThreads : { 1, 4 }) {
+        Executor executor(numThreads);
+        executor.start();
+
+        int result = 0;
+        WaitGroup wg;
+        executor.submit(&wg, [&executor, &result]() { result = fib(&executor, 20); });
+        executor.wait(&wg);
+
+        EXPECT_EQ(6765, result);
+    }
+}
+
+TEST(ExecutorTest, waitRunsTasksInCaller)
+{
+    // No worker thread is running. wait() should run the tasks by itself.
+    Executor executor(2);
+
+    int count = 0;
+    WaitGroup wg;
+    for (int i = 0; i < 10; ++i)
+        executor.submit(&wg, [&count]() { ++count; });
+    executor.wait(&wg);
+
+    EXPECT_EQ(10, count);
+}
+
+TEST(ExecutorTest, pinnedWorkers)
+{
+    AffinityConfig config;
+    config.policy = AffinityPolicy::COMPACT;
+    Executor executor(4, assignThreadCpus(CpuTopology::detect(), config, 4));
+    executor.start();
+
+    int result = 0;
+    WaitGroup wg;
+    executor.submit(&wg, [&executor, &result]() { result = fib(&executor, 20); });
+    executor.wait(&wg);
+
+    EXPECT_EQ(6765, result);
+}
@@ -0,0 +1,249 @@
+#ifndef BASE_SPSC_QUEUE_H_
+#define BASE_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(OS_WIN)
+#include <malloc.h>
+#endif
+
+#include "base/base.h"
+#include "base/noncopyable.h"
+
+namespace base {
+
+// SPSCQueue is a bounded lock-free queue for a single producer and a single consumer.
+// Only one thread can push, and only one thread can take. tryPush() and tryTake() never
+// block and never take a lock. The blocking methods spin for a while, and then park the
+// thread on a condition variable. The lock is taken only when a thread is parked.
+template<typename T>
+class SPSCQueue : noncopyable {
+public:
+    // |capacity| is rounded up to a power of two.
+    explicit SPSCQueue(size_t capacity);
+
+    // Before C++17, the global operator new ignores alignas(64) of the members below.
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
+    size_t capacity() const { return mask_ + 1; }
+    // These might not be accurate when the other thread is operating on this queue.
+    bool empty() const { return size() == 0; }
+    size_t size() const;
+
+    // Producer only. Returns false if the queue is full.
+    bool tryPush(T&& v);
+    bool tryPush(const T& v) { return tryPush(T(v)); }
+    // Producer only. Waits while the queue is full.
+    void push(T&& v);
+    void push(const T& v) { push(T(v)); }
+    // Producer only. Returns true if succeeded, false if timeout. |v| is moved only when succeeded.
+    bool pushWithTimeout(const std::chrono::steady_clock::time_point& timeout, T&& v);
+
+    // Consumer only. Returns false if the queue is empty.
+    bool tryTake(T* v);
+    // Consumer only. Waits while the queue is empty.
+    T take();
+    // Consumer only. Returns true if succeeded, false if timeout.
+    bool takeWithTimeout(const std::chrono::steady_clock::time_point& timeout, T* v);
+
+private:
+    // Parker lets a thread wait until a condition holds. The waiting thread spins first,
+    // and then sleeps. notify() takes a lock only when the other thread is sleeping.
+    class Parker {
+    public:
+        Parker() : parked_(false) {}
+
+        template<typename Predicate>
+        bool waitUntil(const std::chrono::steady_clock::time_point& timeout, Predicate pred);
+        void notify();
+
+    private:
+        std::mutex mu_;
+        std::condition_variable condVar_;
+        std::atomic<bool> parked_;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t);
+
+    const size_t mask_;
+    std::vector<T> slots_;
+
+    // The consumer's index and the producer's index are on different cache lines.
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+
+    alignas(64) Parker notEmpty_;
+    Parker notFull_;
+};
+
+template<typename T>
+template<typename Predicate>
+bool SPSCQueue<T>::Parker::waitUntil(const std::chrono::steady_clock::time_point& timeout, Predicate pred)
+{
+    const int MAX_SPIN_COUNT = 100;
+    for (int i = 0; i < MAX_SPIN_COUNT; ++i) {
+        if (pred())
+            return true;
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(mu_);
+    parked_.store(true);
+    // Pairs with the fence in notify(). Either we see the change here, or notify() sees us parked.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool result = condVar_.wait_until(lock, timeout, pred);
+    parked_.store(false, std::memory_order_relaxed);
+    return result;
+}
+
+template<typename T>
+void SPSCQueue<T>::Parker::notify()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!parked_.load(std::memory_order_relaxed))
+        return;
+
+    std::lock_guard<std::mutex> lock(mu_);
+    condVar_.notify_one();
+}
+
+// static
+template<typename T>
+size_t SPSCQueue<T>::roundUpToPowerOfTwo(size_t n)
+{
+    size_t x = 1;
+    while (x < n)
+        x *= 2;
+    return x;
+}
+
+template<typename T>
+SPSCQueue<T>::SPSCQueue(size_t capacity) :
+    mask_(roundUpToPowerOfTwo(capacity) - 1),
+    slots_(mask_ + 1),
+    head_(0),
+    tail_(0)
+{
+}
+
+// static
+template<typename T>
+void* SPSCQueue<T>::operator new(size_t size)
+{
+#if defined(OS_WIN)
+    void* p = _aligned_malloc(size, alignof(SPSCQueue));
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, alignof(SPSCQueue), size) != 0)
+        p = nullptr;
+#endif
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+// static
+template<typename T>
+void SPSCQueue<T>::operator delete(void* p)
+{
+#if defined(OS_WIN)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+template<typename T>
+size_t SPSCQueue<T>::size() const
+{
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+}
+
+template<typename T>
+bool SPSCQueue<T>::tryPush(T&& v)
+{
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_)
+        return false;
+
+    slots_[tail & mask_] = std::move(v);
+    tail_.store(tail + 1, std::memory_order_release);
+    notEmpty_.notify();
+    return true;
+}
+
+template<typename T>
+void SPSCQueue<T>::push(T&& v)
+{
+    bool pushed = pushWithTimeout(std::chrono::steady_clock::time_point::max(), std::move(v));
+    (void)pushed;
+}
+
+template<typename T>
+bool SPSCQueue<T>::pushWithTimeout(const std::chrono::steady_clock::time_point& timeout, T&& v)
+{
+    if (tryPush(std::move(v)))
+        return true;
+
+    bool ready = notFull_.waitUntil(timeout, [this]() {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) <= mask_;
+    });
+    if (!ready)
+        return false;
+
+    // Only this thread pushes, so the queue is still not full.
+    return tryPush(std::move(v));
+}
+
+template<typename T>
+bool SPSCQueue<T>::tryTake(T* v)
+{
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+        return false;
+
+    *v = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    notFull_.notify();
+    return true;
+}
+
+template<typename T>
+T SPSCQueue<T>::take()
+{
+    T v;
+    bool taken = takeWithTimeout(std::chrono::steady_clock::time_point::max(), &v);
+    (void)taken;
+    return v;
+}
+
+template<typename T>
+bool SPSCQueue<T>::takeWithTimeout(const std::chrono::steady_clock::time_point& timeout, T* v)
+{
+    if (tryTake(v))
+        return true;
+
+    bool ready = notEmpty_.waitUntil(timeout, [this]() {
+        return head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_acquire);
+    });
+    if (!ready)
+        return false;
+
+    // Only this thread takes, so the queue is still not empty.
+    return tryTake(v);
+}
+
+} // namespace base
+
+#endif // BASE_SPSC_QUEUE_H_
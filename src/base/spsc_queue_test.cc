@@ -0,0 +1,97 @@
+#include "base/spsc_queue.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(SPSCQueueTest, basic)
+{
+    base::SPSCQueue<int> q(3);
+    EXPECT_EQ(4U, q.capacity());
+    EXPECT_TRUE(q.empty());
+
+    EXPECT_TRUE(q.tryPush(1));
+    EXPECT_TRUE(q.tryPush(2));
+    EXPECT_TRUE(q.tryPush(3));
+    EXPECT_TRUE(q.tryPush(4));
+    EXPECT_FALSE(q.tryPush(5));
+    EXPECT_EQ(4U, q.size());
+
+    int v;
+    EXPECT_TRUE(q.tryTake(&v));
+    EXPECT_EQ(1, v);
+    EXPECT_TRUE(q.tryPush(5));
+
+    for (int i = 2; i <= 5; ++i) {
+        EXPECT_TRUE(q.tryTake(&v));
+        EXPECT_EQ(i, v);
+    }
+    EXPECT_TRUE(q.empty());
+    EXPECT_FALSE(q.tryTake(&v));
+}
+
+TEST(SPSCQueueTest, movable)
+{
+    base::SPSCQueue<string> q(2);
+    q.push(string("foo"));
+    EXPECT_EQ("foo", q.take());
+}
+
+TEST(SPSCQueueTest, takeWithTimeout)
+{
+    base::SPSCQueue<int> q(2);
+
+    int v;
+    EXPECT_FALSE(q.takeWithTimeout(chrono::steady_clock::now() + chrono::milliseconds(10), &v));
+
+    q.push(3);
+    EXPECT_TRUE(q.takeWithTimeout(chrono::steady_clock::now() + chrono::milliseconds(10), &v));
+    EXPECT_EQ(3, v);
+}
+
+TEST(SPSCQueueTest, pushWithTimeout)
+{
+    base::SPSCQueue<string> q(1);
+
+    string foo("foo");
+    EXPECT_TRUE(q.pushWithTimeout(chrono::steady_clock::now() + chrono::milliseconds(10), std::move(foo)));
+
+    // |bar| is not moved when the push fails.
+    string bar("bar");
+    EXPECT_FALSE(q.pushWithTimeout(chrono::steady_clock::now() + chrono::milliseconds(10), std::move(bar)));
+    EXPECT_EQ("bar", bar);
+
+    EXPECT_EQ("foo", q.take());
+    EXPECT_TRUE(q.pushWithTimeout(chrono::steady_clock::now() + chrono::milliseconds(10), std::move(bar)));
+    EXPECT_EQ("bar", q.take());
+}
+
+TEST(SPSCQueueTest, alignedNew)
+{
+    unique_ptr<base::SPSCQueue<int>> q(new base::SPSCQueue<int>(2));
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(q.get()) % alignof(base::SPSCQueue<int>));
+}
+
+TEST(SPSCQueueTest, multiThread)
+{
+    const int N = 100000;
+    // The capacity is small so that both the producer and the consumer wait.
+    base::SPSCQueue<int> q(4);
+
+    thread producer([&q]() {
+        for (int i = 0; i < N; ++i)
+            q.push(i);
+    });
+
+    for (int i = 0; i < N; ++i)
+        EXPECT_EQ(i, q.take());
+
+    producer.join();
+    EXPECT_TRUE(q.empty());
+}
@@ -92,6 +92,61 @@ inline __m128i mm_popcnt_epi16(__m128i x)
     return _mm_srli_epi16(count16, 8);
 }
 
+// Compressor16 emulates PEXT for each 16 bits without BMI2.
+// For each 16 bits, compress(x) packs the bits of x where |mask| is 1 to the LSB side.
+//
+// The algorithm is the one in Hacker's Delight 7-4. Computing the masks is not cheap,
+// but once they're computed, compress() takes only 4 steps of shift and or.
+// So compressing several values with the same mask is fast.
+class Compressor16 {
+public:
+    explicit Compressor16(__m128i mask) : mask_(mask)
+    {
+        __m128i m = mask;
+        // mk: 1 where the number of 0s on the right side should be counted.
+        __m128i mk = _mm_slli_epi16(mm_not_si128(m), 1);
+
+        for (int i = 0; i < 4; ++i) {
+            // Parallel suffix: mp is 1 where an odd number of mk bits are on the right side.
+            __m128i mp = _mm_xor_si128(mk, _mm_slli_epi16(mk, 1));
+            mp = _mm_xor_si128(mp, _mm_slli_epi16(mp, 2));
+            mp = _mm_xor_si128(mp, _mm_slli_epi16(mp, 4));
+            mp = _mm_xor_si128(mp, _mm_slli_epi16(mp, 8));
+
+            // mv: the bits to be moved by 2^i.
+            __m128i mv = _mm_and_si128(mp, m);
+            m = _mm_or_si128(_mm_xor_si128(m, mv), shiftRight(mv, i));
+            mv_[i] = mv;
+            mk = _mm_andnot_si128(mp, mk);
+        }
+    }
+
+    __m128i compress(__m128i x) const
+    {
+        x = _mm_and_si128(x, mask_);
+        for (int i = 0; i < 4; ++i) {
+            __m128i t = _mm_and_si128(x, mv_[i]);
+            x = _mm_or_si128(_mm_xor_si128(x, t), shiftRight(t, i));
+        }
+        return x;
+    }
+
+private:
+    // Returns x >> (1 << i) for each 16 bits.
+    static __m128i shiftRight(__m128i x, int i)
+    {
+        switch (i) {
+        case 0: return _mm_srli_epi16(x, 1);
+        case 1: return _mm_srli_epi16(x, 2);
+        case 2: return _mm_srli_epi16(x, 4);
+        default: return _mm_srli_epi16(x, 8);
+        }
+    }
+
+    __m128i mask_;
+    __m128i mv_[4];
+};
+
 }
 
 #endif // BASE_SSE_H_
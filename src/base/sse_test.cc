@@ -2,6 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <random>
+
+#include "base/bmi.h"
+
 TEST(SSETest, inverseMovemask)
 {
     for (int i = 0; i < 0x10000; ++i) {
@@ -43,3 +47,26 @@ TEST(SSETest, mm_popcnt_epi16)
     EXPECT_EQ(8, result.v[6]);
     EXPECT_EQ(16, result.v[7]);
 }
+
+TEST(SSETest, Compressor16)
+{
+    union X {
+        std::uint16_t v[8];
+        __m128i m;
+    };
+
+    std::mt19937 mt(1);
+    std::uniform_int_distribution<int> dist(0, 0xFFFF);
+
+    for (int i = 0; i < 10000; ++i) {
+        X mask, x, result;
+        for (int j = 0; j < 8; ++j) {
+            mask.v[j] = dist(mt);
+            x.v[j] = dist(mt);
+        }
+
+        result.m = sse::Compressor16(mask.m).compress(x.m);
+        for (int j = 0; j < 8; ++j)
+            EXPECT_EQ(bmi::extractBits(x.v[j], mask.v[j]), result.v[j]);
+    }
+}
@@ -0,0 +1,255 @@
+#include "base/thread_affinity.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <tuple>
+
+#if defined(OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "base/file/file.h"
+#include "base/strings.h"
+
+using namespace std;
+
+namespace {
+
+#if defined(OS_LINUX)
+bool readIntFromFile(const string& filename, int* value)
+{
+    string content;
+    if (!file::readFile(filename, &content))
+        return false;
+
+    content = strings::trim(content);
+    if (!strings::isAllDigits(content))
+        return false;
+
+    *value = atoi(content.c_str());
+    return true;
+}
+
+vector<int> allowedCpus()
+{
+    vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return cpus;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// Returns cpu -> node.
+map<int, int> detectNodes()
+{
+    map<int, int> nodes;
+    for (int node = 0; ; ++node) {
+        string content;
+        if (!file::readFile("/sys/devices/system/node/node" + to_string(node) + "/cpulist", &content))
+            break;
+
+        vector<int> cpus;
+        if (!parseCpuList(strings::trim(content), &cpus))
+            continue;
+        for (int cpu : cpus)
+            nodes[cpu] = node;
+    }
+    return nodes;
+}
+#endif
+
+// The index of |cpu| among the SMT siblings of the same core.
+int smtIndex(const vector<CpuInfo>& cpus, const CpuInfo& cpu)
+{
+    int index = 0;
+    for (const CpuInfo& c : cpus) {
+        if (c.socket == cpu.socket && c.core == cpu.core && c.cpu < cpu.cpu)
+            ++index;
+    }
+    return index;
+}
+
+// The index of the core of |cpu| in its NUMA node.
+int coreIndex(const vector<CpuInfo>& cpus, const CpuInfo& cpu)
+{
+    vector<int> cores;
+    for (const CpuInfo& c : cpus) {
+        if (c.socket == cpu.socket && c.node == cpu.node)
+            cores.push_back(c.core);
+    }
+    sort(cores.begin(), cores.end());
+    cores.erase(unique(cores.begin(), cores.end()), cores.end());
+    return static_cast<int>(lower_bound(cores.begin(), cores.end(), cpu.core) - cores.begin());
+}
+
+// The index of the NUMA node of |cpu| in its socket. A socket can have several nodes
+// when sub-NUMA clustering is enabled.
+int nodeIndex(const vector<CpuInfo>& cpus, const CpuInfo& cpu)
+{
+    vector<int> nodes;
+    for (const CpuInfo& c : cpus) {
+        if (c.socket == cpu.socket)
+            nodes.push_back(c.node);
+    }
+    sort(nodes.begin(), nodes.end());
+    nodes.erase(unique(nodes.begin(), nodes.end()), nodes.end());
+    return static_cast<int>(lower_bound(nodes.begin(), nodes.end(), cpu.node) - nodes.begin());
+}
+
+} // anonymous namespace
+
+// static
+CpuTopology CpuTopology::detect()
+{
+    vector<CpuInfo> cpus;
+
+#if defined(OS_LINUX)
+    map<int, int> nodes = detectNodes();
+    for (int cpu : allowedCpus()) {
+        const string dir = "/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/";
+        CpuInfo info { cpu, cpu, 0, 0 };
+        if (!readIntFromFile(dir + "core_id", &info.core) ||
+            !readIntFromFile(dir + "physical_package_id", &info.socket)) {
+            info.core = cpu;
+            info.socket = 0;
+        }
+        auto it = nodes.find(cpu);
+        if (it != nodes.end())
+            info.node = it->second;
+        cpus.push_back(info);
+    }
+#endif
+
+    if (cpus.empty()) {
+        int n = max(1U, thread::hardware_concurrency());
+        for (int cpu = 0; cpu < n; ++cpu)
+            cpus.push_back(CpuInfo { cpu, cpu, 0, 0 });
+    }
+
+    return CpuTopology(std::move(cpus));
+}
+
+const CpuInfo* CpuTopology::find(int cpu) const
+{
+    for (const CpuInfo& info : cpus_) {
+        if (info.cpu == cpu)
+            return &info;
+    }
+    return nullptr;
+}
+
+bool parseAffinityPolicy(const string& s, AffinityPolicy* policy)
+{
+    if (s == "none") {
+        *policy = AffinityPolicy::NONE;
+        return true;
+    }
+    if (s == "compact") {
+        *policy = AffinityPolicy::COMPACT;
+        return true;
+    }
+    if (s == "scatter") {
+        *policy = AffinityPolicy::SCATTER;
+        return true;
+    }
+    return false;
+}
+
+bool parseCpuList(const string& s, vector<int>* cpus)
+{
+    cpus->clear();
+    if (s.empty())
+        return true;
+
+    for (const string& range : strings::split(s, ',')) {
+        vector<string> bounds = strings::split(range, '-');
+        if (bounds.empty() || bounds.size() > 2)
+            return false;
+        for (const string& bound : bounds) {
+            if (bound.empty() || !strings::isAllDigits(bound))
+                return false;
+        }
+
+        int first = atoi(bounds.front().c_str());
+        int last = atoi(bounds.back().c_str());
+        if (last < first)
+            return false;
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus->push_back(cpu);
+    }
+
+    return true;
+}
+
+vector<vector<int>> assignThreadCpus(const CpuTopology& topology, const AffinityConfig& config, int numThreads)
+{
+    vector<CpuInfo> cpus;
+    for (const CpuInfo& info : topology.cpus()) {
+        if (!config.cpus.empty() && find(config.cpus.begin(), config.cpus.end(), info.cpu) == config.cpus.end())
+            continue;
+        if (find(config.reservedCpus.begin(), config.reservedCpus.end(), info.cpu) != config.reservedCpus.end())
+            continue;
+        cpus.push_back(info);
+    }
+
+    vector<vector<int>> result(numThreads);
+    if (cpus.empty())
+        return result;
+
+    if (config.policy == AffinityPolicy::NONE) {
+        // Not restricted unless some CPUs are specified.
+        if (config.cpus.empty() && config.reservedCpus.empty())
+            return result;
+
+        vector<int> set;
+        for (const CpuInfo& info : cpus)
+            set.push_back(info.cpu);
+        for (auto& s : result)
+            s = set;
+        return result;
+    }
+
+    // Sort the CPUs in the order the threads are assigned to.
+    typedef tuple<int, int, int, int, int> SortKey;
+    vector<pair<SortKey, int>> keys;
+    for (const CpuInfo& info : cpus) {
+        int smt = smtIndex(cpus, info);
+        int core = coreIndex(cpus, info);
+        int node = nodeIndex(cpus, info);
+        SortKey key = config.policy == AffinityPolicy::COMPACT ?
+            make_tuple(info.socket, node, smt, core, info.cpu) :
+            make_tuple(smt, core, node, info.socket, info.cpu);
+        keys.emplace_back(key, info.cpu);
+    }
+    sort(keys.begin(), keys.end());
+
+    for (int i = 0; i < numThreads; ++i)
+        result[i].push_back(keys[i % keys.size()].second);
+    return result;
+}
+
+bool setCurrentThreadAffinity(const vector<int>& cpus)
+{
+#if defined(OS_LINUX)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || CPU_SETSIZE <= cpu)
+            return false;
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
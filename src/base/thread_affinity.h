@@ -0,0 +1,69 @@
+#ifndef BASE_THREAD_AFFINITY_H_
+#define BASE_THREAD_AFFINITY_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// A logical CPU and where it is.
+struct CpuInfo {
+    int cpu;
+    int core;    // The physical core id. Unique only within a socket.
+    int socket;  // The physical package id.
+    int node;    // The NUMA node.
+};
+
+// CpuTopology is the set of the logical CPUs this process can run on.
+class CpuTopology {
+public:
+    // Detects the topology from /sys on Linux. On the other platforms, or when /sys is not
+    // available, all the CPUs are assumed to be on one socket, and every CPU is a core.
+    static CpuTopology detect();
+
+    explicit CpuTopology(std::vector<CpuInfo> cpus) : cpus_(std::move(cpus)) {}
+
+    const std::vector<CpuInfo>& cpus() const { return cpus_; }
+    // Returns nullptr if |cpu| is not in this topology.
+    const CpuInfo* find(int cpu) const;
+
+private:
+    std::vector<CpuInfo> cpus_;
+};
+
+// How the worker threads are placed on the CPUs.
+enum class AffinityPolicy {
+    // The threads are not pinned. They run on any CPU in the CPU set.
+    NONE,
+    // Each thread is pinned to a CPU. The threads are packed into as few sockets and NUMA nodes
+    // as possible. In a node, the physical cores are used first, and then their SMT siblings.
+    COMPACT,
+    // Each thread is pinned to a CPU. The threads are spread across the sockets round-robin,
+    // and then across the NUMA nodes in each socket.
+    SCATTER,
+};
+
+// Parses "none", "compact" or "scatter". Returns false if |s| is none of them.
+bool parseAffinityPolicy(const std::string& s, AffinityPolicy*);
+// Parses a CPU list like "0-3,8,10-11", which is the format of taskset and /sys.
+// An empty string is an empty list. Returns false if |s| is malformed.
+bool parseCpuList(const std::string& s, std::vector<int>*);
+
+struct AffinityConfig {
+    AffinityPolicy policy = AffinityPolicy::NONE;
+    // The CPUs the threads can use. Empty means all the CPUs in the topology.
+    std::vector<int> cpus;
+    // The CPUs the threads must not use, e.g. the CPUs left to the other processes
+    // or to the main thread.
+    std::vector<int> reservedCpus;
+};
+
+// Returns the CPU set of each of |numThreads| threads. An empty set means the thread should
+// not be restricted. When there are more threads than the CPUs, the CPUs are used again.
+std::vector<std::vector<int>> assignThreadCpus(const CpuTopology&, const AffinityConfig&, int numThreads);
+
+// Restricts the current thread to run on |cpus|. Returns false if failed, or if not supported
+// on this platform. Since the memory is allocated on the NUMA node of the CPU that touches it
+// first, the memory a pinned thread allocates and touches is usually on its local node.
+bool setCurrentThreadAffinity(const std::vector<int>& cpus);
+
+#endif // BASE_THREAD_AFFINITY_H_
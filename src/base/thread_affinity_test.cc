@@ -0,0 +1,137 @@
+#include "base/thread_affinity.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+// 2 sockets x 2 cores x 2 SMT threads. CPU n and n + 4 are the siblings, like on Linux.
+CpuTopology makeTopology()
+{
+    return CpuTopology(vector<CpuInfo> {
+        { 0, 0, 0, 0 }, { 1, 1, 0, 0 }, { 2, 0, 1, 1 }, { 3, 1, 1, 1 },
+        { 4, 0, 0, 0 }, { 5, 1, 0, 0 }, { 6, 0, 1, 1 }, { 7, 1, 1, 1 },
+    });
+}
+
+// 2 sockets x 2 NUMA nodes x 2 cores x 2 SMT threads, like sub-NUMA clustering.
+// CPU n and n + 8 are the siblings.
+CpuTopology makeSubNumaTopology()
+{
+    return CpuTopology(vector<CpuInfo> {
+        { 0, 0, 0, 0 }, { 1, 1, 0, 0 }, { 2, 2, 0, 1 }, { 3, 3, 0, 1 },
+        { 4, 0, 1, 2 }, { 5, 1, 1, 2 }, { 6, 2, 1, 3 }, { 7, 3, 1, 3 },
+        { 8, 0, 0, 0 }, { 9, 1, 0, 0 }, { 10, 2, 0, 1 }, { 11, 3, 0, 1 },
+        { 12, 0, 1, 2 }, { 13, 1, 1, 2 }, { 14, 2, 1, 3 }, { 15, 3, 1, 3 },
+    });
+}
+
+vector<int> flatten(const vector<vector<int>>& cpuSets)
+{
+    vector<int> result;
+    for (const auto& cpus : cpuSets) {
+        EXPECT_EQ(1U, cpus.size());
+        result.insert(result.end(), cpus.begin(), cpus.end());
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+TEST(ThreadAffinityTest, parseCpuList)
+{
+    vector<int> cpus;
+    EXPECT_TRUE(parseCpuList("", &cpus));
+    EXPECT_TRUE(cpus.empty());
+
+    EXPECT_TRUE(parseCpuList("0-3,8,10-11", &cpus));
+    EXPECT_EQ((vector<int> { 0, 1, 2, 3, 8, 10, 11 }), cpus);
+
+    EXPECT_FALSE(parseCpuList("3-1", &cpus));
+    EXPECT_FALSE(parseCpuList("1,,2", &cpus));
+    EXPECT_FALSE(parseCpuList("a", &cpus));
+    EXPECT_FALSE(parseCpuList("1-2-3", &cpus));
+}
+
+TEST(ThreadAffinityTest, parseAffinityPolicy)
+{
+    AffinityPolicy policy;
+    EXPECT_TRUE(parseAffinityPolicy("compact", &policy));
+    EXPECT_EQ(AffinityPolicy::COMPACT, policy);
+    EXPECT_TRUE(parseAffinityPolicy("scatter", &policy));
+    EXPECT_EQ(AffinityPolicy::SCATTER, policy);
+    EXPECT_TRUE(parseAffinityPolicy("none", &policy));
+    EXPECT_EQ(AffinityPolicy::NONE, policy);
+    EXPECT_FALSE(parseAffinityPolicy("balanced", &policy));
+}
+
+TEST(ThreadAffinityTest, compact)
+{
+    AffinityConfig config;
+    config.policy = AffinityPolicy::COMPACT;
+
+    // The physical cores of socket 0, their siblings, and then socket 1.
+    EXPECT_EQ((vector<int> { 0, 1, 4, 5, 2, 3, 6, 7, 0 }), flatten(assignThreadCpus(makeTopology(), config, 9)));
+}
+
+TEST(ThreadAffinityTest, scatter)
+{
+    AffinityConfig config;
+    config.policy = AffinityPolicy::SCATTER;
+
+    EXPECT_EQ((vector<int> { 0, 2, 1, 3, 4, 6, 5, 7 }), flatten(assignThreadCpus(makeTopology(), config, 8)));
+}
+
+TEST(ThreadAffinityTest, subNuma)
+{
+    AffinityConfig config;
+
+    // Node 0 is filled before node 1, even though they are on the same socket.
+    config.policy = AffinityPolicy::COMPACT;
+    EXPECT_EQ((vector<int> { 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15 }),
+              flatten(assignThreadCpus(makeSubNumaTopology(), config, 16)));
+
+    // The sockets are used round-robin, and then the nodes in each socket.
+    config.policy = AffinityPolicy::SCATTER;
+    EXPECT_EQ((vector<int> { 0, 4, 2, 6, 1, 5, 3, 7, 8, 12, 10, 14, 9, 13, 11, 15 }),
+              flatten(assignThreadCpus(makeSubNumaTopology(), config, 16)));
+}
+
+TEST(ThreadAffinityTest, cpusAndReservedCpus)
+{
+    AffinityConfig config;
+    config.policy = AffinityPolicy::COMPACT;
+    config.cpus = vector<int> { 0, 1, 2, 3 };
+    config.reservedCpus = vector<int> { 0 };
+
+    EXPECT_EQ((vector<int> { 1, 2, 3 }), flatten(assignThreadCpus(makeTopology(), config, 3)));
+}
+
+TEST(ThreadAffinityTest, none)
+{
+    AffinityConfig config;
+    vector<vector<int>> cpuSets = assignThreadCpus(makeTopology(), config, 2);
+    ASSERT_EQ(2U, cpuSets.size());
+    EXPECT_TRUE(cpuSets[0].empty());
+    EXPECT_TRUE(cpuSets[1].empty());
+
+    // Not pinned, but restricted to the unreserved CPUs.
+    config.reservedCpus = vector<int> { 0, 1, 2, 3 };
+    cpuSets = assignThreadCpus(makeTopology(), config, 2);
+    ASSERT_EQ(2U, cpuSets.size());
+    EXPECT_EQ((vector<int> { 4, 5, 6, 7 }), cpuSets[0]);
+    EXPECT_EQ((vector<int> { 4, 5, 6, 7 }), cpuSets[1]);
+}
+
+TEST(ThreadAffinityTest, detect)
+{
+    CpuTopology topology = CpuTopology::detect();
+    ASSERT_FALSE(topology.cpus().empty());
+
+    int cpu = topology.cpus().front().cpu;
+    EXPECT_TRUE(topology.find(cpu) != nullptr);
+#if defined(OS_LINUX)
+    EXPECT_TRUE(setCurrentThreadAffinity(vector<int> { cpu }));
+#endif
+}
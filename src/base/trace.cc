@@ -0,0 +1,268 @@
+#include "base/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glog/logging.h>
+
+DEFINE_bool(trace, false, "Record trace events. See base/trace.h.");
+DEFINE_string(trace_file_prefix, "trace", "Trace JSON files are written to <prefix>-<label>.json");
+DEFINE_int32(trace_buffer_size, 1 << 16, "The number of trace events kept per thread. Rounded up to a power of 2.");
+
+using namespace std;
+
+namespace {
+
+struct Event {
+    // The fields are atomic only because writeJSON() might read an event while the owner
+    // thread is overwriting it. Such events are discarded, and relaxed accesses are free on x86.
+    atomic<const char*> name;
+    atomic<uint64_t> beginTsc;
+    atomic<uint64_t> endTsc;
+};
+
+struct EventCopy {
+    const char* name;
+    uint64_t beginTsc;
+    uint64_t endTsc;
+};
+
+// ThreadBuffer is a ring buffer of events. Only the owner thread adds events.
+struct ThreadBuffer {
+    ThreadBuffer(int tid, size_t capacity) : tid(tid), mask(capacity - 1), events(new Event[capacity]), head(0), start(0) {}
+
+    const int tid;
+    string name;  // Guarded by Registry::mu.
+    const uint64_t mask;
+    unique_ptr<Event[]> events;
+    // The number of events added so far.
+    atomic<uint64_t> head;
+    // Events before this index have been cleared.
+    atomic<uint64_t> start;
+};
+
+// Registry has the buffers of all the threads. The buffers are kept after their threads exit,
+// so that the events of the exited threads can be written. A buffer of an exited thread is
+// reused by a new thread, since some threads (e.g. ponderer) are made again and again.
+struct Registry {
+    mutex mu;
+    vector<unique_ptr<ThreadBuffer>> buffers;
+    vector<ThreadBuffer*> freeBuffers;
+    // A pair of time and tsc to estimate the tsc frequency.
+    chrono::steady_clock::time_point calibrationTime;
+    uint64_t calibrationTsc;
+    // The tsc at the last clear(). The timestamps in the trace are relative to this.
+    uint64_t baseTsc;
+};
+
+Registry& registry()
+{
+    static Registry* registry = [] {
+        Registry* r = new Registry;
+        unsigned int aux;
+        r->calibrationTime = chrono::steady_clock::now();
+        r->calibrationTsc = rdtscp(&aux);
+        r->baseTsc = r->calibrationTsc;
+        return r;
+    }();
+    return *registry;
+}
+
+size_t roundUpToPowerOfTwo(size_t n)
+{
+    size_t x = 1;
+    while (x < n)
+        x *= 2;
+    return x;
+}
+
+// Returns the buffer to the registry when the thread exits.
+class ThreadBufferHolder {
+public:
+    ~ThreadBufferHolder()
+    {
+        if (!buffer)
+            return;
+        Registry& r = registry();
+        lock_guard<mutex> lock(r.mu);
+        r.freeBuffers.push_back(buffer);
+    }
+
+    ThreadBuffer* buffer = nullptr;
+};
+
+thread_local ThreadBufferHolder currentThreadBuffer;
+
+ThreadBuffer* threadBuffer()
+{
+    if (currentThreadBuffer.buffer)
+        return currentThreadBuffer.buffer;
+
+    Registry& r = registry();
+    lock_guard<mutex> lock(r.mu);
+    size_t capacity = roundUpToPowerOfTwo(max(FLAGS_trace_buffer_size, 1));
+    for (auto it = r.freeBuffers.begin(); it != r.freeBuffers.end(); ++it) {
+        if ((*it)->mask + 1 != capacity)
+            continue;
+        currentThreadBuffer.buffer = *it;
+        r.freeBuffers.erase(it);
+        return currentThreadBuffer.buffer;
+    }
+
+    r.buffers.emplace_back(new ThreadBuffer(static_cast<int>(r.buffers.size()) + 1, capacity));
+    currentThreadBuffer.buffer = r.buffers.back().get();
+    return currentThreadBuffer.buffer;
+}
+
+void writeEscapedString(ostream* os, const string& s)
+{
+    *os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            *os << '\\';
+        *os << c;
+    }
+    *os << '"';
+}
+
+} // anonymous namespace
+
+// static
+void Tracer::addEvent(const char* name, unsigned long long beginTsc, unsigned long long endTsc)
+{
+    ThreadBuffer* buffer = threadBuffer();
+    uint64_t head = buffer->head.load(memory_order_relaxed);
+    Event& event = buffer->events[head & buffer->mask];
+    // Overwriting this slot drops the event (head - capacity). The fence makes sure that
+    // writeJSON() sees the current head once it sees any of the stores below, so it can tell
+    // that the event is being overwritten.
+    atomic_thread_fence(memory_order_release);
+    event.name.store(name, memory_order_relaxed);
+    event.beginTsc.store(beginTsc, memory_order_relaxed);
+    event.endTsc.store(endTsc, memory_order_relaxed);
+    buffer->head.store(head + 1, memory_order_release);
+}
+
+// static
+void Tracer::setThreadName(const string& name)
+{
+    if (!isEnabled())
+        return;
+
+    ThreadBuffer* buffer = threadBuffer();
+    lock_guard<mutex> lock(registry().mu);
+    buffer->name = name;
+}
+
+// static
+void Tracer::writeJSON(ostream* os)
+{
+    Registry& r = registry();
+    lock_guard<mutex> lock(r.mu);
+
+    // Estimate the tsc frequency from the time passed since the registry was made.
+    unsigned int aux;
+    uint64_t nowTsc = rdtscp(&aux);
+    double elapsedMicros = chrono::duration<double, micro>(chrono::steady_clock::now() - r.calibrationTime).count();
+    double ticksPerMicro = 1.0;
+    if (nowTsc > r.calibrationTsc && elapsedMicros > 0)
+        ticksPerMicro = (nowTsc - r.calibrationTsc) / elapsedMicros;
+
+    // Timestamps are written in microseconds with nanosecond precision.
+    ios::fmtflags oldFlags = os->flags();
+    streamsize oldPrecision = os->precision(3);
+    os->setf(ios::fixed, ios::floatfield);
+
+    *os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() -> const char* {
+        if (!first)
+            return ",\n";
+        first = false;
+        return "\n";
+    };
+
+    for (const auto& buffer : r.buffers) {
+        if (!buffer->name.empty()) {
+            *os << separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"args\":{\"name\":";
+            writeEscapedString(os, buffer->name);
+            *os << "}}";
+        }
+
+        uint64_t head = buffer->head.load(memory_order_acquire);
+        uint64_t capacity = buffer->mask + 1;
+        uint64_t begin = max(buffer->start.load(memory_order_relaxed), head > capacity ? head - capacity : 0);
+        vector<EventCopy> events;
+        events.reserve(head - begin);
+        for (uint64_t i = begin; i < head; ++i) {
+            const Event& event = buffer->events[i & buffer->mask];
+            events.push_back(EventCopy {
+                event.name.load(memory_order_relaxed),
+                event.beginTsc.load(memory_order_relaxed),
+                event.endTsc.load(memory_order_relaxed)
+            });
+        }
+
+        // The owner might have overwritten the oldest events while we were copying them.
+        // The owner might also be overwriting the event (new head - capacity) now, since
+        // it writes the event at the new head before bumping the head. So only the events
+        // from (the new head + 1 - capacity) are intact.
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t newHead = buffer->head.load(memory_order_relaxed);
+        uint64_t validBegin = newHead + 1 > capacity ? newHead + 1 - capacity : 0;
+
+        for (uint64_t i = max(begin, validBegin); i < head; ++i) {
+            const EventCopy& event = events[i - begin];
+            // Skip the events that began before clear().
+            if (event.beginTsc < r.baseTsc)
+                continue;
+
+            *os << separator() << "{\"name\":";
+            writeEscapedString(os, event.name);
+            *os << ",\"cat\":\"puyoai\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << (event.beginTsc - r.baseTsc) / ticksPerMicro
+                << ",\"dur\":" << (event.endTsc - event.beginTsc) / ticksPerMicro << "}";
+        }
+    }
+
+    *os << "\n]}\n";
+
+    os->flags(oldFlags);
+    os->precision(oldPrecision);
+}
+
+// static
+void Tracer::clear()
+{
+    Registry& r = registry();
+    lock_guard<mutex> lock(r.mu);
+    for (const auto& buffer : r.buffers)
+        buffer->start.store(buffer->head.load(memory_order_acquire), memory_order_relaxed);
+
+    unsigned int aux;
+    r.baseTsc = rdtscp(&aux);
+}
+
+// static
+bool Tracer::flush(const string& label)
+{
+    string filename = FLAGS_trace_file_prefix + "-" + label + ".json";
+    ofstream ofs(filename);
+    if (!ofs) {
+        LOG(ERROR) << "failed to open " << filename;
+        return false;
+    }
+
+    writeJSON(&ofs);
+    clear();
+    LOG(INFO) << "trace events are written to " << filename;
+    return static_cast<bool>(ofs);
+}
@@ -0,0 +1,81 @@
+#ifndef BASE_TRACE_H_
+#define BASE_TRACE_H_
+
+#include <ostream>
+#include <string>
+
+#include <gflags/gflags.h>
+
+#include "base/noncopyable.h"
+#include "base/time_stamp_counter.h"
+
+DECLARE_bool(trace);
+
+// Tracer records trace events, and writes them as Chrome trace JSON, which can be
+// viewed with chrome://tracing or Perfetto (https://ui.perfetto.dev).
+//
+// Usually, use TRACE_SCOPE() to record the time spent in a scope:
+//
+//   void PatternThinker::think(...)
+//   {
+//       TRACE_SCOPE("PatternThinker::think");
+//       ...
+//   }
+//
+// Each thread records the events into its own ring buffer without taking a lock.
+// When the buffer is full, the oldest events are overwritten.
+//
+// Tracing is enabled with --trace. When it's disabled, TRACE_SCOPE() only reads the flag.
+// When PUYOAI_DISABLE_TRACE is defined, TRACE_SCOPE() is compiled out.
+class Tracer : noncopyable {
+public:
+    static bool isEnabled() { return FLAGS_trace; }
+
+    // Records an event that began at |beginTsc| and ended at |endTsc|, which are taken by rdtscp().
+    // |name| is not copied, so it should be a string literal.
+    static void addEvent(const char* name, unsigned long long beginTsc, unsigned long long endTsc);
+    // Sets the name of the current thread shown in the trace.
+    static void setThreadName(const std::string& name);
+
+    // Writes the events recorded since the last clear() as Chrome trace JSON.
+    // This can be called while the other threads are recording events.
+    static void writeJSON(std::ostream*);
+    // Drops the recorded events.
+    static void clear();
+
+    // Writes the recorded events to "<--trace_file_prefix>-<label>.json", and clears them.
+    // Returns false if the file could not be written.
+    static bool flush(const std::string& label);
+};
+
+// ScopedTrace records an event from its construction to its destruction.
+class ScopedTrace : noncopyable {
+public:
+    explicit ScopedTrace(const char* name) :
+        name_(name),
+        beginTsc_(Tracer::isEnabled() ? rdtscp(&aux_) : 0)
+    {
+    }
+
+    ~ScopedTrace()
+    {
+        if (beginTsc_ != 0)
+            Tracer::addEvent(name_, beginTsc_, rdtscp(&aux_));
+    }
+
+private:
+    const char* name_;
+    unsigned int aux_;
+    unsigned long long beginTsc_;
+};
+
+#define TRACE_CONCAT_INTERNAL(x, y) x ## y
+#define TRACE_CONCAT(x, y) TRACE_CONCAT_INTERNAL(x, y)
+
+#ifdef PUYOAI_DISABLE_TRACE
+#define TRACE_SCOPE(name) do {} while (false)
+#else
+#define TRACE_SCOPE(name) ScopedTrace TRACE_CONCAT(scopedTrace, __LINE__)(name)
+#endif
+
+#endif // BASE_TRACE_H_
@@ -0,0 +1,115 @@
+#include "base/trace.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+using namespace std;
+
+DECLARE_int32(trace_buffer_size);
+
+namespace {
+
+int countOccurrences(const string& s, const string& pattern)
+{
+    int n = 0;
+    for (size_t pos = s.find(pattern); pos != string::npos; pos = s.find(pattern, pos + 1))
+        ++n;
+    return n;
+}
+
+string traceJSON()
+{
+    ostringstream ss;
+    Tracer::writeJSON(&ss);
+    return ss.str();
+}
+
+} // anonymous namespace
+
+class TracerTest : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        FLAGS_trace = true;
+        Tracer::clear();
+    }
+
+    void TearDown() override
+    {
+        FLAGS_trace = false;
+        Tracer::clear();
+    }
+};
+
+TEST_F(TracerTest, scope)
+{
+    {
+        ScopedTrace outer("outer");
+        ScopedTrace inner("inner");
+    }
+
+    string json = traceJSON();
+    EXPECT_EQ(1, countOccurrences(json, "\"name\":\"outer\""));
+    EXPECT_EQ(1, countOccurrences(json, "\"name\":\"inner\""));
+    EXPECT_EQ(2, countOccurrences(json, "\"ph\":\"X\""));
+
+    Tracer::clear();
+    EXPECT_EQ(0, countOccurrences(traceJSON(), "\"ph\":\"X\""));
+}
+
+TEST_F(TracerTest, disabled)
+{
+    FLAGS_trace = false;
+    {
+        ScopedTrace scopedTrace("disabled");
+    }
+
+    EXPECT_EQ(0, countOccurrences(traceJSON(), "\"name\":\"disabled\""));
+}
+
+TEST_F(TracerTest, threads)
+{
+    thread th([]() {
+        Tracer::setThreadName("test-thread");
+        ScopedTrace scopedTrace("in-thread");
+    });
+    th.join();
+
+    {
+        ScopedTrace scopedTrace("in-main");
+    }
+
+    // The events of an exited thread are still available.
+    string json = traceJSON();
+    EXPECT_EQ(1, countOccurrences(json, "\"args\":{\"name\":\"test-thread\"}"));
+    EXPECT_EQ(1, countOccurrences(json, "\"name\":\"in-thread\""));
+    EXPECT_EQ(1, countOccurrences(json, "\"name\":\"in-main\""));
+}
+
+TEST_F(TracerTest, overwriteOldEvents)
+{
+    int oldBufferSize = FLAGS_trace_buffer_size;
+    FLAGS_trace_buffer_size = 4;
+
+    // The buffer is made when the thread records the first event.
+    thread th([]() {
+        static const char* const NAMES[] = { "e0", "e1", "e2", "e3", "e4", "e5" };
+        for (const char* name : NAMES) {
+            ScopedTrace scopedTrace(name);
+        }
+    });
+    th.join();
+    FLAGS_trace_buffer_size = oldBufferSize;
+
+    // The oldest event in the buffer (e2) is dropped too, since writeJSON() cannot tell
+    // whether the owner is overwriting it with the next event.
+    string json = traceJSON();
+    EXPECT_EQ(0, countOccurrences(json, "\"name\":\"e2\""));
+    EXPECT_EQ(1, countOccurrences(json, "\"name\":\"e3\""));
+    EXPECT_EQ(1, countOccurrences(json, "\"name\":\"e5\""));
+    EXPECT_EQ(3, countOccurrences(json, "\"ph\":\"X\""));
+}
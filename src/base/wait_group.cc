@@ -12,24 +12,22 @@ WaitGroup::WaitGroup() :
 void WaitGroup::add(int n)
 {
     lock_guard<mutex> lock(mu_);
-    num_ += n;
+    num_.fetch_add(n, memory_order_relaxed);
 }
 
 void WaitGroup::done()
 {
     lock_guard<mutex> lock(mu_);
-    CHECK_GT(num_, 0) << "Probably you forgot calling add().";
+    CHECK_GT(num_.load(memory_order_relaxed), 0) << "Probably you forgot calling add().";
 
-    --num_;
-
-    if (num_ == 0)
+    if (num_.fetch_sub(1, memory_order_release) == 1)
         condVar_.notify_all();
 }
 
 void WaitGroup::waitUntilDone()
 {
     unique_lock<mutex> lock(mu_);
-    while (num_ > 0) {
+    while (num_.load(memory_order_relaxed) > 0) {
         condVar_.wait(lock);
     }
 }
@@ -1,6 +1,7 @@
 #ifndef BASE_WAITGROUP_H_
 #define BASE_WAITGROUP_H_
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 
@@ -15,10 +16,15 @@ public:
 
     void waitUntilDone();
 
+    // Returns true if all the added tasks are done. This doesn't block.
+    // Even when this returns true, call waitUntilDone() before destroying the WaitGroup,
+    // since done() might still be touching it.
+    bool isDone() const { return num_.load(std::memory_order_acquire) == 0; }
+
 private:
     std::mutex mu_;
     std::condition_variable condVar_;
-    int num_;
+    std::atomic<int> num_;
 };
 
 #endif // BASE_WAITGROUP_H_
@@ -0,0 +1,145 @@
+#ifndef BASE_WORK_STEALING_QUEUE_H_
+#define BASE_WORK_STEALING_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "base/noncopyable.h"
+
+// WorkStealingQueue is a Chase-Lev work-stealing deque.
+// Only one thread (the owner) can call push() and pop(). They operate on the bottom of the deque.
+// Any thread can call steal(), which takes an element from the top of the deque.
+// The buffer grows when it's full. T must be trivially copyable (e.g. a pointer).
+//
+// c.f. N. M. Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013.
+template<typename T>
+class WorkStealingQueue : noncopyable {
+public:
+    explicit WorkStealingQueue(int initialCapacity = 256);
+
+    // Owner only.
+    void push(T v);
+    // Owner only. Returns false if empty.
+    bool pop(T* v);
+    // Any thread. Returns false if empty or if another thread took the element first.
+    bool steal(T* v);
+
+    // Might not be accurate when the other threads are operating on this queue.
+    bool empty() const;
+
+private:
+    class Buffer {
+    public:
+        explicit Buffer(std::int64_t capacity) : mask_(capacity - 1), elements_(new std::atomic<T>[capacity]) {}
+
+        std::int64_t capacity() const { return mask_ + 1; }
+        T get(std::int64_t i) const { return elements_[i & mask_].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, T v) { elements_[i & mask_].store(v, std::memory_order_relaxed); }
+
+    private:
+        const std::int64_t mask_;
+        std::unique_ptr<std::atomic<T>[]> elements_;
+    };
+
+    Buffer* grow(Buffer*, std::int64_t bottom, std::int64_t top);
+
+    std::atomic<std::int64_t> top_;
+    std::atomic<std::int64_t> bottom_;
+    std::atomic<Buffer*> buffer_;
+    // A thief might be reading an old buffer, so we keep the old buffers until destruction.
+    // Only the owner touches this.
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+template<typename T>
+WorkStealingQueue<T>::WorkStealingQueue(int initialCapacity) :
+    top_(0),
+    bottom_(0)
+{
+    std::int64_t capacity = 1;
+    while (capacity < initialCapacity)
+        capacity *= 2;
+
+    buffers_.emplace_back(new Buffer(capacity));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+}
+
+template<typename T>
+void WorkStealingQueue<T>::push(T v)
+{
+    std::int64_t b = bottom_.load(std::memory_order_relaxed);
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > buffer->capacity() - 1)
+        buffer = grow(buffer, b, t);
+
+    buffer->put(b, v);
+    bottom_.store(b + 1, std::memory_order_release);
+}
+
+template<typename T>
+bool WorkStealingQueue<T>::pop(T* v)
+{
+    std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (b < t) {
+        // Empty.
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    *v = buffer->get(b);
+    if (t < b)
+        return true;
+
+    // The last element. Race with thieves.
+    bool succeeded = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return succeeded;
+}
+
+template<typename T>
+bool WorkStealingQueue<T>::steal(T* v)
+{
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = bottom_.load(std::memory_order_acquire);
+    if (b <= t)
+        return false;
+
+    Buffer* buffer = buffer_.load(std::memory_order_acquire);
+    T x = buffer->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return false;
+
+    *v = x;
+    return true;
+}
+
+template<typename T>
+bool WorkStealingQueue<T>::empty() const
+{
+    std::int64_t b = bottom_.load(std::memory_order_seq_cst);
+    std::int64_t t = top_.load(std::memory_order_seq_cst);
+    return b <= t;
+}
+
+template<typename T>
+typename WorkStealingQueue<T>::Buffer* WorkStealingQueue<T>::grow(Buffer* buffer, std::int64_t bottom, std::int64_t top)
+{
+    Buffer* newBuffer = new Buffer(buffer->capacity() * 2);
+    for (std::int64_t i = top; i < bottom; ++i)
+        newBuffer->put(i, buffer->get(i));
+
+    buffers_.emplace_back(newBuffer);
+    buffer_.store(newBuffer, std::memory_order_release);
+    return newBuffer;
+}
+
+#endif // BASE_WORK_STEALING_QUEUE_H_
@@ -0,0 +1,79 @@
+#include "base/work_stealing_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(WorkStealingQueueTest, pushAndPop)
+{
+    WorkStealingQueue<int> q(2);
+    EXPECT_TRUE(q.empty());
+
+    int v;
+    EXPECT_FALSE(q.pop(&v));
+    EXPECT_FALSE(q.steal(&v));
+
+    // Exceed the initial capacity to grow the buffer.
+    for (int i = 0; i < 10; ++i)
+        q.push(i);
+    EXPECT_FALSE(q.empty());
+
+    // pop() takes from the bottom, steal() takes from the top.
+    EXPECT_TRUE(q.pop(&v));
+    EXPECT_EQ(9, v);
+    EXPECT_TRUE(q.steal(&v));
+    EXPECT_EQ(0, v);
+
+    for (int i = 8; i >= 1; --i) {
+        EXPECT_TRUE(q.pop(&v));
+        EXPECT_EQ(i, v);
+    }
+    EXPECT_TRUE(q.empty());
+    EXPECT_FALSE(q.pop(&v));
+}
+
+TEST(WorkStealingQueueTest, stealConcurrently)
+{
+    const int N = 100000;
+    const int NUM_THIEVES = 3;
+
+    WorkStealingQueue<int> q;
+    vector<atomic<int>> taken(N);
+    for (auto& t : taken)
+        t = 0;
+
+    atomic<bool> finished(false);
+    vector<thread> thieves;
+    for (int i = 0; i < NUM_THIEVES; ++i) {
+        thieves.emplace_back([&]() {
+            int v;
+            while (!finished) {
+                if (q.steal(&v))
+                    ++taken[v];
+            }
+            while (q.steal(&v))
+                ++taken[v];
+        });
+    }
+
+    int v;
+    for (int i = 0; i < N; ++i) {
+        q.push(i);
+        if (i % 3 == 0 && q.pop(&v))
+            ++taken[v];
+    }
+    while (q.pop(&v))
+        ++taken[v];
+
+    finished = true;
+    for (auto& th : thieves)
+        th.join();
+
+    // Every element should be taken exactly once.
+    for (int i = 0; i < N; ++i)
+        EXPECT_EQ(1, taken[i]) << i;
+}
@@ -1,5 +1,6 @@
 #include "capture/capture.h"
 
+#include "base/trace.h"
 #include "capture/source.h"
 #include "gui/screen.h"
 #include "gui/SDL_prims.h"
@@ -33,12 +34,19 @@ void Capture::stop()
 void Capture::runLoop()
 {
     int frameId = 0;
+    int numFinishedGames = 0;
     UniqueSDLSurface prevSurface(emptyUniqueSDLSurface());
     UniqueSDLSurface prev2Surface(emptyUniqueSDLSurface());
     UniqueSDLSurface prev3Surface(emptyUniqueSDLSurface());
 
+    Tracer::setThreadName("capture");
+
     while (!shouldStop_) {
-        UniqueSDLSurface surface(source_->nextFrame());
+        UniqueSDLSurface surface(emptyUniqueSDLSurface());
+        {
+            TRACE_SCOPE("Capture::nextFrame");
+            surface = source_->nextFrame();
+        }
         if (!surface.get())
             continue;
 
@@ -46,8 +54,18 @@ void Capture::runLoop()
         surface->userdata = reinterpret_cast<void*>(static_cast<uintptr_t>(++frameId));
 
         lock_guard<mutex> lock(mu_);
-        unique_ptr<AnalyzerResult> r =
-            analyzer_->analyze(surface.get(), prevSurface.get(), prev2Surface.get(), prev3Surface.get(), results_);
+        unique_ptr<AnalyzerResult> r;
+        {
+            TRACE_SCOPE("Capture::analyze");
+            r = analyzer_->analyze(surface.get(), prevSurface.get(), prev2Surface.get(), prev3Surface.get(), results_);
+        }
+
+        // The trace is written per game.
+        if (Tracer::isEnabled() && r && isGameFinishedState(r->state())) {
+            bool wasFinished = !results_.empty() && results_.front() && isGameFinishedState(results_.front()->state());
+            if (!wasFinished)
+                Tracer::flush("capture-game" + to_string(++numFinishedGames));
+        }
 
         prev3Surface = move(prev2Surface);
         prev2Surface = move(prevSurface);
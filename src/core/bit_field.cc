@@ -5,10 +5,12 @@
 
 #include <sstream>
 
+#include "core/bit_field_kernel.h"
 #include "core/frame.h"
 #include "core/plain_field.h"
 #include "core/position.h"
 #include "core/score.h"
+#include "core/zobrist_hash.h"
 
 using namespace std;
 
@@ -70,6 +72,14 @@ BitField::BitField(const string& str) : BitField()
     }
 }
 
+#ifdef PUYOAI_PORTABLE
+RensaResult BitField::simulate(int initialChain)
+{
+    SimulationContext context(initialChain);
+    return BitFieldKernel::current().simulate(this, &context);
+}
+#endif
+
 bool BitField::hasEmptyNeighbor(int x, int y) const
 {
     if (x + 1 <= 6 && isEmpty(x + 1, y))
@@ -171,26 +181,8 @@ std::string BitField::toDebugString(char charIfEmpty) const
 
 size_t BitField::hash() const
 {
-    // Using a small P (e.g. 33) is not good. It causes a lot of collisions.
-    // TODO(mayah): We will have a few collisions. Probably we should consider better algorithm here.
-    // See https://github.com/puyoai/puyoai/issues/190
-
-    static const size_t p = 1000000009; // 10^9+9
     static_assert(sizeof(std::uint64_t) == sizeof(size_t), "assumed 64bit");
-
-    union {
-        std::uint64_t v[6];
-        __m128i m[3];
-    };
-
-    for (int i = 0; i < 3; ++i)
-        m[i] = m_[i].xmm();
-
-    size_t r = 0;
-    for (int i = 0; i < 6; ++i)
-        r = r * p + v[i];
-
-    return r;
+    return ZobristHash::hash(*this);
 }
 
 bool operator==(const BitField& lhs, const BitField& rhs)
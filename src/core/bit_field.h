@@ -3,6 +3,10 @@
 
 #include <string>
 
+#ifdef __AVX512VL__
+#include <immintrin.h>
+#endif
+
 #include <glog/logging.h>
 
 #include "base/base.h"
@@ -64,6 +68,7 @@ public:
     // Returns true if there are floating puyos.
     bool hasFloatingPuyo() const;
 
+    // In a PUYOAI_PORTABLE build, the kernel is chosen at runtime. See BitFieldKernel.
     RensaResult simulate(int initialChain = 1);
     template<typename Tracker> NOINLINE_UNLESS_RELEASE RensaResult simulate(SimulationContext*, Tracker*);
     // Faster version of simulate(). Returns the number of chains.
@@ -86,20 +91,33 @@ public:
     int fillErasingPuyoPositions(Position* eraseQueue) const;
     FieldBits ignitionPuyoBits() const;
 
+    // Returns ZobristHash::hash(*this). This is not cheap, since all the puyos are hashed.
+    // CoreField::hash() is O(1).
     size_t hash() const;
 
     friend bool operator==(const BitField&, const BitField&);
     friend std::ostream& operator<<(std::ostream&, const BitField&);
 
-#if defined(__AVX2__) && defined(__BMI2__)
+#if (defined(__AVX2__) && defined(__BMI2__)) || defined(PORTABLE_AVX2_BMI2)
     // Faster version of simulate() that uses AVX2 instruction set.
-    template<typename Tracker> RensaResult NOINLINE_UNLESS_RELEASE simulateAVX2(SimulationContext*, Tracker*);
-    template<typename Tracker> int simulateFastAVX2(Tracker*);
-    template<typename Tracker> RensaStepResult NOINLINE_UNLESS_RELEASE vanishDropAVX2(SimulationContext*, Tracker*);
-    template<typename Tracker> bool vanishDropFastAVX2(SimulationContext*, Tracker*);
+    // In a PUYOAI_PORTABLE build, these are defined only in bit_field_avx2.cc.
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaResult NOINLINE_UNLESS_RELEASE simulateAVX2(SimulationContext*, Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 int simulateFastAVX2(Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaStepResult NOINLINE_UNLESS_RELEASE vanishDropAVX2(SimulationContext*, Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 bool vanishDropFastAVX2(SimulationContext*, Tracker*);
+
+    // Same as simulateAVX2() etc., but puyos are dropped without PDEP/PEXT.
+    // PDEP/PEXT are microcoded on some CPUs (e.g. AMD Zen1/Zen2). These are faster there.
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaResult NOINLINE_UNLESS_RELEASE simulateAVX2NoPext(SimulationContext*, Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 int simulateFastAVX2NoPext(Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 RensaStepResult NOINLINE_UNLESS_RELEASE vanishDropAVX2NoPext(SimulationContext*, Tracker*);
+    template<typename Tracker> TARGET_AVX2_BMI2 bool vanishDropFastAVX2NoPext(SimulationContext*, Tracker*);
 #endif
 
 private:
+    friend class BitFieldBatch;
+    friend class ZobristHash;
+
     BitField escapeInvisible();
     void recoverInvisible(const BitField&);
 
@@ -117,15 +135,19 @@ private:
     template<typename Tracker>
     void dropAfterVanishFast(FieldBits erased, Tracker* tracker);
 
-#if defined(__AVX2__) && defined(__BMI2__)
-    template<typename Tracker>
+#if (defined(__AVX2__) && defined(__BMI2__)) || defined(PORTABLE_AVX2_BMI2)
+    template<typename Tracker> TARGET_AVX2_BMI2
     int vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const;
-    template<typename Tracker>
+    template<typename Tracker> TARGET_AVX2_BMI2
     bool vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const;
-    template<typename Tracker>
+    template<typename Tracker> TARGET_AVX2_BMI2
     int dropAfterVanishAVX2(FieldBits erased, Tracker* tracker);
-    template<typename Tracker>
+    template<typename Tracker> TARGET_AVX2_BMI2
     void dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker);
+    template<typename Tracker> TARGET_AVX2_BMI2
+    int dropAfterVanishNoPext(FieldBits erased, Tracker* tracker);
+    template<typename Tracker> TARGET_AVX2_BMI2
+    void dropAfterVanishFastNoPext(FieldBits erased, Tracker* tracker);
 #endif
 
     FieldBits m_[3];
@@ -134,6 +156,23 @@ private:
 inline
 FieldBits BitField::bits(PuyoColor c) const
 {
+#ifdef __AVX512VL__
+    // The color is (m_[2] m_[1] m_[0]) in binary, so the truth table of VPTERNLOG for color c is 1 << c.
+    const __m128i a = m_[2].xmm();
+    const __m128i b = m_[1].xmm();
+    const __m128i d = m_[0].xmm();
+
+    switch (c) {
+    case PuyoColor::EMPTY:  return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 0));
+    case PuyoColor::OJAMA:  return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 1));
+    case PuyoColor::WALL:   return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 2));
+    case PuyoColor::IRON:   return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 3));
+    case PuyoColor::RED:    return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 4));
+    case PuyoColor::BLUE:   return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 5));
+    case PuyoColor::YELLOW: return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 6));
+    case PuyoColor::GREEN:  return FieldBits(_mm_ternarylogic_epi64(a, b, d, 1 << 7));
+    }
+#else
     const __m128i zero = _mm_setzero_si128();
 
     switch (c) {
@@ -154,6 +193,7 @@ FieldBits BitField::bits(PuyoColor c) const
     case PuyoColor::GREEN:  // = 7  111
         return FieldBits(_mm_and_si128(m_[0].xmm(), _mm_and_si128(m_[1].xmm(), m_[2].xmm())));
     }
+#endif
 
     CHECK(false);
     return FieldBits();
@@ -201,6 +241,7 @@ void BitField::setColor(int x, int y, PuyoColor c)
     }
 }
 
+#ifndef PUYOAI_PORTABLE
 inline
 RensaResult BitField::simulate(int initialChain)
 {
@@ -208,6 +249,7 @@ RensaResult BitField::simulate(int initialChain)
     SimulationContext context(initialChain);
     return simulate(&context, &tracker);
 }
+#endif
 
 inline
 void BitField::setColorAll(FieldBits bits, PuyoColor c)
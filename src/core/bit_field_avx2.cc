@@ -0,0 +1,113 @@
+// The AVX2 kernels. Don't call the functions here without checking the CPU supports
+// AVX2 and BMI2. See BitFieldKernel.
+//
+// In a PUYOAI_PORTABLE build, this file is compiled for SSE4.2 like the other files, and only
+// the functions marked with TARGET_AVX2_BMI2 use AVX2 and BMI2. Don't compile this file with
+// -mavx2: the inline functions shared with the other files would be emitted with AVX2
+// instructions, and the linker might choose them for the other files.
+
+#include "core/bit_field_kernel.h"
+
+#if (defined(__AVX2__) && defined(__BMI2__)) || defined(PORTABLE_AVX2_BMI2)
+
+#include "core/bit_field_avx2_inl.h"
+
+namespace {
+
+TARGET_AVX2_BMI2
+RensaResult simulateAVX2(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->simulateAVX2(context, &tracker);
+}
+
+TARGET_AVX2_BMI2
+int simulateFastAVX2(BitField* bf)
+{
+    RensaNonTracker tracker;
+    return bf->simulateFastAVX2(&tracker);
+}
+
+TARGET_AVX2_BMI2
+RensaStepResult vanishDropAVX2(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->vanishDropAVX2(context, &tracker);
+}
+
+TARGET_AVX2_BMI2
+bool vanishDropFastAVX2(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->vanishDropFastAVX2(context, &tracker);
+}
+
+TARGET_AVX2_BMI2
+RensaResult simulateAVX2NoPext(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->simulateAVX2NoPext(context, &tracker);
+}
+
+TARGET_AVX2_BMI2
+int simulateFastAVX2NoPext(BitField* bf)
+{
+    RensaNonTracker tracker;
+    return bf->simulateFastAVX2NoPext(&tracker);
+}
+
+TARGET_AVX2_BMI2
+RensaStepResult vanishDropAVX2NoPext(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->vanishDropAVX2NoPext(context, &tracker);
+}
+
+TARGET_AVX2_BMI2
+bool vanishDropFastAVX2NoPext(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->vanishDropFastAVX2NoPext(context, &tracker);
+}
+
+const BitFieldKernel AVX2_KERNEL {
+    "avx2",
+    simulateAVX2,
+    simulateFastAVX2,
+    vanishDropAVX2,
+    vanishDropFastAVX2,
+};
+
+const BitFieldKernel AVX2_NOPEXT_KERNEL {
+    "avx2_nopext",
+    simulateAVX2NoPext,
+    simulateFastAVX2NoPext,
+    vanishDropAVX2NoPext,
+    vanishDropFastAVX2NoPext,
+};
+
+} // anonymous namespace
+
+const BitFieldKernel* avx2BitFieldKernel()
+{
+    return &AVX2_KERNEL;
+}
+
+const BitFieldKernel* avx2NoPextBitFieldKernel()
+{
+    return &AVX2_NOPEXT_KERNEL;
+}
+
+#else
+
+const BitFieldKernel* avx2BitFieldKernel()
+{
+    return nullptr;
+}
+
+const BitFieldKernel* avx2NoPextBitFieldKernel()
+{
+    return nullptr;
+}
+
+#endif // (defined(__AVX2__) && defined(__BMI2__)) || defined(PORTABLE_AVX2_BMI2)
@@ -1,10 +1,13 @@
 #ifndef CORE_BIT_FIELD_AVX2_INL_256_H_
 #define CORE_BIT_FIELD_AVX2_INL_256_H_
 
-#if !defined(__AVX2__) || !defined(__BMI2__)
+#if !(defined(__AVX2__) && defined(__BMI2__)) && !defined(PORTABLE_AVX2_BMI2)
 # error "Needs AVX2 and BMI2 to use this header."
 #endif
 
+// Every function here is marked with TARGET_AVX2_BMI2, so that it can be compiled in
+// a PUYOAI_PORTABLE build. See base/compiler_specific.h.
+
 #if !defined(_MSC_VER)
 #include <x86intrin.h>
 #endif
@@ -15,6 +18,7 @@
 #include "field_bits_256.h"
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 RensaResult BitField::simulateAVX2(SimulationContext* context, Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -42,6 +46,7 @@ RensaResult BitField::simulateAVX2(SimulationContext* context, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 int BitField::simulateFastAVX2(Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -58,6 +63,7 @@ int BitField::simulateFastAVX2(Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 RensaStepResult BitField::vanishDropAVX2(SimulationContext* context, Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -84,6 +90,7 @@ RensaStepResult BitField::vanishDropAVX2(SimulationContext* context, Tracker* tr
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 bool BitField::vanishDropFastAVX2(SimulationContext* context, Tracker* tracker)
 {
     BitField escaped = escapeInvisible();
@@ -101,6 +108,97 @@ bool BitField::vanishDropFastAVX2(SimulationContext* context, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
+RensaResult BitField::simulateAVX2NoPext(SimulationContext* context, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+
+    int score = 0;
+    int frames = 0;
+    int nthChainScore;
+    bool quick = false;
+    FieldBits erased;
+
+    while ((nthChainScore = vanishAVX2(context->currentChain, &erased, tracker)) > 0) {
+        context->currentChain += 1;
+        score += nthChainScore;
+        frames += FRAMES_VANISH_ANIMATION;
+        int maxDrops = dropAfterVanishNoPext(erased, tracker);
+        if (maxDrops > 0) {
+            frames += FRAMES_TO_DROP_FAST[maxDrops] + FRAMES_GROUNDING;
+        } else {
+            quick = true;
+        }
+    }
+
+    recoverInvisible(escaped);
+    return RensaResult(context->currentChain - 1, score, frames, quick);
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
+int BitField::simulateFastAVX2NoPext(Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+    int currentChain = 1;
+
+    FieldBits erased;
+    while (vanishFastAVX2(currentChain, &erased, tracker)) {
+        currentChain += 1;
+        dropAfterVanishFastNoPext(erased, tracker);
+    }
+
+    recoverInvisible(escaped);
+    return currentChain - 1;
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
+RensaStepResult BitField::vanishDropAVX2NoPext(SimulationContext* context, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+
+    FieldBits erased;
+    int score = vanishAVX2(context->currentChain, &erased, tracker);
+    int maxDrops = 0;
+    int frames = FRAMES_VANISH_ANIMATION;
+    bool quick = false;
+    if (score > 0) {
+        maxDrops = dropAfterVanishNoPext(erased, tracker);
+        context->currentChain += 1;
+    }
+
+    if (maxDrops > 0) {
+        DCHECK(maxDrops < 14);
+        frames += FRAMES_TO_DROP_FAST[maxDrops] + FRAMES_GROUNDING;
+    } else {
+        quick = true;
+    }
+
+    recoverInvisible(escaped);
+    return RensaStepResult(score, frames, quick);
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
+bool BitField::vanishDropFastAVX2NoPext(SimulationContext* context, Tracker* tracker)
+{
+    BitField escaped = escapeInvisible();
+
+    bool vanished = false;
+    FieldBits erased;
+    if (vanishFastAVX2(context->currentChain, &erased, tracker)) {
+        dropAfterVanishFastNoPext(erased, tracker);
+        context->currentChain += 1;
+        vanished = true;
+    }
+
+    recoverInvisible(escaped);
+    return vanished;
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
 CLANG_ALWAYS_INLINE
 int BitField::vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const
 {
@@ -181,6 +279,7 @@ int BitField::vanishAVX2(int currentChain, FieldBits* erased, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 bool BitField::vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* tracker) const
 {
     FieldBits256 erased256;
@@ -228,6 +327,7 @@ bool BitField::vanishFastAVX2(int currentChain, FieldBits* erased, Tracker* trac
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 CLANG_ALWAYS_INLINE
 int BitField::dropAfterVanishAVX2(FieldBits erased, Tracker* tracker)
 {
@@ -248,6 +348,7 @@ int BitField::dropAfterVanishAVX2(FieldBits erased, Tracker* tracker)
 }
 
 template<typename Tracker>
+TARGET_AVX2_BMI2
 void BitField::dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker)
 {
     const __m128i ones = sse::mm_setone_si128();
@@ -295,4 +396,50 @@ void BitField::dropAfterVanishFastAVX2(FieldBits erased, Tracker* tracker)
     tracker->trackDropBMI2(oldLowBits, oldHighBits, newLowBits, newHighBits);
 }
 
+template<typename Tracker>
+TARGET_AVX2_BMI2
+CLANG_ALWAYS_INLINE
+int BitField::dropAfterVanishNoPext(FieldBits erased, Tracker* tracker)
+{
+    // See dropAfterVanishAVX2().
+    __m128i nonempty = (m_[0] | m_[1] | m_[2]).xmm();
+    nonempty = _mm_andnot_si128(erased, nonempty);
+
+    __m128i holes = _mm_and_si128(sse::mm_porr_epi16(nonempty), erased);
+    __m128i num_holes = sse::mm_popcnt_epi16(holes);
+    int maxDrops = sse::mm_hmax_epu16(num_holes);
+
+    dropAfterVanishFastNoPext(erased, tracker);
+
+    return maxDrops;
+}
+
+template<typename Tracker>
+TARGET_AVX2_BMI2
+void BitField::dropAfterVanishFastNoPext(FieldBits erased, Tracker* tracker)
+{
+    // Dropping puyos is the same as PEXT with the mask where puyos are not erased,
+    // since the bits above the field are always 0 here.
+    const __m128i ones = sse::mm_setone_si128();
+    const sse::Compressor16 compressor(_mm_xor_si128(erased, ones));
+
+    m_[0] = compressor.compress(m_[0]);
+    m_[1] = compressor.compress(m_[1]);
+    m_[2] = compressor.compress(m_[2]);
+
+    // The tracker wants the bits before and after the drop. See dropAfterVanishFastAVX2().
+    sse::Decomposer t;
+    t.m = _mm_xor_si128(erased, ones);
+
+    __m256i shift = _mm256_cvtepu16_epi32(sse::mm_popcnt_epi16(erased));
+    __m256i halfOnes = _mm256_cvtepu16_epi32(ones);
+    __m256i shifted = _mm256_srlv_epi32(halfOnes, shift);
+    shifted = _mm256_packus_epi32(shifted, shifted);
+
+    avx::Decomposer256 y;
+    y.m = shifted;
+
+    tracker->trackDropBMI2(t.ui64[0], t.ui64[1], y.ui64[0], y.ui64[2]);
+}
+
 #endif // CORE_BIT_FIELD_AVX2_INL_256_H_
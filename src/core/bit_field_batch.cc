@@ -0,0 +1,386 @@
+#include "core/bit_field_batch.h"
+
+#include <array>
+
+#include <glog/logging.h>
+
+#include "base/builtin.h"
+#include "core/frame.h"
+#include "core/score.h"
+
+#ifdef __AVX2__
+#include "base/avx.h"
+#include "base/sse.h"
+#include "core/field_bits_256.h"
+#endif
+#ifdef __AVX512BW__
+#include "core/field_bits_512.h"
+#endif
+
+using namespace std;
+
+#ifdef __AVX2__
+namespace {
+
+#ifndef __AVX512BW__
+// Same as BitField::bits(c), but for 2 fields.
+FieldBits256 colorBits(const FieldBits256 m[3], PuyoColor c)
+{
+    switch (c) {
+    case PuyoColor::OJAMA:  // = 1  001
+        return _mm256_andnot_si256(m[2].ymm(), _mm256_andnot_si256(m[1].ymm(), m[0].ymm()));
+    case PuyoColor::RED:    // = 4  100
+        return _mm256_andnot_si256(m[0].ymm(), _mm256_andnot_si256(m[1].ymm(), m[2].ymm()));
+    case PuyoColor::BLUE:   // = 5  101
+        return _mm256_and_si256(m[0].ymm(), _mm256_andnot_si256(m[1].ymm(), m[2].ymm()));
+    case PuyoColor::YELLOW: // = 6  110
+        return _mm256_andnot_si256(m[0].ymm(), _mm256_and_si256(m[1].ymm(), m[2].ymm()));
+    case PuyoColor::GREEN:  // = 7  111
+        return _mm256_and_si256(m[0].ymm(), _mm256_and_si256(m[1].ymm(), m[2].ymm()));
+    default:
+        CHECK(false) << "unexpected color: " << c;
+        return FieldBits256();
+    }
+}
+
+FieldBits laneBits(const FieldBits256& bits, int lane)
+{
+    return lane == 0 ? bits.low() : bits.high();
+}
+
+void setLaneBits(FieldBits256* bits, int lane, FieldBits fb)
+{
+    if (lane == 0)
+        *bits = FieldBits256(bits->high(), fb);
+    else
+        *bits = FieldBits256(fb, bits->low());
+}
+
+std::array<int, 2> popcountLanes(const FieldBits256& bits)
+{
+    std::pair<int, int> pc = bits.popcountHighLow();
+    return std::array<int, 2> {{ pc.second, pc.first }};
+}
+
+// Returns the max drop amount of each lane.
+void calculateMaxDrops(const FieldBits256 m[3], FieldBits256 erased, int maxDrops[2])
+{
+    // The number of erased puyos under the top remaining puyo is the number of drops.
+    __m256i whole = _mm256_andnot_si256(erased.ymm(),
+        _mm256_or_si256(m[0].ymm(), _mm256_or_si256(m[1].ymm(), m[2].ymm())));
+    __m256i holes = _mm256_and_si256(avx::mm256_porr_epi16(whole), erased.ymm());
+    __m256i numHoles = avx::mm256_popcnt_epi16(holes);
+    maxDrops[0] = sse::mm_hmax_epu16(_mm256_castsi256_si128(numHoles));
+    maxDrops[1] = sse::mm_hmax_epu16(_mm256_extracti128_si256(numHoles, 1));
+}
+
+#ifdef __BMI2__
+// Drops puyos of 2 fields. The algorithm is the same as BitField::dropAfterVanishFastAVX2().
+void dropAfterVanish(FieldBits256 m[3], FieldBits256 erased)
+{
+    const __m128i ones = sse::mm_setone_si128();
+
+    avx::Decomposer256 oldBits;
+    oldBits.m = _mm256_xor_si256(erased.ymm(), _mm256_cmpeq_epi8(erased.ymm(), erased.ymm()));
+
+    // For each column, 0xFFFF >> (the number of erased puyos).
+    __m256i numErased = avx::mm256_popcnt_epi16(erased.ymm());
+    __m256i halfOnes = _mm256_cvtepu16_epi32(ones);
+    __m256i lowShifted = _mm256_srlv_epi32(halfOnes, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(numErased)));
+    __m256i highShifted = _mm256_srlv_epi32(halfOnes, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(numErased, 1)));
+    // packus works on each 128 bits, so the result is ordered as (low0, high0, low1, high1).
+    avx::Decomposer256 newBits;
+    newBits.m = _mm256_permute4x64_epi64(_mm256_packus_epi32(lowShifted, highShifted), 0xD8);
+
+    avx::Decomposer256 d[3];
+    for (int i = 0; i < 3; ++i)
+        d[i].m = m[i].ymm();
+
+    for (int w = 0; w < 4; ++w) {
+        if (newBits.ui64[w] == 0xFFFFFFFFFFFFFFFFULL)
+            continue;
+        for (int i = 0; i < 3; ++i)
+            d[i].ui64[w] = _pdep_u64(_pext_u64(d[i].ui64[w], oldBits.ui64[w]), newBits.ui64[w]);
+    }
+
+    for (int i = 0; i < 3; ++i)
+        m[i] = d[i].m;
+}
+#else
+// Drops puyos of 2 fields in lockstep. The algorithm is the same as BitField::dropAfterVanish().
+void dropAfterVanish(FieldBits256 m[3], FieldBits256 erased)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_cmpeq_epi8(zero, zero);
+
+    int wholeErased = erased.low().horizontalOr16() | erased.high().horizontalOr16();
+    int maxY = 31 - countLeadingZeros32(wholeErased);
+    int minY = countTrailingZeros32(wholeErased);
+
+    DCHECK(1 <= minY && minY <= maxY && maxY <= 12)
+        << "minY=" << minY << ' ' << "maxY=" << maxY << std::endl << erased.toString();
+
+    __m256i line = _mm256_set1_epi16(1 << (maxY + 1));
+    __m256i rightOnes = _mm256_set1_epi16((1 << (maxY + 1)) - 1);
+    __m256i leftOnes = _mm256_set1_epi16(~((1 << ((maxY + 1) + 1)) - 1));
+
+    for (int y = maxY; y >= minY; --y) {
+        line = _mm256_srli_epi16(line, 1);
+        rightOnes = _mm256_srai_epi16(rightOnes, 1);
+        leftOnes = _mm256_srai_epi16(leftOnes, 1);   // needs arithmetic shift.
+
+        // for each line, -1 if drop, 0 otherwise.
+        __m256i blender = _mm256_xor_si256(_mm256_cmpeq_epi16(_mm256_and_si256(line, erased.ymm()), zero), ones);
+
+        for (int i = 0; i < 3; ++i) {
+            __m256i v1 = _mm256_and_si256(rightOnes, m[i].ymm());
+            __m256i v2 = _mm256_and_si256(leftOnes, m[i].ymm());
+            __m256i v3 = _mm256_srli_epi16(v2, 1);
+            __m256i v4 = _mm256_or_si256(v1, v3);
+            m[i] = _mm256_blendv_epi8(m[i].ymm(), v4, blender);
+        }
+    }
+}
+#endif // __BMI2__
+
+#else
+// Same as BitField::bits(c), but for 4 fields. See BitField::bits() for the truth table.
+FieldBits512 colorBits(const FieldBits512 m[3], PuyoColor c)
+{
+    switch (c) {
+    case PuyoColor::OJAMA:  return _mm512_ternarylogic_epi64(m[2].zmm(), m[1].zmm(), m[0].zmm(), 1 << 1);
+    case PuyoColor::RED:    return _mm512_ternarylogic_epi64(m[2].zmm(), m[1].zmm(), m[0].zmm(), 1 << 4);
+    case PuyoColor::BLUE:   return _mm512_ternarylogic_epi64(m[2].zmm(), m[1].zmm(), m[0].zmm(), 1 << 5);
+    case PuyoColor::YELLOW: return _mm512_ternarylogic_epi64(m[2].zmm(), m[1].zmm(), m[0].zmm(), 1 << 6);
+    case PuyoColor::GREEN:  return _mm512_ternarylogic_epi64(m[2].zmm(), m[1].zmm(), m[0].zmm(), 1 << 7);
+    default:
+        CHECK(false) << "unexpected color: " << c;
+        return FieldBits512();
+    }
+}
+
+FieldBits laneBits(const FieldBits512& bits, int lane)
+{
+    return bits.lane(lane);
+}
+
+void setLaneBits(FieldBits512* bits, int lane, FieldBits fb)
+{
+    bits->setLane(lane, fb);
+}
+
+std::array<int, 4> popcountLanes(const FieldBits512& bits)
+{
+    return bits.popcountLanes();
+}
+
+void calculateMaxDrops(const FieldBits512 m[3], FieldBits512 erased, int maxDrops[4])
+{
+    // 0x0E: (b | c) & ~a
+    __m512i whole = _mm512_ternarylogic_epi64(erased.zmm(), m[0].zmm(), _mm512_or_si512(m[1].zmm(), m[2].zmm()), 0x0E);
+    FieldBits512 numHoles = avx::mm512_popcnt_epi16(
+        _mm512_and_si512(avx::mm512_porr_epi16(whole), erased.zmm()));
+    for (int lane = 0; lane < 4; ++lane)
+        maxDrops[lane] = sse::mm_hmax_epu16(numHoles.lane(lane).xmm());
+}
+
+// Drops puyos of 4 fields. Since the bits above the field are 0, dropping puyos
+// is the same as compressing the bits where puyos are not erased.
+void dropAfterVanish(FieldBits512 m[3], FieldBits512 erased)
+{
+    const avx::Compressor512 compressor(_mm512_ternarylogic_epi64(erased.zmm(), erased.zmm(), erased.zmm(), 0x55));
+    for (int i = 0; i < 3; ++i)
+        m[i] = compressor.compress(m[i].zmm());
+}
+#endif // __AVX512BW__
+
+} // anonymous namespace
+#endif // __AVX2__
+
+vector<RensaResult> BitFieldBatch::simulate()
+{
+    vector<RensaResult> results(fields_.size());
+    simulate(fields_.data(), fields_.size(), results.data());
+    return results;
+}
+
+vector<int> BitFieldBatch::simulateFast()
+{
+    vector<int> chains(fields_.size());
+    simulateFast(fields_.data(), fields_.size(), chains.data());
+    return chains;
+}
+
+// static
+void BitFieldBatch::simulate(BitField* fields, size_t size, RensaResult* results)
+{
+#if defined(__AVX512BW__)
+    simulateInLockstep<FieldBits512, true>(fields, size, results, nullptr);
+#elif defined(__AVX2__)
+    simulateInLockstep<FieldBits256, true>(fields, size, results, nullptr);
+#else
+    for (size_t i = 0; i < size; ++i)
+        results[i] = fields[i].simulate();
+#endif
+}
+
+// static
+void BitFieldBatch::simulateFast(BitField* fields, size_t size, int* chains)
+{
+#if defined(__AVX512BW__)
+    simulateInLockstep<FieldBits512, false>(fields, size, nullptr, chains);
+#elif defined(__AVX2__)
+    simulateInLockstep<FieldBits256, false>(fields, size, nullptr, chains);
+#else
+    for (size_t i = 0; i < size; ++i) {
+        RensaNonTracker tracker;
+        chains[i] = fields[i].simulateFast(&tracker);
+    }
+#endif
+}
+
+#ifdef __AVX2__
+// static
+template<typename Bits, bool scoring>
+void BitFieldBatch::simulateInLockstep(BitField* fields, size_t size, RensaResult* results, int* chains)
+{
+    const int NUM_LANES = sizeof(Bits) / sizeof(FieldBits);
+
+    struct Lane {
+        bool active = false;
+        size_t index = 0;
+        int currentChain = 1;
+        int score = 0;
+        int frames = 0;
+        bool quick = false;
+        BitField escaped;
+    };
+
+    Lane lanes[NUM_LANES];
+    Bits m[3];
+    size_t next = 0;
+
+    auto load = [&](int lane) {
+        if (next >= size)
+            return;
+
+        BitField& bf = fields[next];
+        lanes[lane] = Lane();
+        lanes[lane].active = true;
+        lanes[lane].index = next++;
+        lanes[lane].escaped = bf.escapeInvisible();
+        for (int i = 0; i < 3; ++i)
+            setLaneBits(&m[i], lane, bf.m_[i]);
+    };
+
+    auto finish = [&](int lane) {
+        Lane& l = lanes[lane];
+        BitField& bf = fields[l.index];
+        for (int i = 0; i < 3; ++i) {
+            bf.m_[i] = laneBits(m[i], lane);
+            setLaneBits(&m[i], lane, FieldBits());
+        }
+        bf.recoverInvisible(l.escaped);
+
+        if (scoring)
+            results[l.index] = RensaResult(l.currentChain - 1, l.score, l.frames, l.quick);
+        else
+            chains[l.index] = l.currentChain - 1;
+        l.active = false;
+    };
+
+    for (int lane = 0; lane < NUM_LANES; ++lane)
+        load(lane);
+
+    auto anyActive = [&]() {
+        for (int lane = 0; lane < NUM_LANES; ++lane) {
+            if (lanes[lane].active)
+                return true;
+        }
+        return false;
+    };
+
+    while (anyActive()) {
+        Bits erased;
+        int numErasedPuyos[NUM_LANES] {};
+        int numColors[NUM_LANES] {};
+        int longBonusCoef[NUM_LANES] {};
+
+        for (PuyoColor c : NORMAL_PUYO_COLORS) {
+            Bits mask = colorBits(m, c).maskedField12();
+            Bits vanishing;
+            if (!mask.findVanishingBits(&vanishing))
+                continue;
+
+            erased.setAll(vanishing);
+            if (!scoring)
+                continue;
+
+            const auto counts = popcountLanes(vanishing);
+            for (int lane = 0; lane < NUM_LANES; ++lane) {
+                if (counts[lane] == 0)
+                    continue;
+
+                ++numColors[lane];
+                numErasedPuyos[lane] += counts[lane];
+                if (counts[lane] <= 7) {
+                    longBonusCoef[lane] += longBonus(counts[lane]);
+                    continue;
+                }
+
+                // slow path...
+                FieldBits laneMask = laneBits(mask, lane);
+                laneBits(vanishing, lane).iterateBitWithMasking([&](FieldBits x) -> FieldBits {
+                    FieldBits expanded = x.expand(laneMask);
+                    longBonusCoef[lane] += longBonus(expanded.popcount());
+                    return expanded;
+                });
+            }
+        }
+
+        bool vanished[NUM_LANES];
+        bool anyVanished = false;
+        for (int lane = 0; lane < NUM_LANES; ++lane) {
+            vanished[lane] = !laneBits(erased, lane).isEmpty();
+            anyVanished |= vanished[lane];
+            if (lanes[lane].active && !vanished[lane])
+                finish(lane);
+        }
+
+        if (anyVanished) {
+            // Removes ojama.
+            Bits ojamaErased = erased.expandEdge() & colorBits(m, PuyoColor::OJAMA).maskedField12();
+            erased.setAll(ojamaErased);
+
+            int maxDrops[NUM_LANES] {};
+            if (scoring)
+                calculateMaxDrops(m, erased, maxDrops);
+            dropAfterVanish(m, erased);
+
+            for (int lane = 0; lane < NUM_LANES; ++lane) {
+                if (!vanished[lane])
+                    continue;
+
+                Lane& l = lanes[lane];
+                if (scoring) {
+                    int colorBonusCoef = colorBonus(numColors[lane]);
+                    int rensaBonusCoef = calculateRensaBonusCoef(chainBonus(l.currentChain), longBonusCoef[lane], colorBonusCoef);
+                    l.score += 10 * numErasedPuyos[lane] * rensaBonusCoef;
+                    l.frames += FRAMES_VANISH_ANIMATION;
+                    if (maxDrops[lane] > 0) {
+                        l.frames += FRAMES_TO_DROP_FAST[maxDrops[lane]] + FRAMES_GROUNDING;
+                    } else {
+                        l.quick = true;
+                    }
+                }
+                l.currentChain += 1;
+            }
+        }
+
+        for (int lane = 0; lane < NUM_LANES; ++lane) {
+            if (!lanes[lane].active)
+                load(lane);
+        }
+    }
+}
+#endif // __AVX2__
@@ -0,0 +1,55 @@
+#ifndef CORE_BIT_FIELD_BATCH_H_
+#define CORE_BIT_FIELD_BATCH_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "core/bit_field.h"
+#include "core/rensa_result.h"
+
+// BitFieldBatch simulates rensa of several BitFields at once.
+//
+// When AVX2 is available, two fields are packed into one ymm register (the first one
+// is put on LOW, and the second one is put on HIGH, the same layout as FieldBits256),
+// and vanish/drop steps run in lockstep. When AVX-512 is available, four fields are
+// packed into one zmm register in the same way (FieldBits512). When the rensa of a field has finished,
+// the field drops out of the batch, and the next pending field takes over its lane.
+// Without AVX2, each field is simulated one by one.
+//
+// Like BitField::simulate(), the fields are modified to be the field after rensa.
+class BitFieldBatch {
+public:
+    BitFieldBatch() {}
+    explicit BitFieldBatch(std::vector<BitField> fields) : fields_(std::move(fields)) {}
+
+    void add(const BitField& bf) { fields_.push_back(bf); }
+    void clear() { fields_.clear(); }
+
+    size_t size() const { return fields_.size(); }
+    bool empty() const { return fields_.empty(); }
+
+    BitField& field(size_t i) { return fields_[i]; }
+    const BitField& field(size_t i) const { return fields_[i]; }
+
+    // Simulates all the fields. The i-th result corresponds to field(i).
+    std::vector<RensaResult> simulate();
+    // Faster version of simulate(). Returns the number of chains of each field.
+    std::vector<int> simulateFast();
+
+    // Same as simulate() and simulateFast(), but takes an array of BitField.
+    // |results| and |chains| must have |size| spaces.
+    static void simulate(BitField* fields, size_t size, RensaResult* results);
+    static void simulateFast(BitField* fields, size_t size, int* chains);
+
+private:
+#ifdef __AVX2__
+    // |Bits| is FieldBits256 or FieldBits512.
+    template<typename Bits, bool scoring>
+    static void simulateInLockstep(BitField* fields, size_t size, RensaResult* results, int* chains);
+#endif
+
+    std::vector<BitField> fields_;
+};
+
+#endif // CORE_BIT_FIELD_BATCH_H_
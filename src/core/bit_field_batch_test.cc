@@ -0,0 +1,124 @@
+#include "core/bit_field_batch.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/bit_field.h"
+#include "core/rensa_result.h"
+
+using namespace std;
+
+namespace {
+
+vector<BitField> makeFields()
+{
+    return vector<BitField> {
+        BitField(),
+        BitField(".BBBB."),
+        BitField(".RBRB."
+                 "RBRBR."
+                 "RBRBR."
+                 "RBRBRR"),
+        BitField("YYYYYY"
+                 "BBBBBB"),
+        BitField("..BB.."
+                 "..GGB."
+                 ".GYYG."
+                 ".BBBYB"
+                 "RRRRBY"),
+        BitField(".YGGY."
+                 "BBBBBB"
+                 "GYBBYG"
+                 "BBBBBB"),
+        BitField(".G.BRG"
+                 "GBRRYR"
+                 "RRYYBY"
+                 "RGYRBR"
+                 "YGYRBY"
+                 "YGBGYR"
+                 "GRBGYR"
+                 "BRBYBY"
+                 "RYYBYY"
+                 "BRBYBR"
+                 "BGBYRR"
+                 "YGBGBG"
+                 "RBGBGG"),
+        BitField("R....." // 14
+                 "R....." // 13
+                 "O....."
+                 "R....."
+                 "R....."
+                 "B....."
+                 "BB...."),
+        BitField("OOOOOR"
+                 "OORRRR" // 12
+                 "OOOOOO"
+                 "OOOOOO"
+                 "OOOOOO"
+                 "OOOOOO" // 8
+                 "OOOOOO"
+                 "OOOOOO"
+                 "OOOOOO"
+                 "OOOOOO" // 4
+                 "OOOOOO"
+                 "OOOOOO"
+                 "OOOOOO"),
+    };
+}
+
+} // anonymous namespace
+
+TEST(BitFieldBatchTest, simulate)
+{
+    const vector<BitField> originals = makeFields();
+
+    // Try every batch size so that lanes are refilled at different timings.
+    for (size_t n = 0; n <= originals.size(); ++n) {
+        BitFieldBatch batch(vector<BitField>(originals.begin(), originals.begin() + n));
+        vector<RensaResult> results = batch.simulate();
+        ASSERT_EQ(n, results.size());
+
+        for (size_t i = 0; i < n; ++i) {
+            BitField expectedField(originals[i]);
+            RensaResult expected = expectedField.simulate();
+
+            EXPECT_EQ(expected, results[i]) << originals[i].toDebugString();
+            EXPECT_EQ(expectedField, batch.field(i)) << originals[i].toDebugString();
+        }
+    }
+}
+
+TEST(BitFieldBatchTest, simulateFast)
+{
+    const vector<BitField> originals = makeFields();
+
+    for (size_t n = 0; n <= originals.size(); ++n) {
+        BitFieldBatch batch(vector<BitField>(originals.begin(), originals.begin() + n));
+        vector<int> chains = batch.simulateFast();
+        ASSERT_EQ(n, chains.size());
+
+        for (size_t i = 0; i < n; ++i) {
+            BitField expectedField(originals[i]);
+            RensaNonTracker tracker;
+            int expected = expectedField.simulateFast(&tracker);
+
+            EXPECT_EQ(expected, chains[i]) << originals[i].toDebugString();
+            EXPECT_EQ(expectedField, batch.field(i)) << originals[i].toDebugString();
+        }
+    }
+}
+
+TEST(BitFieldBatchTest, simulateArray)
+{
+    vector<BitField> fields = makeFields();
+    vector<RensaResult> results(fields.size());
+
+    BitFieldBatch::simulate(fields.data(), fields.size(), results.data());
+
+    vector<BitField> originals = makeFields();
+    for (size_t i = 0; i < fields.size(); ++i) {
+        EXPECT_EQ(originals[i].simulate(), results[i]);
+        EXPECT_EQ(originals[i], fields[i]);
+    }
+}
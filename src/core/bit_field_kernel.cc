@@ -0,0 +1,98 @@
+#include "core/bit_field_kernel.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "base/cpu_feature.h"
+
+DEFINE_string(bit_field_kernel, "auto", "BitField simulation kernel: auto, sse41, avx2, or avx2_nopext");
+
+using namespace std;
+
+namespace {
+
+RensaResult simulateSSE41(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->simulate(context, &tracker);
+}
+
+int simulateFastSSE41(BitField* bf)
+{
+    RensaNonTracker tracker;
+    return bf->simulateFast(&tracker);
+}
+
+RensaStepResult vanishDropSSE41(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->vanishDrop(context, &tracker);
+}
+
+bool vanishDropFastSSE41(BitField* bf, BitFieldKernel::SimulationContext* context)
+{
+    RensaNonTracker tracker;
+    return bf->vanishDropFast(context, &tracker);
+}
+
+const BitFieldKernel SSE41_KERNEL {
+    "sse41",
+    simulateSSE41,
+    simulateFastSSE41,
+    vanishDropSSE41,
+    vanishDropFastSSE41,
+};
+
+const BitFieldKernel* selectKernel()
+{
+    if (FLAGS_bit_field_kernel != "auto") {
+        const BitFieldKernel* kernel = BitFieldKernel::find(FLAGS_bit_field_kernel);
+        CHECK(kernel) << "bit_field_kernel " << FLAGS_bit_field_kernel << " is not available on this CPU";
+        return kernel;
+    }
+
+    // Decided only by the CPU, so that the same binary always uses the same kernel on the same CPU.
+    const BitFieldKernel* kernel = &SSE41_KERNEL;
+    if (cpu_feature::hasAVX2() && cpu_feature::hasBMI2()) {
+        const BitFieldKernel* avx2Kernel = cpu_feature::hasSlowPDEP() ? avx2NoPextBitFieldKernel() : avx2BitFieldKernel();
+        if (avx2Kernel)
+            kernel = avx2Kernel;
+    }
+
+    VLOG(1) << "bit_field_kernel: " << kernel->name;
+    return kernel;
+}
+
+} // anonymous namespace
+
+// static
+const BitFieldKernel& BitFieldKernel::current()
+{
+    static const BitFieldKernel* s_kernel = selectKernel();
+    return *s_kernel;
+}
+
+// static
+vector<const BitFieldKernel*> BitFieldKernel::availableKernels()
+{
+    vector<const BitFieldKernel*> kernels { &SSE41_KERNEL };
+    if (cpu_feature::hasAVX2() && cpu_feature::hasBMI2()) {
+        if (avx2BitFieldKernel())
+            kernels.push_back(avx2BitFieldKernel());
+        if (avx2NoPextBitFieldKernel())
+            kernels.push_back(avx2NoPextBitFieldKernel());
+    }
+
+    return kernels;
+}
+
+// static
+const BitFieldKernel* BitFieldKernel::find(const string& name)
+{
+    for (const BitFieldKernel* kernel : availableKernels()) {
+        if (name == kernel->name)
+            return kernel;
+    }
+
+    return nullptr;
+}
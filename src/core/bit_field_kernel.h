@@ -0,0 +1,43 @@
+#ifndef CORE_BIT_FIELD_KERNEL_H_
+#define CORE_BIT_FIELD_KERNEL_H_
+
+#include <string>
+#include <vector>
+
+#include "core/bit_field.h"
+#include "core/rensa_result.h"
+
+// BitFieldKernel is a set of BitField simulation functions compiled for a specific instruction set.
+//
+// A kernel is chosen at runtime by probing the CPU, so a binary built with PUYOAI_PORTABLE
+// can use AVX2 on the CPUs that have it, and still runs on the CPUs that don't.
+// On the CPUs where PDEP/PEXT are microcoded (AMD before Zen3), the kernel that doesn't use
+// them is chosen.
+// --bit_field_kernel can force a specific kernel.
+//
+// BitField and CoreField dispatch to the chosen kernel only in a PUYOAI_PORTABLE build, and
+// only when RensaNonTracker is used. Otherwise, the kernel chosen at compile time is inlined.
+struct BitFieldKernel {
+    typedef BitField::SimulationContext SimulationContext;
+
+    // Returns the kernel to be used. This is decided at the first call.
+    static const BitFieldKernel& current();
+    // Returns all the kernels the running CPU can use.
+    static std::vector<const BitFieldKernel*> availableKernels();
+    // Returns the kernel named |name|. nullptr if no such kernel is available.
+    static const BitFieldKernel* find(const std::string& name);
+
+    const char* name;
+    RensaResult (*simulate)(BitField*, SimulationContext*);
+    int (*simulateFast)(BitField*);
+    RensaStepResult (*vanishDrop)(BitField*, SimulationContext*);
+    bool (*vanishDropFast)(BitField*, SimulationContext*);
+};
+
+// Returns the kernel that uses AVX2 and BMI2. nullptr if it's not compiled in.
+// Defined in bit_field_avx2.cc.
+const BitFieldKernel* avx2BitFieldKernel();
+// Same as avx2BitFieldKernel(), but the kernel doesn't use PDEP/PEXT to drop puyos.
+const BitFieldKernel* avx2NoPextBitFieldKernel();
+
+#endif // CORE_BIT_FIELD_KERNEL_H_
@@ -0,0 +1,114 @@
+#include "core/bit_field_kernel.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/bit_field.h"
+
+using namespace std;
+
+namespace {
+
+const BitField TEST_FIELDS[] = {
+    BitField(),
+    BitField(".BBBB."),
+    BitField(".RBRB."
+             "RBRBR."
+             "RBRBR."
+             "RBRBRR"),
+    BitField(".YGGY."
+             "BBBBBB"
+             "GYBBYG"
+             "BBBBBB"),
+    BitField(".G.BRG"
+             "GBRRYR"
+             "RRYYBY"
+             "RGYRBR"
+             "YGYRBY"
+             "YGBGYR"
+             "GRBGYR"
+             "BRBYBY"
+             "RYYBYY"
+             "BRBYBR"
+             "BGBYRR"
+             "YGBGBG"
+             "RBGBGG"),
+    BitField("R....." // 14
+             "R....." // 13
+             "O....."
+             "R....."
+             "R....."
+             "B....."
+             "BB...."),
+};
+
+} // anonymous namespace
+
+TEST(BitFieldKernelTest, availableKernels)
+{
+    vector<const BitFieldKernel*> kernels = BitFieldKernel::availableKernels();
+    ASSERT_FALSE(kernels.empty());
+    EXPECT_STREQ("sse41", kernels.front()->name);
+
+    EXPECT_EQ(kernels.front(), BitFieldKernel::find("sse41"));
+    EXPECT_EQ(nullptr, BitFieldKernel::find("unknown"));
+
+#if defined(__AVX2__) && defined(__BMI2__)
+    EXPECT_NE(nullptr, BitFieldKernel::find("avx2"));
+#endif
+}
+
+TEST(BitFieldKernelTest, simulate)
+{
+    for (const BitFieldKernel* kernel : BitFieldKernel::availableKernels()) {
+        for (const BitField& original : TEST_FIELDS) {
+            BitField expectedField(original);
+            BitField::SimulationContext expectedContext;
+            RensaNonTracker tracker;
+            RensaResult expected = expectedField.simulate(&expectedContext, &tracker);
+
+            BitField actualField(original);
+            BitField::SimulationContext context;
+            EXPECT_EQ(expected, kernel->simulate(&actualField, &context)) << kernel->name << '\n' << original;
+            EXPECT_EQ(expectedField, actualField) << kernel->name << '\n' << original;
+
+            BitField fastField(original);
+            EXPECT_EQ(expected.chains, kernel->simulateFast(&fastField)) << kernel->name << '\n' << original;
+            EXPECT_EQ(expectedField, fastField) << kernel->name << '\n' << original;
+        }
+    }
+}
+
+TEST(BitFieldKernelTest, vanishDrop)
+{
+    for (const BitFieldKernel* kernel : BitFieldKernel::availableKernels()) {
+        for (const BitField& original : TEST_FIELDS) {
+            BitField expectedField(original);
+            BitField::SimulationContext expectedContext;
+            RensaNonTracker tracker;
+
+            BitField actualField(original);
+            BitField::SimulationContext context;
+            BitField fastField(original);
+            BitField::SimulationContext fastContext;
+
+            while (true) {
+                RensaStepResult expected = expectedField.vanishDrop(&expectedContext, &tracker);
+                RensaStepResult actual = kernel->vanishDrop(&actualField, &context);
+                bool fastVanished = kernel->vanishDropFast(&fastField, &fastContext);
+
+                EXPECT_EQ(expected.score, actual.score) << kernel->name << '\n' << original;
+                EXPECT_EQ(expected.frames, actual.frames) << kernel->name << '\n' << original;
+                EXPECT_EQ(expected.quick, actual.quick) << kernel->name << '\n' << original;
+                EXPECT_EQ(expected.score > 0, fastVanished) << kernel->name << '\n' << original;
+                EXPECT_EQ(expectedField, actualField) << kernel->name << '\n' << original;
+                EXPECT_EQ(expectedField, fastField) << kernel->name << '\n' << original;
+                if (expected.score == 0)
+                    break;
+            }
+            EXPECT_EQ(expectedContext.currentChain, context.currentChain);
+            EXPECT_EQ(expectedContext.currentChain, fastContext.currentChain);
+        }
+    }
+}
@@ -1,9 +1,19 @@
 #include "core/bit_field.h"
 
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "base/base.h"
+#include "base/time.h"
 #include "base/time_stamp_counter.h"
+#include "core/bit_field_batch.h"
+#include "core/bit_field_kernel.h"
+#include "core/core_field.h"
+#include "core/field_bits_256.h"
+#include "core/field_bits_512.h"
 
 using namespace std;
 
@@ -148,3 +158,199 @@ TEST(BitFieldPerformanceTest, bitfield_simulate_fast_avx2_filled)
     tsc.showStatistics();
 }
 #endif // defined(__AVX2__) && defined(__BMI2__)
+
+#ifdef __AVX512BW__
+// Finds the vanishing bits of 4 colors with 2 FieldBits256 (AVX2) and with 1 FieldBits512 (AVX-512).
+TEST(BitFieldPerformanceTest, fieldbits_find_vanishing_bits_256_512)
+{
+    const int N = 1000000;
+
+    BitField bf(
+        ".G.BRG"
+        "GBRRYR"
+        "RRYYBY"
+        "RGYRBR"
+        "YGYRBY"
+        "YGBGYR"
+        "GRBGYR"
+        "BRBYBY"
+        "RYYBYY"
+        "BRBYBR"
+        "BGBYRR"
+        "YGBGBG"
+        "RBGBGG");
+
+    FieldBits red = bf.bits(PuyoColor::RED).maskedField12();
+    FieldBits blue = bf.bits(PuyoColor::BLUE).maskedField12();
+    FieldBits yellow = bf.bits(PuyoColor::YELLOW).maskedField12();
+    FieldBits green = bf.bits(PuyoColor::GREEN).maskedField12();
+
+    TimeStampCounterData tsc256;
+    TimeStampCounterData tsc512;
+
+    for (int i = 0; i < N; ++i) {
+        FieldBits256 redBlue(red, blue);
+        FieldBits256 yellowGreen(yellow, green);
+        FieldBits256 v1, v2;
+        ScopedTimeStampCounter stsc(&tsc256);
+        EXPECT_TRUE(redBlue.findVanishingBits(&v1) | yellowGreen.findVanishingBits(&v2));
+    }
+
+    for (int i = 0; i < N; ++i) {
+        FieldBits512 colors(red, blue, yellow, green);
+        FieldBits512 v;
+        ScopedTimeStampCounter stsc(&tsc512);
+        EXPECT_TRUE(colors.findVanishingBits(&v));
+    }
+
+    cout << "FieldBits256 x 2:" << endl;
+    tsc256.showStatistics();
+    cout << "FieldBits512:" << endl;
+    tsc512.showStatistics();
+}
+#endif // __AVX512BW__
+
+TEST(BitFieldPerformanceTest, bitfield_simulate_kernels_filled)
+{
+    const int N = 1000000;
+
+    BitField bfOriginal(
+        ".G.BRG"
+        "GBRRYR"
+        "RRYYBY"
+        "RGYRBR"
+        "YGYRBY"
+        "YGBGYR"
+        "GRBGYR"
+        "BRBYBY"
+        "RYYBYY"
+        "BRBYBR"
+        "BGBYRR"
+        "YGBGBG"
+        "RBGBGG");
+
+    for (const BitFieldKernel* kernel : BitFieldKernel::availableKernels()) {
+        TimeStampCounterData tsc;
+        TimeStampCounterData tscFast;
+
+        for (int i = 0; i < N; i++) {
+            BitField bf(bfOriginal);
+            BitField::SimulationContext context;
+            ScopedTimeStampCounter stsc(&tsc);
+            EXPECT_EQ(19, kernel->simulate(&bf, &context).chains);
+        }
+
+        for (int i = 0; i < N; i++) {
+            BitField bf(bfOriginal);
+            ScopedTimeStampCounter stsc(&tscFast);
+            EXPECT_EQ(19, kernel->simulateFast(&bf));
+        }
+
+        cout << "simulate (" << kernel->name << "):" << endl;
+        tsc.showStatistics();
+        cout << "simulateFast (" << kernel->name << "):" << endl;
+        tscFast.showStatistics();
+    }
+}
+
+namespace {
+
+vector<BitField> makeBatchFields()
+{
+    const BitField filled(
+        ".G.BRG"
+        "GBRRYR"
+        "RRYYBY"
+        "RGYRBR"
+        "YGYRBY"
+        "YGBGYR"
+        "GRBGYR"
+        "BRBYBY"
+        "RYYBYY"
+        "BRBYBR"
+        "BGBYRR"
+        "YGBGBG"
+        "RBGBGG");
+    const BitField easy(
+        ".RBRB."
+        "RBRBR."
+        "RBRBR."
+        "RBRBRR");
+    const BitField evil(
+        "..BB.."
+        "..GGB."
+        ".GYYG."
+        ".BBBYB"
+        "RRRRBY");
+
+    return vector<BitField> { filled, easy, filled, evil, filled, easy, filled, evil };
+}
+
+} // anonymous namespace
+
+// Compares simulating fields one by one (as CoreField does) with BitFieldBatch.
+TEST(BitFieldPerformanceTest, bitfield_simulate_batch)
+{
+    const int N = 100000;
+    const vector<BitField> originals = makeBatchFields();
+
+    long long totalChains = 0;
+    double sequentialBegin = currentTime();
+    for (int i = 0; i < N; ++i) {
+        for (const BitField& original : originals) {
+            CoreField cf(original);
+            totalChains += cf.simulate().chains;
+        }
+    }
+    double sequentialTime = currentTime() - sequentialBegin;
+
+    vector<BitField> fields(originals.size());
+    vector<RensaResult> results(originals.size());
+    long long totalBatchChains = 0;
+    double batchBegin = currentTime();
+    for (int i = 0; i < N; ++i) {
+        copy(originals.begin(), originals.end(), fields.begin());
+        BitFieldBatch::simulate(fields.data(), fields.size(), results.data());
+        for (const RensaResult& result : results)
+            totalBatchChains += result.chains;
+    }
+    double batchTime = currentTime() - batchBegin;
+
+    EXPECT_EQ(totalChains, totalBatchChains);
+
+    cout << "sequential: " << (totalChains / sequentialTime) << " chains/sec" << endl;
+    cout << "     batch: " << (totalBatchChains / batchTime) << " chains/sec" << endl;
+}
+
+TEST(BitFieldPerformanceTest, bitfield_simulate_fast_batch)
+{
+    const int N = 100000;
+    const vector<BitField> originals = makeBatchFields();
+
+    long long totalChains = 0;
+    double sequentialBegin = currentTime();
+    for (int i = 0; i < N; ++i) {
+        for (const BitField& original : originals) {
+            CoreField cf(original);
+            totalChains += cf.simulateFast();
+        }
+    }
+    double sequentialTime = currentTime() - sequentialBegin;
+
+    vector<BitField> fields(originals.size());
+    vector<int> chains(originals.size());
+    long long totalBatchChains = 0;
+    double batchBegin = currentTime();
+    for (int i = 0; i < N; ++i) {
+        copy(originals.begin(), originals.end(), fields.begin());
+        BitFieldBatch::simulateFast(fields.data(), fields.size(), chains.data());
+        for (int c : chains)
+            totalBatchChains += c;
+    }
+    double batchTime = currentTime() - batchBegin;
+
+    EXPECT_EQ(totalChains, totalBatchChains);
+
+    cout << "sequential: " << (totalChains / sequentialTime) << " chains/sec" << endl;
+    cout << "     batch: " << (totalBatchChains / batchTime) << " chains/sec" << endl;
+}
@@ -4,9 +4,12 @@
 #include <glog/logging.h>
 
 #include "base/base.h"
+#include "base/time.h"
+#include "base/trace.h"
 #include "core/core_field.h"
 #include "core/decision.h"
 #include "core/field_pretty_printer.h"
+#include "core/frame.h"
 #include "core/frame_request.h"
 #include "core/frame_response.h"
 #include "core/kumipuyo.h"
@@ -17,6 +20,14 @@
 
 using namespace std;
 
+namespace {
+
+// The time to decide the hand [s]. See the comment of AI::think().
+const double THINK_BUDGET = 0.3;
+const double FAST_THINK_BUDGET = 0.03;
+
+}
+
 struct DecisionSending {
     void clear()
     {
@@ -47,7 +58,13 @@ AI::AI(const string& name) :
     desynced_(false),
     rethinkRequested_(false),
     enemyDecisionRequestFrameId_(0),
-    behaviorRethinkAfterOpponentRensa_(false)
+    currentFrameId_(-1),
+    currentFrameTime_(0.0),
+    behaviorRethinkAfterOpponentRensa_(false),
+    behaviorPonder_(false),
+    waitingNextThink_(false),
+    ponderingFrameId_(0),
+    numEndedGames_(0)
 {
 }
 
@@ -66,9 +83,15 @@ void AI::runLoop()
     // nextThinkFrameId is frameId in which the decision of think() is sent.
     int nextThinkFrameId = 0;
 
+    Tracer::setThreadName(name_);
+
     while (true) {
         google::FlushLogFiles(google::INFO);
 
+        // Pondering might have been stopped to handle the previous frame request.
+        if (behaviorPonder_ && waitingNextThink_ && !ponderer_.isStarted())
+            startPondering();
+
         FrameRequest frameRequest;
         if (!connector_->receive(&frameRequest)) {
             if (connector_->isClosed()) {
@@ -79,11 +102,22 @@ void AI::runLoop()
             break;
         }
 
+        TRACE_SCOPE("AI::handleFrameRequest");
+        currentFrameId_ = frameRequest.frameId;
+        currentFrameTime_ = currentTime();
+
         if (!frameRequest.isValid()) {
             connector_->send(FrameResponse(frameRequest.frameId));
             continue;
         }
 
+        // ponder() should not run concurrently with think(), gaze() and callbacks.
+        if (frameRequest.hasGameEnd() || frameRequest.shouldInitialize() ||
+            frameRequest.myPlayerFrameRequest().event.hasEventState() ||
+            frameRequest.enemyPlayerFrameRequest().event.hasEventState()) {
+            ponderer_.stop();
+        }
+
         if (frameRequest.hasGameEnd()) {
             gameHasEnded(frameRequest);
         }
@@ -137,6 +171,7 @@ void AI::runLoop()
             }
 
             next1.fieldBeforeThink = me_.field;
+            waitingNextThink_ = false;
             next1.dropDecision = think(nextThinkFrameId, me_.field, seq,
                                        myPlayerState(), enemyPlayerState(), false);
 
@@ -167,6 +202,7 @@ void AI::runLoop()
             VLOG(1) << "REQUEST_AGAIN";
             DCHECK(!frameRequest.myPlayerFrameRequest().event.decisionRequest)
                 << "decisionRequestAgain should not come with decisionRequest.";
+            waitingNextThink_ = false;
             DropDecision dropDecision = think(frameRequest.frameId,
                                               CoreField(frameRequest.myPlayerFrameRequest().field),
                                               frameRequest.myPlayerFrameRequest().kumipuyoSeq,
@@ -213,6 +249,7 @@ void AI::runLoop()
             CHECK_EQ(kumipuyoSeq.get(0), seq.get(0));
             CHECK_EQ(kumipuyoSeq.get(1), seq.get(1));
 
+            waitingNextThink_ = false;
             next1.dropDecision = think(frameRequest.frameId, me_.field, seq, myPlayerState(), enemyPlayerState(), true);
             next1.kumipuyo = kumipuyoSeq.get(0);
             next1.ready = true;
@@ -236,16 +273,56 @@ void AI::runLoop()
             me_.field.simulate();
         }
         next1.clear();
+
+        // We can ponder the next hand until the next think().
+        waitingNextThink_ = true;
+        ponderingFrameId_ = nextThinkFrameId;
+        ponderingProvidedSeq_ = frameRequest.myPlayerFrameRequest().kumipuyoSeq.subsequence(1);
     }
 
+    ponderer_.stop();
+
     LOG(INFO) << "will exit run loop";
 }
 
+double AI::thinkDeadline(int frameId, bool fast) const
+{
+    const double budget = fast ? FAST_THINK_BUDGET : THINK_BUDGET;
+    if (currentFrameId_ < 0)
+        return currentTime() + budget;
+
+    // We can think until |frameId| comes. One frame is left to send the decision.
+    double untilFrameId = static_cast<double>(frameId - currentFrameId_ - 1) / FPS;
+    return currentFrameTime_ + std::max(budget, untilFrameId);
+}
+
 void AI::gaze(int frameId, const CoreField&, const KumipuyoSeq&)
 {
     UNUSED_VARIABLE(frameId);
 }
 
+void AI::ponder(int frameId, const CoreField&, const KumipuyoSeq&,
+                const PlayerState&, const PlayerState&, const Deadline&)
+{
+    UNUSED_VARIABLE(frameId);
+}
+
+void AI::startPondering()
+{
+    // The same sequence as think() will be called with.
+    KumipuyoSeq seq = rememberedSequence(me_.hand + 1, ponderingProvidedSeq_);
+    if (seq.size() < 2)
+        return;
+
+    int frameId = ponderingFrameId_;
+    CoreField field(me_.field);
+    PlayerState me(me_);
+    PlayerState enemy(enemy_);
+    ponderer_.start([this, frameId, field, seq, me, enemy](const Deadline& deadline) {
+        ponder(frameId, field, seq, me, enemy, deadline);
+    });
+}
+
 void AI::gameWillBegin(const FrameRequest& frameRequest)
 {
     me_.clear();
@@ -255,13 +332,20 @@ void AI::gameWillBegin(const FrameRequest& frameRequest)
 
     rethinkRequested_ = false;
     enemyDecisionRequestFrameId_ = 0;
+    waitingNextThink_ = false;
 
     onGameWillBegin(frameRequest);
 }
 
 void AI::gameHasEnded(const FrameRequest& frameRequest)
 {
+    waitingNextThink_ = false;
     onGameHasEnded(frameRequest);
+
+    // The trace is written per game.
+    ++numEndedGames_;
+    if (Tracer::isEnabled())
+        Tracer::flush(name_ + "-game" + to_string(numEndedGames_));
 }
 
 void AI::preDecisionRequestedForMe(const FrameRequest& frameRequest)
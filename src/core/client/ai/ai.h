@@ -6,6 +6,7 @@
 
 #include "core/client/ai/ai_base.h"
 #include "core/client/ai/drop_decision.h"
+#include "core/client/ai/ponderer.h"
 #include "core/client/client_connector.h"
 #include "core/kumipuyo_seq.h"
 #include "core/player_state.h"
@@ -25,6 +26,8 @@ public:
 
     // Set AI's behavior. If true, you can rethink next decision when the enemy has started his rensa.
     void setBehaviorRethinkAfterOpponentRensa(bool flag) { behaviorRethinkAfterOpponentRensa_ = flag; }
+    // Set AI's behavior. If true, ponder() will be called while AI is waiting for the next think().
+    void setBehaviorPonder(bool flag) { behaviorPonder_ = flag; }
 
 protected:
     AI(int argc, char* argv[], const std::string& name);
@@ -54,6 +57,18 @@ protected:
     // much time for gaze.
     virtual void gaze(int frameId, const CoreField& enemyField, const KumipuyoSeq&);
 
+    // ponder will be called on a worker thread while AI is waiting for the next think(),
+    // e.g. during the enemy's moves or the chain animations, if you set behavior.
+    // The arguments are the predicted arguments of the next think(). Since NEXT2 might not
+    // have appeared yet, the prediction is made only when the rest of the sequence is remembered
+    // (e.g. the enemy has already seen it).
+    // You should search until |deadline| expires, and leave the (partial) result for think().
+    // ponder() is stopped before think(), gaze() or any callback is called, so ponder() doesn't
+    // run concurrently with them. After it has been stopped, ponder() might be called again
+    // with the (updated) prediction.
+    virtual void ponder(int frameId, const CoreField&, const KumipuyoSeq&,
+                        const PlayerState& me, const PlayerState& enemy, const Deadline&);
+
     // ----------------------------------------------------------------------
     // Callbacks. If you'd like to customize your AI, it is good if you could use
     // the following hook methods.
@@ -79,6 +94,12 @@ protected:
     // Should rethink just before sending next decision.
     void requestRethink() { rethinkRequested_ = true; }
 
+    // Returns the time (comparable with currentTime()) until which think(frameId, ..., fast)
+    // can use to decide the hand. This is the budget described in think() from when the current
+    // frame request has been received, or longer if |frameId| is later than that.
+    // When no frame request has been received, the budget is counted from now.
+    double thinkDeadline(int frameId, bool fast) const;
+
     // ----------------------------------------------------------------------
     // Usually, you don't need to care about methods below here.
 
@@ -129,6 +150,9 @@ private:
     // Returns the remembered sequence. If desynced, provided is returned as is.
     KumipuyoSeq rememberedSequence(int indexFrom, const KumipuyoSeq& provided) const;
 
+    // Starts ponder() with the predicted arguments of the next think().
+    void startPondering();
+
     std::string name_;
     std::unique_ptr<ClientConnector> connector_;
 
@@ -137,10 +161,25 @@ private:
     bool rethinkRequested_;
     int enemyDecisionRequestFrameId_;
 
+    // The frame id of the frame request we're handling, and the time when it has been received.
+    int currentFrameId_;
+    double currentFrameTime_;
+
     PlayerState me_;
     PlayerState enemy_;
 
     bool behaviorRethinkAfterOpponentRensa_;
+    bool behaviorPonder_;
+
+    Ponderer ponderer_;
+    // True after we've sent a decision, until the next think() is called.
+    bool waitingNextThink_;
+    // The predicted frameId of the next think().
+    int ponderingFrameId_;
+    // The sequence provided with the last decision request, without the current kumipuyo.
+    KumipuyoSeq ponderingProvidedSeq_;
+
+    int numEndedGames_;
 };
 
 #endif // CORE_CLIENT_AI_AI_H_
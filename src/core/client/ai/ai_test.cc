@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include "base/time.h"
 #include "core/core_field.h"
 #include "core/decision.h"
 #include "core/frame_request.h"
@@ -19,6 +20,7 @@ public:
     using AI::puyoErasedForEnemy;
     using AI::groundedForEnemy;
     using AI::decisionRequestedForEnemy;
+    using AI::thinkDeadline;
 
 protected:
     virtual DropDecision think(int, const CoreField&, const KumipuyoSeq&,
@@ -27,6 +29,21 @@ protected:
         return DropDecision(Decision(3, 0), "test");
     }
 
+    virtual void ponder(int frameId, const CoreField& field, const KumipuyoSeq& seq,
+                        const PlayerState&, const PlayerState&, const Deadline&) override
+    {
+        ++numPondered;
+        ponderedFrameId = frameId;
+        ponderedField = field;
+        ponderedSeq = seq;
+    }
+
+public:
+    int numPondered = 0;
+    int ponderedFrameId = 0;
+    CoreField ponderedField;
+    KumipuyoSeq ponderedSeq;
+
 private:
     static const char* argv[];
 };
@@ -43,6 +60,22 @@ protected:
         return AI::mergeField(ours, provided, ojamaDropped);
     }
 
+    void startPondering(int frameId, const KumipuyoSeq& providedSeq)
+    {
+        ai_.ponderingFrameId_ = frameId;
+        ai_.ponderingProvidedSeq_ = providedSeq;
+        ai_.startPondering();
+    }
+
+    void stopPondering() { ai_.ponderer_.stop(); }
+    PlayerState* mutableMyPlayerState() { return ai_.mutableMyPlayerState(); }
+
+    void setCurrentFrame(int frameId, double time)
+    {
+        ai_.currentFrameId_ = frameId;
+        ai_.currentFrameTime_ = time;
+    }
+
     const PlayerState& myPlayerState() { return ai_.myPlayerState(); }
     const PlayerState& enemyPlayerState() { return ai_.enemyPlayerState(); }
 
@@ -593,3 +626,47 @@ TEST_F(AITest, mergeFieldOjama)
     EXPECT_EQ(expected1, mergeField(original, provided1, true));
     EXPECT_EQ(expected2, mergeField(original, provided2, true));
 }
+
+TEST_F(AITest, thinkDeadline)
+{
+    // When no frame request has been received, the budget is counted from now.
+    double now = currentTime();
+    EXPECT_LE(now + 0.03, ai_.thinkDeadline(100, true));
+    EXPECT_LE(now + 0.3, ai_.thinkDeadline(100, false));
+
+    setCurrentFrame(10, 100.0);
+    EXPECT_DOUBLE_EQ(100.03, ai_.thinkDeadline(10, true));
+    EXPECT_DOUBLE_EQ(100.3, ai_.thinkDeadline(10, false));
+    EXPECT_DOUBLE_EQ(100.3, ai_.thinkDeadline(20, false));
+    // We can use the time until the frame 131 except one frame.
+    EXPECT_DOUBLE_EQ(102.0, ai_.thinkDeadline(131, true));
+    EXPECT_DOUBLE_EQ(102.0, ai_.thinkDeadline(131, false));
+}
+
+TEST_F(AITest, ponder)
+{
+    FrameRequest req;
+    req.frameId = 1;
+    ai_.gameWillBegin(req);
+
+    CoreField field(
+        "RR    "
+        "BB    ");
+    mutableMyPlayerState()->field = field;
+    mutableMyPlayerState()->hand = 1;
+    mutableMyPlayerState()->seq = KumipuyoSeq("RRBBYYGG");
+
+    // The next think() will be called with the sequence from the next kumipuyo.
+    startPondering(100, KumipuyoSeq("BBYY"));
+    stopPondering();
+    EXPECT_EQ(1, ai_.numPondered);
+    EXPECT_EQ(100, ai_.ponderedFrameId);
+    EXPECT_EQ(field, ai_.ponderedField);
+    EXPECT_EQ(KumipuyoSeq("YYGG"), ai_.ponderedSeq);
+
+    // We don't ponder when we don't know the next 2 kumipuyos.
+    mutableMyPlayerState()->seq = KumipuyoSeq("RRBBYY");
+    startPondering(200, KumipuyoSeq("BBYY"));
+    stopPondering();
+    EXPECT_EQ(1, ai_.numPondered);
+}
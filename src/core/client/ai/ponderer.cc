@@ -0,0 +1,34 @@
+#include "core/client/ai/ponderer.h"
+
+#include <utility>
+
+#include "base/trace.h"
+
+using namespace std;
+
+Ponderer::~Ponderer()
+{
+    stop();
+}
+
+void Ponderer::start(Task task)
+{
+    stop();
+
+    deadline_.reset(new Deadline);
+    const Deadline* deadline = deadline_.get();
+    thread_ = thread([task, deadline]() {
+        Tracer::setThreadName("ponderer");
+        task(*deadline);
+    });
+}
+
+void Ponderer::stop()
+{
+    if (!thread_.joinable())
+        return;
+
+    deadline_->cancel();
+    thread_.join();
+    deadline_.reset();
+}
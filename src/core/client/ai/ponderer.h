@@ -0,0 +1,37 @@
+#ifndef CORE_CLIENT_AI_PONDERER_H_
+#define CORE_CLIENT_AI_PONDERER_H_
+
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "base/deadline.h"
+#include "base/noncopyable.h"
+
+// Ponderer runs a task on a worker thread while AI is waiting for the next think().
+// The task should return soon after the given deadline has expired. The deadline is
+// expired by stop().
+// Ponderer is not thread-safe. start() and stop() should be called from the same thread.
+class Ponderer : noncopyable {
+public:
+    typedef std::function<void (const Deadline&)> Task;
+
+    Ponderer() {}
+    ~Ponderer();
+
+    // Starts |task| on a worker thread. If a task has been started, it's stopped first.
+    void start(Task task);
+    // Expires the deadline of the task, and waits until the task returns.
+    // Does nothing if no task has been started.
+    void stop();
+
+    // Returns true if a task has been started and not stopped yet.
+    // Note that this returns true even after the task has returned by itself.
+    bool isStarted() const { return thread_.joinable(); }
+
+private:
+    std::unique_ptr<Deadline> deadline_;
+    std::thread thread_;
+};
+
+#endif // CORE_CLIENT_AI_PONDERER_H_
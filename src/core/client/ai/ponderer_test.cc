@@ -0,0 +1,64 @@
+#include "core/client/ai/ponderer.h"
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(PondererTest, stop)
+{
+    Ponderer ponderer;
+    EXPECT_FALSE(ponderer.isStarted());
+
+    atomic<bool> started(false);
+    atomic<bool> returned(false);
+    ponderer.start([&](const Deadline& deadline) {
+        started = true;
+        while (!deadline.isExpired())
+            this_thread::yield();
+        returned = true;
+    });
+    EXPECT_TRUE(ponderer.isStarted());
+
+    while (!started)
+        this_thread::yield();
+    EXPECT_FALSE(returned);
+
+    ponderer.stop();
+    EXPECT_TRUE(returned);
+    EXPECT_FALSE(ponderer.isStarted());
+
+    // stop() can be called twice.
+    ponderer.stop();
+}
+
+TEST(PondererTest, restart)
+{
+    Ponderer ponderer;
+
+    int numCalled = 0;
+    for (int i = 0; i < 3; ++i) {
+        // The previous task is stopped before the next task starts,
+        // so |numCalled| is not accessed concurrently.
+        ponderer.start([&](const Deadline&) { ++numCalled; });
+    }
+    ponderer.stop();
+
+    EXPECT_EQ(3, numCalled);
+}
+
+TEST(PondererTest, stopInDestructor)
+{
+    atomic<bool> returned(false);
+    {
+        Ponderer ponderer;
+        ponderer.start([&](const Deadline& deadline) {
+            while (!deadline.isExpired())
+                this_thread::yield();
+            returned = true;
+        });
+    }
+    EXPECT_TRUE(returned);
+}
@@ -17,7 +17,8 @@
 using namespace std;
 
 CoreField::CoreField(const std::string& url) :
-    field_(url)
+    field_(url),
+    hash_(ZobristHash::hash(field_))
 {
     heights_[0] = 0;
     for (int x = 1; x <= WIDTH; ++x) {
@@ -35,7 +36,8 @@ CoreField::CoreField(const std::string& url) :
 }
 
 CoreField::CoreField(const PlainField& f) :
-    field_(f)
+    field_(f),
+    hash_(ZobristHash::hash(field_))
 {
     heights_[0] = 0;
     for (int x = 1; x <= WIDTH; ++x) {
@@ -11,6 +11,7 @@
 
 #include "base/base.h"
 #include "core/bit_field.h"
+#include "core/bit_field_kernel.h"
 #include "core/column_puyo_list.h"
 #include "core/decision.h"
 #include "core/field_checker.h"
@@ -21,6 +22,7 @@
 #include "core/plain_field.h"
 #include "core/rensa_result.h"
 #include "core/score.h"
+#include "core/zobrist_hash.h"
 
 class ColumnPuyoList;
 class Kumipuyo;
@@ -30,7 +32,7 @@ struct Position;
 // field implementation.
 class CoreField : public FieldConstant {
 public:
-    CoreField() : heights_{} {}
+    CoreField() : heights_{}, hash_(0) {}
     explicit CoreField(const std::string& url);
     explicit CoreField(const PlainField&);
     explicit CoreField(const BitField&);
@@ -165,9 +167,17 @@ public:
     template<typename Tracker> RensaResult simulate(Tracker*);
     // Simualtes chains with SimulationContext and Tracker.
     template<typename Tracker> RensaResult simulate(SimulationContext*, Tracker*);
+#ifdef PUYOAI_PORTABLE
+    // In a PUYOAI_PORTABLE build, the kernel is chosen at runtime when no tracker is used.
+    // See BitFieldKernel.
+    RensaResult simulate(SimulationContext*, RensaNonTracker*);
+#endif
 
     int simulateFast();
     template<typename Tracker> int simulateFast(Tracker*);
+#ifdef PUYOAI_PORTABLE
+    int simulateFast(RensaNonTracker*);
+#endif
 
     // Vanishes the connected puyos, and drop the puyos in the air. Score will be returned.
     RensaStepResult vanishDrop();
@@ -175,6 +185,9 @@ public:
     // Vanishes the connected puyos with Tracker.
     template<typename Tracker> RensaStepResult vanishDrop(Tracker*);
     template<typename Tracker> RensaStepResult vanishDrop(SimulationContext*, Tracker*);
+#ifdef PUYOAI_PORTABLE
+    RensaStepResult vanishDrop(SimulationContext*, RensaNonTracker*);
+#endif
 
     // Vanishes the connected puyos, and drop the puyos in the air.
     // Returns true if something is vanished.
@@ -182,11 +195,16 @@ public:
     bool vanishDropFast(SimulationContext*);
     template<typename Tracker> bool vanishDropFast(Tracker*);
     template<typename Tracker> bool vanishDropFast(SimulationContext*, Tracker*);
+#ifdef PUYOAI_PORTABLE
+    bool vanishDropFast(SimulationContext*, RensaNonTracker*);
+#endif
 
     // ----------------------------------------------------------------------
     // utility methods
 
-    size_t hash() const { return field_.hash(); }
+    // Returns the Zobrist hash of the field. This is maintained incrementally, so O(1).
+    // See ZobristHash for the collision rate.
+    size_t hash() const { return hash_; }
 
     std::string toDebugString() const;
 
@@ -211,15 +229,28 @@ public:
     }
 
 private:
-    void unsafeSet(int x, int y, PuyoColor c) { field_.setColor(x, y, c); }
+    void unsafeSet(int x, int y, PuyoColor c)
+    {
+        hash_ ^= ZobristHash::key(x, y, color(x, y)) ^ ZobristHash::key(x, y, c);
+        field_.setColor(x, y, c);
+    }
+
+    // Updates the heights and the hash after |field_| is changed from |before| by rensa.
+    void updateAfterRensa(const BitField& before)
+    {
+        hash_ ^= ZobristHash::diff(before, field_);
+        field_.calculateHeight(heights_);
+    }
 
     BitField field_;
     alignas(16) int heights_[MAP_WIDTH];
+    std::uint64_t hash_;
 };
 
 inline
 CoreField::CoreField(const BitField& f) :
-    field_(f)
+    field_(f),
+    hash_(ZobristHash::hash(f))
 {
     f.calculateHeight(heights_);
 }
@@ -249,16 +280,28 @@ RensaResult CoreField::simulate(Tracker* tracker)
 template<typename Tracker>
 RensaResult CoreField::simulate(SimulationContext* context, Tracker* tracker)
 {
+    BitField before(field_);
 #if defined(__AVX2__) && defined(__BMI2__)
     RensaResult result = field_.simulateAVX2(context, tracker);
 #else
     RensaResult result = field_.simulate(context, tracker);
 #endif
 
-    field_.calculateHeight(heights_);
+    updateAfterRensa(before);
     return result;
 }
 
+#ifdef PUYOAI_PORTABLE
+inline
+RensaResult CoreField::simulate(SimulationContext* context, RensaNonTracker*)
+{
+    BitField before(field_);
+    RensaResult result = BitFieldKernel::current().simulate(&field_, context);
+    updateAfterRensa(before);
+    return result;
+}
+#endif
+
 inline
 int CoreField::simulateFast()
 {
@@ -269,16 +312,28 @@ int CoreField::simulateFast()
 template<typename Tracker>
 int CoreField::simulateFast(Tracker* tracker)
 {
+    BitField before(field_);
 #if defined(__AVX2__) && defined(__BMI2__)
     int result = field_.simulateFastAVX2(tracker);
 #else
     int result = field_.simulateFast(tracker);
 #endif
 
-    field_.calculateHeight(heights_);
+    updateAfterRensa(before);
     return result;
 }
 
+#ifdef PUYOAI_PORTABLE
+inline
+int CoreField::simulateFast(RensaNonTracker*)
+{
+    BitField before(field_);
+    int result = BitFieldKernel::current().simulateFast(&field_);
+    updateAfterRensa(before);
+    return result;
+}
+#endif
+
 inline
 RensaStepResult CoreField::vanishDrop()
 {
@@ -303,15 +358,27 @@ RensaStepResult CoreField::vanishDrop(Tracker* tracker)
 template<typename Tracker>
 RensaStepResult CoreField::vanishDrop(SimulationContext* context, Tracker* tracker)
 {
+    BitField before(field_);
 #if defined(__AVX2__) && defined(__BMI2__)
     RensaStepResult result = field_.vanishDropAVX2(context, tracker);
 #else
     RensaStepResult result = field_.vanishDrop(context, tracker);
 #endif
 
-    field_.calculateHeight(heights_);
+    updateAfterRensa(before);
+    return result;
+}
+
+#ifdef PUYOAI_PORTABLE
+inline
+RensaStepResult CoreField::vanishDrop(SimulationContext* context, RensaNonTracker*)
+{
+    BitField before(field_);
+    RensaStepResult result = BitFieldKernel::current().vanishDrop(&field_, context);
+    updateAfterRensa(before);
     return result;
 }
+#endif
 
 inline
 bool CoreField::vanishDropFast()
@@ -337,15 +404,27 @@ bool CoreField::vanishDropFast(Tracker* tracker)
 template<typename Tracker>
 bool CoreField::vanishDropFast(SimulationContext* context, Tracker* tracker)
 {
+    BitField before(field_);
 #if defined(__AVX2__) && defined(__BMI2__)
     bool result = field_.vanishDropFastAVX2(context, tracker);
 #else
     bool result = field_.vanishDropFast(context, tracker);
 #endif
 
-    field_.calculateHeight(heights_);
+    updateAfterRensa(before);
+    return result;
+}
+
+#ifdef PUYOAI_PORTABLE
+inline
+bool CoreField::vanishDropFast(SimulationContext* context, RensaNonTracker*)
+{
+    BitField before(field_);
+    bool result = BitFieldKernel::current().vanishDropFast(&field_, context);
+    updateAfterRensa(before);
     return result;
 }
+#endif
 
 inline
 void CoreField::removePuyoFrom(int x)
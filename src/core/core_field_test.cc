@@ -8,6 +8,7 @@
 
 #include "core/decision.h"
 #include "core/frame.h"
+#include "core/kumipuyo.h"
 #include "core/position.h"
 #include "core/rensa_result.h"
 
@@ -887,3 +888,46 @@ TEST(CoreFieldTest, erasingPuyoPositions2)
 
     EXPECT_EQ(expected, positions);
 }
+
+TEST(CoreFieldTest, hashIsMaintainedIncrementally)
+{
+    CoreField cf(
+        "..BB.."
+        "..GGB."
+        ".GYYG."
+        ".BBBYB"
+        "RRRRBY");
+    EXPECT_EQ(ZobristHash::hash(cf.bitField()), cf.hash());
+
+    EXPECT_TRUE(cf.dropKumipuyo(Decision(3, 1), Kumipuyo(PuyoColor::RED, PuyoColor::BLUE)));
+    EXPECT_EQ(ZobristHash::hash(cf.bitField()), cf.hash());
+
+    cf.removePuyoFrom(4);
+    EXPECT_EQ(ZobristHash::hash(cf.bitField()), cf.hash());
+
+    CoreField::SimulationContext context;
+    EXPECT_TRUE(cf.vanishDropFast(&context));
+    EXPECT_EQ(ZobristHash::hash(cf.bitField()), cf.hash());
+
+    cf.simulate();
+    EXPECT_EQ(ZobristHash::hash(cf.bitField()), cf.hash());
+
+    cf.fallOjama(2);
+    EXPECT_EQ(ZobristHash::hash(cf.bitField()), cf.hash());
+    EXPECT_EQ(CoreField(cf.bitField()).hash(), cf.hash());
+}
+
+TEST(CoreFieldTest, hashOfSameFields)
+{
+    CoreField cf1;
+    CoreField cf2;
+
+    // Same field by the different order.
+    cf1.dropKumipuyo(Decision(1, 0), Kumipuyo(PuyoColor::RED, PuyoColor::BLUE));
+    cf1.dropKumipuyo(Decision(3, 0), Kumipuyo(PuyoColor::YELLOW, PuyoColor::GREEN));
+    cf2.dropKumipuyo(Decision(3, 0), Kumipuyo(PuyoColor::YELLOW, PuyoColor::GREEN));
+    cf2.dropKumipuyo(Decision(1, 0), Kumipuyo(PuyoColor::RED, PuyoColor::BLUE));
+
+    EXPECT_EQ(cf1, cf2);
+    EXPECT_EQ(cf1.hash(), cf2.hash());
+}
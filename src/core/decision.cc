@@ -11,7 +11,7 @@ string Decision::toString() const
     return ss.str();
 }
 
-string toString(const vector<Decision>& decisions)
+string toString(const DecisionSpan& decisions)
 {
     bool isFirst = true;
     stringstream ss;
@@ -1,6 +1,8 @@
 #ifndef CORE_DECISION_H_
 #define CORE_DECISION_H_
 
+#include <algorithm>
+#include <cstddef>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -54,6 +56,41 @@ public:
     int r;
 };
 
-std::string toString(const std::vector<Decision>&);
+// DecisionSpan is a read-only view of consecutive decisions, e.g. in a std::vector with
+// any allocator. The decisions must outlive the span.
+class DecisionSpan {
+public:
+    typedef const Decision* iterator;
+    typedef const Decision* const_iterator;
+
+    DecisionSpan() : begin_(nullptr), size_(0) {}
+    DecisionSpan(const Decision* begin, size_t size) : begin_(begin), size_(size) {}
+    template<typename Allocator>
+    DecisionSpan(const std::vector<Decision, Allocator>& decisions) :
+        begin_(decisions.data()), size_(decisions.size()) {}
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+    const Decision& operator[](size_t i) const { return begin_[i]; }
+    const Decision& front() const { return begin_[0]; }
+    const Decision& back() const { return begin_[size_ - 1]; }
+
+    const_iterator begin() const { return begin_; }
+    const_iterator end() const { return begin_ + size_; }
+
+    std::vector<Decision> toVector() const { return std::vector<Decision>(begin(), end()); }
+
+    friend bool operator==(const DecisionSpan& lhs, const DecisionSpan& rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+    friend bool operator!=(const DecisionSpan& lhs, const DecisionSpan& rhs) { return !(lhs == rhs); }
+
+private:
+    const Decision* begin_;
+    size_t size_;
+};
+
+std::string toString(const DecisionSpan&);
 
 #endif  // CORE_DECISION_H_
@@ -69,6 +69,37 @@ TEST(FieldBits256Test, expand)
     EXPECT_EQ(maskLow, expanded.low());
 }
 
+TEST(FieldBits256Test, maskedField12)
+{
+    FieldBits high(
+        "111111" // 14
+        "111111" // 13
+        "111111");
+    FieldBits low(
+        "1....1" // 13
+        ".1111.");
+
+    FieldBits256 masked = FieldBits256(high, low).maskedField12();
+
+    EXPECT_EQ(high.maskedField12(), masked.high());
+    EXPECT_EQ(low.maskedField12(), masked.low());
+}
+
+TEST(FieldBits256Test, expandEdge)
+{
+    FieldBits high(
+        "..1..."
+        ".111..");
+    FieldBits low(
+        "1....1"
+        "1....1");
+
+    FieldBits256 expanded = FieldBits256(high, low).expandEdge();
+
+    EXPECT_EQ(high.expandEdge(), expanded.high());
+    EXPECT_EQ(low.expandEdge(), expanded.low());
+}
+
 TEST(FieldBits256Test, findVanishingBits)
 {
     BitField bf(
@@ -0,0 +1,27 @@
+// This file does compile if -mavx512bw is specified or -mnative is specified and CPU has AVX-512.
+#ifdef __AVX512BW__
+
+#include <sstream>
+
+#include "core/field_bits_512.h"
+
+using namespace std;
+
+string FieldBits512::toString() const
+{
+    stringstream ss;
+    for (int y = 15; y >= 0; --y) {
+        for (int lane = NUM_LANES - 1; lane >= 0; --lane) {
+            for (int x = 0; x < 8; ++x) {
+                ss << (get(lane, x, y) ? '1' : '0');
+            }
+            if (lane > 0)
+                ss << "   ";
+        }
+        ss << endl;
+    }
+
+    return ss.str();
+}
+
+#endif // __AVX512BW__
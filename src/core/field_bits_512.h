@@ -0,0 +1,194 @@
+#ifndef CORE_FIELD_BITS_512_H_
+#define CORE_FIELD_BITS_512_H_
+#ifdef __AVX512BW__
+
+#include <array>
+#include <string>
+
+#include <immintrin.h>
+
+#include "base/avx.h"
+#include "base/builtin.h"
+#include "core/field_bits.h"
+
+// FieldBits512 holds 4 FieldBits. The i-th FieldBits (lane i) is put on the i-th 128 bits,
+// so each lane has the same layout as FieldBits.
+// Bit operations of 3 inputs are done in one instruction with VPTERNLOG.
+class FieldBits512 {
+public:
+    static const int NUM_LANES = 4;
+
+    FieldBits512() : m_(_mm512_setzero_si512()) {}
+    FieldBits512(__m512i m) : m_(m) {}
+    FieldBits512(FieldBits b0, FieldBits b1, FieldBits b2, FieldBits b3);
+    FieldBits512(int lane, int x, int y) : m_(onebit(lane, x, y)) {}
+
+    operator __m512i&() { return m_; }
+    __m512i& zmm() { return m_; }
+    const __m512i& zmm() const { return m_; }
+
+    bool get(int lane, int x, int y) const { return _mm512_test_epi16_mask(onebit(lane, x, y), m_) != 0; }
+    void set(int lane, int x, int y) { m_ = _mm512_or_si512(m_, onebit(lane, x, y)); }
+
+    void setAll(FieldBits512 m) { m_ = _mm512_or_si512(m_, m); }
+
+    FieldBits lane(int i) const;
+    void setLane(int i, FieldBits fb);
+
+    std::array<int, NUM_LANES> popcountLanes() const;
+
+    // Returns the masked FieldBits512 where the region of visible field is taken.
+    FieldBits512 maskedField12() const;
+
+    FieldBits512 expand(FieldBits512 mask) const;
+    FieldBits512 expand1(FieldBits512 mask) const;
+    // Same as FieldBits::expandEdge() for each lane.
+    FieldBits512 expandEdge() const;
+
+    bool findVanishingBits(FieldBits512* bits) const;
+
+    bool isEmpty() const { return _mm512_test_epi64_mask(m_, m_) == 0; }
+    std::string toString() const;
+
+    friend bool operator==(FieldBits512 lhs, FieldBits512 rhs) { return _mm512_cmpneq_epi64_mask(lhs, rhs) == 0; }
+    friend bool operator!=(FieldBits512 lhs, FieldBits512 rhs) { return !(lhs == rhs); }
+
+    friend FieldBits512 operator&(FieldBits512 lhs, FieldBits512 rhs) { return _mm512_and_si512(lhs.zmm(), rhs.zmm()); }
+    friend FieldBits512 operator|(FieldBits512 lhs, FieldBits512 rhs) { return _mm512_or_si512(lhs.zmm(), rhs.zmm()); }
+    friend FieldBits512 operator^(FieldBits512 lhs, FieldBits512 rhs) { return _mm512_xor_si512(lhs.zmm(), rhs.zmm()); }
+
+    friend std::ostream& operator<<(std::ostream& os, const FieldBits512& bits) { return os << bits.toString(); }
+
+private:
+    static __m512i onebit(int lane, int x, int y);
+
+    __m512i m_;
+};
+
+inline FieldBits512::FieldBits512(FieldBits b0, FieldBits b1, FieldBits b2, FieldBits b3)
+{
+    __m512i m = _mm512_castsi128_si512(b0.xmm());
+    m = _mm512_inserti32x4(m, b1.xmm(), 1);
+    m = _mm512_inserti32x4(m, b2.xmm(), 2);
+    m_ = _mm512_inserti32x4(m, b3.xmm(), 3);
+}
+
+inline FieldBits FieldBits512::lane(int i) const
+{
+    DCHECK(0 <= i && i < NUM_LANES) << i;
+
+    switch (i) {
+    case 0: return _mm512_castsi512_si128(m_);
+    case 1: return _mm512_maskz_extracti32x4_epi32(0xF, m_, 1);
+    case 2: return _mm512_maskz_extracti32x4_epi32(0xF, m_, 2);
+    default: return _mm512_maskz_extracti32x4_epi32(0xF, m_, 3);
+    }
+}
+
+inline void FieldBits512::setLane(int i, FieldBits fb)
+{
+    DCHECK(0 <= i && i < NUM_LANES) << i;
+
+    switch (i) {
+    case 0: m_ = _mm512_inserti32x4(m_, fb.xmm(), 0); return;
+    case 1: m_ = _mm512_inserti32x4(m_, fb.xmm(), 1); return;
+    case 2: m_ = _mm512_inserti32x4(m_, fb.xmm(), 2); return;
+    default: m_ = _mm512_inserti32x4(m_, fb.xmm(), 3); return;
+    }
+}
+
+inline std::array<int, FieldBits512::NUM_LANES> FieldBits512::popcountLanes() const
+{
+    avx::Decomposer512 d;
+    d.m = m_;
+
+    std::array<int, NUM_LANES> counts;
+    for (int i = 0; i < NUM_LANES; ++i)
+        counts[i] = popCount64(d.ui64[2 * i]) + popCount64(d.ui64[2 * i + 1]);
+    return counts;
+}
+
+inline FieldBits512 FieldBits512::maskedField12() const
+{
+    return _mm512_and_si512(_mm512_maskz_broadcast_i32x4(0xFFFF, FieldBits::FIELD_MASK_12.xmm()), m_);
+}
+
+inline FieldBits512 FieldBits512::expand(FieldBits512 mask) const
+{
+    __m512i seed = m_;
+
+    while (true) {
+        // 0xFE: a | b | c, 0xE0: a & (b | c)
+        __m512i v1 = _mm512_ternarylogic_epi64(seed, _mm512_slli_epi16(seed, 1), _mm512_srli_epi16(seed, 1), 0xFE);
+        __m512i v2 = _mm512_or_si512(_mm512_bslli_epi128(seed, 2), _mm512_bsrli_epi128(seed, 2));
+        __m512i expanded = _mm512_ternarylogic_epi64(mask, v1, v2, 0xE0);
+
+        if (_mm512_cmpneq_epi64_mask(seed, expanded) == 0)
+            return expanded;
+        seed = expanded;
+    }
+
+    // NOT_REACHED.
+}
+
+inline FieldBits512 FieldBits512::expand1(FieldBits512 mask) const
+{
+    __m512i v1 = _mm512_ternarylogic_epi64(m_, _mm512_slli_epi16(m_, 1), _mm512_srli_epi16(m_, 1), 0xFE);
+    __m512i v2 = _mm512_or_si512(_mm512_bslli_epi128(m_, 2), _mm512_bsrli_epi128(m_, 2));
+    return _mm512_ternarylogic_epi64(mask, v1, v2, 0xE0);
+}
+
+inline FieldBits512 FieldBits512::expandEdge() const
+{
+    __m512i m1 = _mm512_slli_epi16(m_, 1);
+    __m512i m2 = _mm512_srli_epi16(m_, 1);
+    __m512i m3 = _mm512_bslli_epi128(m_, 2);
+    __m512i m4 = _mm512_bsrli_epi128(m_, 2);
+
+    return _mm512_ternarylogic_epi64(m1, m2, _mm512_or_si512(m3, m4), 0xFE);
+}
+
+inline bool FieldBits512::findVanishingBits(FieldBits512* vanishing) const
+{
+    DCHECK(vanishing) << "vanishing should not be nullptr";
+
+    // See FieldBits::findVanishingSeed for the implementation details.
+
+    __m512i u = _mm512_and_si512(_mm512_srli_epi16(m_, 1), m_);
+    __m512i d = _mm512_and_si512(_mm512_slli_epi16(m_, 1), m_);
+    __m512i l = _mm512_and_si512(_mm512_bslli_epi128(m_, 2), m_);
+    __m512i r = _mm512_and_si512(_mm512_bsrli_epi128(m_, 2), m_);
+
+    __m512i ud_and = _mm512_and_si512(u, d);
+    __m512i lr_and = _mm512_and_si512(l, r);
+    __m512i ud_or = _mm512_or_si512(u, d);
+    __m512i lr_or = _mm512_or_si512(l, r);
+
+    // 0xF8: a | (b & c)
+    __m512i twos = _mm512_ternarylogic_epi64(_mm512_or_si512(lr_and, ud_and), ud_or, lr_or, 0xF8);
+    __m512i two_d = _mm512_and_si512(_mm512_slli_epi16(twos, 1), twos);
+    __m512i two_l = _mm512_and_si512(_mm512_bslli_epi128(twos, 2), twos);
+    // 0xEA: (a & b) | c
+    __m512i threes = _mm512_ternarylogic_epi64(ud_and, lr_or, _mm512_and_si512(lr_and, ud_or), 0xEA);
+    *vanishing = _mm512_ternarylogic_epi64(two_d, two_l, threes, 0xFE);
+
+    if (vanishing->isEmpty())
+        return false;
+
+    __m512i two_u = _mm512_and_si512(_mm512_srli_epi16(twos, 1), twos);
+    __m512i two_r = _mm512_and_si512(_mm512_bsrli_epi128(twos, 2), twos);
+    *vanishing = FieldBits512(_mm512_ternarylogic_epi64(*vanishing, two_u, two_r, 0xFE)).expand1(m_);
+    return true;
+}
+
+// static
+inline __m512i FieldBits512::onebit(int lane, int x, int y)
+{
+    DCHECK(0 <= lane && lane < NUM_LANES && 0 <= x && x < 8 && 0 <= y && y < 16)
+        << "lane=" << lane << " x=" << x << " y=" << y;
+
+    return _mm512_maskz_set1_epi16(static_cast<__mmask32>(1U << (lane * 8 + x)), static_cast<short>(1 << y));
+}
+
+#endif // __AVX512BW__
+#endif // CORE_FIELD_BITS_512_H_
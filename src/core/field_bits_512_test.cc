@@ -0,0 +1,189 @@
+#ifdef __AVX512BW__
+
+#include <gtest/gtest.h>
+
+#include "core/bit_field.h"
+#include "core/field_bits_512.h"
+
+using namespace std;
+
+TEST(FieldBits512Test, ctor1)
+{
+    FieldBits512 bits;
+    for (int lane = 0; lane < FieldBits512::NUM_LANES; ++lane) {
+        for (int x = 0; x < 8; ++x) {
+            for (int y = 0; y < 16; ++y) {
+                EXPECT_FALSE(bits.get(lane, x, y));
+            }
+        }
+    }
+}
+
+TEST(FieldBits512Test, ctor2)
+{
+    FieldBits b0;
+    b0.set(1, 3);
+    FieldBits b1;
+    b1.set(4, 8);
+    FieldBits b2;
+    b2.set(2, 4);
+    FieldBits b3;
+    b3.set(5, 9);
+
+    FieldBits512 fb512(b0, b1, b2, b3);
+
+    EXPECT_TRUE(fb512.get(0, 1, 3));
+    EXPECT_TRUE(fb512.get(1, 4, 8));
+    EXPECT_TRUE(fb512.get(2, 2, 4));
+    EXPECT_TRUE(fb512.get(3, 5, 9));
+
+    EXPECT_FALSE(fb512.get(1, 1, 3));
+    EXPECT_FALSE(fb512.get(0, 4, 8));
+    EXPECT_FALSE(fb512.get(3, 2, 4));
+    EXPECT_FALSE(fb512.get(2, 5, 9));
+
+    EXPECT_EQ(b0, fb512.lane(0));
+    EXPECT_EQ(b1, fb512.lane(1));
+    EXPECT_EQ(b2, fb512.lane(2));
+    EXPECT_EQ(b3, fb512.lane(3));
+}
+
+TEST(FieldBits512Test, setLane)
+{
+    FieldBits512 bits(FieldBits(1, 1), FieldBits(2, 2), FieldBits(3, 3), FieldBits(4, 4));
+    bits.setLane(2, FieldBits(5, 5));
+
+    EXPECT_EQ(FieldBits(1, 1), bits.lane(0));
+    EXPECT_EQ(FieldBits(2, 2), bits.lane(1));
+    EXPECT_EQ(FieldBits(5, 5), bits.lane(2));
+    EXPECT_EQ(FieldBits(4, 4), bits.lane(3));
+}
+
+TEST(FieldBits512Test, popcountLanes)
+{
+    FieldBits b0(
+        "1....."
+        "111...");
+    FieldBits b2(
+        "111111"
+        "111111");
+
+    std::array<int, 4> counts = FieldBits512(b0, FieldBits(), b2, FieldBits(3, 3)).popcountLanes();
+    EXPECT_EQ(4, counts[0]);
+    EXPECT_EQ(0, counts[1]);
+    EXPECT_EQ(12, counts[2]);
+    EXPECT_EQ(1, counts[3]);
+}
+
+TEST(FieldBits512Test, expand)
+{
+    FieldBits mask0(
+        "..1..."
+        "..1.11"
+        "111.11");
+    FieldBits mask1(
+        "111111"
+        ".....1"
+        "111111"
+        "1....."
+        "111111");
+    FieldBits mask2(
+        "11..11"
+        "11..11");
+    FieldBits mask3;
+
+    FieldBits512 mask(mask0, mask1, mask2, mask3);
+
+    FieldBits512 bit;
+    bit.set(0, 3, 1);
+    bit.set(1, 6, 1);
+    bit.set(2, 5, 2);
+
+    FieldBits512 expanded = bit.expand(mask);
+
+    EXPECT_EQ(FieldBits(3, 1).expand(mask0), expanded.lane(0));
+    EXPECT_EQ(FieldBits(6, 1).expand(mask1), expanded.lane(1));
+    EXPECT_EQ(mask1, expanded.lane(1));
+    EXPECT_EQ(FieldBits(5, 2).expand(mask2), expanded.lane(2));
+    EXPECT_TRUE(expanded.lane(3).isEmpty());
+}
+
+TEST(FieldBits512Test, maskedField12)
+{
+    FieldBits b0(
+        "111111" // 14
+        "111111" // 13
+        "111111");
+    FieldBits b1(
+        "1....1" // 13
+        ".1111.");
+
+    FieldBits512 masked = FieldBits512(b0, b1, b1, b0).maskedField12();
+
+    EXPECT_EQ(b0.maskedField12(), masked.lane(0));
+    EXPECT_EQ(b1.maskedField12(), masked.lane(1));
+    EXPECT_EQ(b1.maskedField12(), masked.lane(2));
+    EXPECT_EQ(b0.maskedField12(), masked.lane(3));
+}
+
+TEST(FieldBits512Test, expandEdge)
+{
+    FieldBits b0(
+        "..1..."
+        ".111..");
+    FieldBits b1(
+        "1....1"
+        "1....1");
+    FieldBits b2(
+        "......"
+        "1.....");
+
+    FieldBits512 expanded = FieldBits512(b0, b1, b2, FieldBits()).expandEdge();
+
+    EXPECT_EQ(b0.expandEdge(), expanded.lane(0));
+    EXPECT_EQ(b1.expandEdge(), expanded.lane(1));
+    EXPECT_EQ(b2.expandEdge(), expanded.lane(2));
+    EXPECT_TRUE(expanded.lane(3).isEmpty());
+}
+
+TEST(FieldBits512Test, findVanishingBits)
+{
+    BitField bf(
+        ".....R"
+        ".RR..R"
+        "YYRBBR"
+        "RYYBBG"
+        "RRRGGG");
+
+    FieldBits red = bf.bits(PuyoColor::RED);
+    FieldBits blue = bf.bits(PuyoColor::BLUE);
+    FieldBits yellow = bf.bits(PuyoColor::YELLOW);
+    FieldBits green = bf.bits(PuyoColor::GREEN);
+
+    FieldBits512 vanishing;
+    EXPECT_TRUE(FieldBits512(red, blue, yellow, green).findVanishingBits(&vanishing));
+
+    FieldBits redVanishing;
+    FieldBits blueVanishing;
+    FieldBits yellowVanishing;
+    FieldBits greenVanishing;
+
+    EXPECT_TRUE(red.findVanishingBits(&redVanishing));
+    EXPECT_TRUE(blue.findVanishingBits(&blueVanishing));
+    EXPECT_TRUE(yellow.findVanishingBits(&yellowVanishing));
+    EXPECT_TRUE(green.findVanishingBits(&greenVanishing));
+
+    EXPECT_EQ(FieldBits512(redVanishing, blueVanishing, yellowVanishing, greenVanishing), vanishing);
+}
+
+TEST(FieldBits512Test, findVanishingBitsEmpty)
+{
+    FieldBits bits(
+        "1.1..."
+        "1.11..");
+
+    FieldBits512 vanishing;
+    EXPECT_FALSE(FieldBits512(bits, bits, FieldBits(), bits).findVanishingBits(&vanishing));
+}
+
+#endif // __AVX512BW__
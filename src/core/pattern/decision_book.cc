@@ -8,6 +8,7 @@
 #include <utility>
 
 #include "base/strings.h"
+#include "core/core_field.h"
 #include "core/kumipuyo.h"
 #include "core/kumipuyo_seq.h"
 #include "core/pattern/bijection_matcher.h"
@@ -24,6 +25,41 @@ Decision makeDecision(const toml::Value& v)
     return Decision(x, r);
 }
 
+// SignatureBuilder makes the signature of a field (and NEXT) from its bits and its colors
+// (or variables) in some fixed order. A color is named by the order of its first appearance,
+// so the fields that differ only in the colors have the same signature.
+class SignatureBuilder {
+public:
+    explicit SignatureBuilder(const FieldBits& bits) :
+        signature_(reinterpret_cast<const char*>(&bits.xmm()), sizeof(bits.xmm()))
+    {
+    }
+
+    // |id| is a color or a variable.
+    void add(int id)
+    {
+        DCHECK(0 <= id && id < MAX_ID) << id;
+        if (names_[id] == 0)
+            names_[id] = static_cast<char>('a' + numNames_++);
+        signature_ += names_[id];
+    }
+
+    const string& signature() const { return signature_; }
+
+private:
+    static const int MAX_ID = 32;
+
+    string signature_;
+    char names_[MAX_ID] {};
+    int numNames_ = 0;
+};
+
+// BijectionMatcher supports only these variables.
+bool isBijectionVariable(char c)
+{
+    return 'A' <= c && c <= 'D';
+}
+
 } // namespace anonymous
 
 DecisionBookField::DecisionBookField(const vector<string>& field, map<string, Decision>&& decisions) :
@@ -119,7 +155,7 @@ bool DecisionBook::loadFromValue(const toml::Value& book)
         return false;
 
     const toml::Array& vs = book.find("book")->as<toml::Array>();
-    fields_.reserve(vs.size());
+    fields_.reserve(fields_.size() + vs.size());
     for (const toml::Value& v : vs) {
         vector<string> f;
         for (const auto& s : v.get<toml::Array>("field"))
@@ -132,6 +168,51 @@ bool DecisionBook::loadFromValue(const toml::Value& book)
         }
 
         fields_.emplace_back(f, std::move(m));
+        int fieldIndex = static_cast<int>(fields_.size()) - 1;
+        if (!addToIndex(fieldIndex))
+            unindexedFields_.push_back(fieldIndex);
+    }
+
+    return true;
+}
+
+bool DecisionBook::addToIndex(int fieldIndex)
+{
+    const DecisionBookField& field = fields_[fieldIndex];
+    const FieldPattern& pattern = field.pattern();
+
+    for (const auto& pat : pattern.patterns()) {
+        if (!pat.varBits.isEmpty() && !isBijectionVariable(pat.var))
+            return false;
+    }
+    for (const auto& entry : field.decisions()) {
+        if (entry.first.size() != 4)
+            return false;
+        if (!all_of(entry.first.begin(), entry.first.end(), isBijectionVariable))
+            return false;
+    }
+
+    // The cells must be visited in the same order as nextDecision().
+    FieldBits patternBits = pattern.patternBits();
+    SignatureBuilder fieldBuilder(patternBits);
+    for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+        for (int y = 1; y <= FieldConstant::HEIGHT + 1; ++y) {
+            if (!patternBits.get(x, y))
+                continue;
+            for (const auto& pat : pattern.patterns()) {
+                if (pat.varBits.get(x, y))
+                    fieldBuilder.add(pat.var - 'A');
+            }
+        }
+    }
+
+    // When 2 entries have the same signature, the first one is used.
+    int rank = 0;
+    for (const auto& entry : field.decisions()) {
+        SignatureBuilder builder(fieldBuilder);
+        for (char c : entry.first)
+            builder.add(c - 'A');
+        index_.emplace(builder.signature(), IndexEntry { fieldIndex, rank++, entry.second });
     }
 
     return true;
@@ -139,11 +220,69 @@ bool DecisionBook::loadFromValue(const toml::Value& book)
 
 Decision DecisionBook::nextDecision(const CoreField& cf, const KumipuyoSeq& seq) const
 {
-    for (const auto& f : fields_) {
-        Decision decision = f.nextDecision(cf, seq);
+    const Kumipuyo& kp1 = seq.get(0);
+    const Kumipuyo& kp2 = seq.get(1);
+
+    // The signature assumes all the puyos are normal. Otherwise, falls back to trying all the fields.
+    FieldBits field13Bits = cf.bitField().field13Bits();
+    if (cf.bitField().normalColorBits().maskedField13() != field13Bits ||
+        !isNormalColor(kp1.axis) || !isNormalColor(kp1.child) ||
+        !isNormalColor(kp2.axis) || !isNormalColor(kp2.child)) {
+        for (const auto& f : fields_) {
+            Decision decision = f.nextDecision(cf, seq);
+            if (decision.isValid())
+                return decision;
+        }
+        return Decision();
+    }
+
+    SignatureBuilder fieldBuilder(field13Bits);
+    for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+        int height = std::min(cf.height(x), FieldConstant::HEIGHT + 1);
+        for (int y = 1; y <= height; ++y)
+            fieldBuilder.add(ordinal(cf.color(x, y)));
+    }
+
+    // Same order as DecisionBookField::nextDecision(). The decision is reversed if kp1 is reversed.
+    const Kumipuyo nexts[4][2] = {
+        { kp1, kp2 },
+        { kp1, kp2.reverse() },
+        { kp1.reverse(), kp2 },
+        { kp1.reverse(), kp2.reverse() },
+    };
+    const IndexEntry* found = nullptr;
+    bool reversed = false;
+    for (int i = 0; i < 4; ++i) {
+        if ((i & 1) && kp2.isRep())
+            continue;
+        if ((i & 2) && kp1.isRep())
+            continue;
+
+        SignatureBuilder builder(fieldBuilder);
+        builder.add(ordinal(nexts[i][0].axis));
+        builder.add(ordinal(nexts[i][0].child));
+        builder.add(ordinal(nexts[i][1].axis));
+        builder.add(ordinal(nexts[i][1].child));
+
+        auto it = index_.find(builder.signature());
+        if (it == index_.end())
+            continue;
+        const IndexEntry& entry = it->second;
+        if (!found || make_pair(entry.fieldIndex, entry.rank) < make_pair(found->fieldIndex, found->rank)) {
+            found = &entry;
+            reversed = (i & 2) != 0;
+        }
+    }
+
+    for (int fieldIndex : unindexedFields_) {
+        if (found && found->fieldIndex < fieldIndex)
+            break;
+        Decision decision = fields_[fieldIndex].nextDecision(cf, seq);
         if (decision.isValid())
             return decision;
     }
 
-    return Decision();
+    if (!found)
+        return Decision();
+    return reversed ? found->decision.reverse() : found->decision;
 }
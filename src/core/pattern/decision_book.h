@@ -5,6 +5,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/noncopyable.h"
@@ -23,6 +24,9 @@ public:
 
     Decision nextDecision(const CoreField&, const KumipuyoSeq&) const;
 
+    const FieldPattern& pattern() const { return pattern_; }
+    const std::map<std::string, Decision>& decisions() const { return decisions_; }
+
 private:
     bool matchNext(BijectionMatcher*, const std::string& nextPattern, const Kumipuyo& next1, const Kumipuyo& next2) const;
 
@@ -32,6 +36,10 @@ private:
 
 // DecisionBook is a book to return a fixed Decision from the given field and kumipuyo sequence.
 // It is useful to make a book in the very early phase.
+//
+// The book is indexed by the signature of the field and NEXT, where the colors are normalized
+// by the order of their first appearance. So nextDecision() is a few hash lookups whatever
+// the size of the book is. The result is the same as trying the fields in the book order.
 class DecisionBook : noncopyable {
 public:
     DecisionBook();
@@ -45,9 +53,22 @@ public:
     Decision nextDecision(const CoreField&, const KumipuyoSeq&) const;
 
 private:
+    // The decision of |rank|-th NEXT pattern of fields_[fieldIndex].
+    struct IndexEntry {
+        int fieldIndex;
+        int rank;
+        Decision decision;
+    };
+
     void makeFieldFromValue(const CoreField&, const std::string&, const toml::Value&);
 
+    // Adds fields_[fieldIndex] to |index_|. Returns false if the field cannot be indexed.
+    bool addToIndex(int fieldIndex);
+
     std::vector<DecisionBookField> fields_;
+    std::unordered_map<std::string, IndexEntry> index_;
+    // The fields not in |index_|. These are tried one by one.
+    std::vector<int> unindexedFields_;
 };
 
 #endif // CPU_MAYAH_DECISION_BOOK_H_
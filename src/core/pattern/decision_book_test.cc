@@ -1,5 +1,11 @@
 #include "decision_book.h"
 
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "core/core_field.h"
@@ -93,3 +99,117 @@ TEST(DecisionBookTest, nextDecision3)
     cf.dropKumipuyo(Decision(3, 2), seq.front());
     seq.dropFront();
 }
+
+TEST(DecisionBookTest, firstFieldWins)
+{
+    static const char BOOK[] = R"(
+[[book]]
+field = [
+    "..A...",
+]
+AAAB = [1, 0]
+
+[[book]]
+field = [
+    "..A...",
+]
+AAAA = [2, 0]
+ABAB = [3, 0]
+ABBA = [4, 0]
+)";
+
+    DecisionBook book;
+    ASSERT_TRUE(book.loadFromString(BOOK));
+
+    CoreField cf("..R...");
+
+    // Both books match. The first one should be used.
+    EXPECT_EQ(Decision(1, 0), book.nextDecision(cf, KumipuyoSeq("RRRB")));
+    // Only the second one matches.
+    EXPECT_EQ(Decision(2, 0), book.nextDecision(cf, KumipuyoSeq("RRRR")));
+    // ABBA matches as is, and ABAB matches with the reversed next2. ABAB should be used.
+    EXPECT_EQ(Decision(3, 0), book.nextDecision(cf, KumipuyoSeq("RBBR")));
+    // ABBA matches with the reversed next1, and ABAB matches with the reversed next1 and next2.
+    // ABAB should be used, and the decision is reversed.
+    EXPECT_EQ(Decision(3, 0).reverse(), book.nextDecision(cf, KumipuyoSeq("BRBR")));
+}
+
+TEST(DecisionBookTest, nextDecisionWithOjama)
+{
+    DecisionBook book;
+    ASSERT_TRUE(book.loadFromString(TEST_BOOK));
+
+    // A variable on ojama is not checked.
+    CoreField cf(
+        "..R..."
+        "..O...");
+
+    EXPECT_EQ(Decision(5, 2), book.nextDecision(cf, KumipuyoSeq("RRRR")));
+}
+
+TEST(DecisionBookTest, sameAsTryingAllFields)
+{
+    const string filename = SRC_DIR "/cpu/mayah/decision.toml";
+
+    DecisionBook book;
+    ASSERT_TRUE(book.load(filename));
+
+    vector<DecisionBookField> fields;
+    {
+        ifstream ifs(filename);
+        toml::ParseResult result = toml::parse(ifs);
+        ASSERT_TRUE(result.valid());
+        for (const toml::Value& v : result.value.get<toml::Array>("book")) {
+            vector<string> f;
+            for (const auto& s : v.get<toml::Array>("field"))
+                f.push_back(s.as<string>());
+            map<string, Decision> m;
+            for (const auto& e : v.as<toml::Table>()) {
+                if (e.first == "field")
+                    continue;
+                const toml::Array& ary = e.second.as<toml::Array>();
+                m[e.first] = Decision(ary[0].as<int>(), ary[1].as<int>());
+            }
+            fields.emplace_back(f, std::move(m));
+        }
+    }
+
+    auto expectedDecision = [&fields](const CoreField& cf, const KumipuyoSeq& seq) {
+        for (const auto& f : fields) {
+            Decision decision = f.nextDecision(cf, seq);
+            if (decision.isValid())
+                return decision;
+        }
+        return Decision();
+    };
+
+    const PuyoColor colors[] = { PuyoColor::RED, PuyoColor::BLUE, PuyoColor::YELLOW, PuyoColor::GREEN };
+    mt19937 mt(1);
+    int numFound = 0;
+    for (int i = 0; i < 1000; ++i) {
+        KumipuyoSeq seq;
+        for (int j = 0; j < 10; ++j)
+            seq.add(Kumipuyo(colors[mt() % 3], colors[mt() % 4]));
+
+        CoreField cf;
+        while (seq.size() >= 2) {
+            Decision expected = expectedDecision(cf, seq);
+            EXPECT_EQ(expected, book.nextDecision(cf, seq)) << cf << seq.toString();
+
+            Decision decision = expected;
+            if (expected.isValid()) {
+                ++numFound;
+            } else {
+                // Sometimes follows a decision out of the book.
+                decision = Decision(mt() % 6 + 1, mt() % 4);
+                if (!decision.isValid() || mt() % 2 == 0)
+                    break;
+            }
+            if (!cf.dropKumipuyo(decision, seq.front()))
+                break;
+            seq.dropFront();
+        }
+    }
+
+    EXPECT_LT(0, numFound);
+}
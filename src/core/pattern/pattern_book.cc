@@ -3,10 +3,81 @@
 #include <algorithm>
 #include <fstream>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "base/bmi.h"
+#include "base/builtin.h"
+
 using namespace std;
 
 namespace {
 
+// The edges of a node with at most this number of edges are matched without the prefilter.
+const int SCALAR_MAX_EDGES = 8;
+
+#if defined(__AVX512BW__)
+// Sets 2 bits for each of |varBits| to |hasColor[j]| if it has NORMAL_PUYO_COLORS[j],
+// and to |hasOjama| if it has ojama. 4 variables are tested at once, so |varBits| must
+// be readable up to the multiple of 4.
+void testVariablesSIMD(const FieldBits* varBits, int size,
+                       const FieldBits colorBits[], const FieldBits& ojamaBits,
+                       uint64_t hasColor[], uint64_t* hasOjama)
+{
+    __m512i colors[NUM_NORMAL_PUYO_COLORS];
+    for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j)
+        colors[j] = _mm512_maskz_broadcast_i32x4(0xFFFF, colorBits[j].xmm());
+    const __m512i ojama = _mm512_maskz_broadcast_i32x4(0xFFFF, ojamaBits.xmm());
+
+    for (int i = 0; i < size; i += 4) {
+        const __m512i vars = _mm512_loadu_si512(&varBits[i]);
+        for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j)
+            hasColor[j] |= static_cast<uint64_t>(_mm512_test_epi64_mask(vars, colors[j])) << (2 * i);
+        *hasOjama |= static_cast<uint64_t>(_mm512_test_epi64_mask(vars, ojama)) << (2 * i);
+    }
+}
+#elif defined(__AVX2__)
+// Same as above, but 2 variables are tested at once.
+void testVariablesSIMD(const FieldBits* varBits, int size,
+                       const FieldBits colorBits[], const FieldBits& ojamaBits,
+                       uint64_t hasColor[], uint64_t* hasOjama)
+{
+    __m256i colors[NUM_NORMAL_PUYO_COLORS];
+    for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j)
+        colors[j] = _mm256_broadcastsi128_si256(colorBits[j].xmm());
+    const __m256i ojama = _mm256_broadcastsi128_si256(ojamaBits.xmm());
+    const __m256i zero = _mm256_setzero_si256();
+
+    // Returns 4 bits. A bit is set if the 64 bits of |a & b| are not zero.
+    auto test = [zero](__m256i a, __m256i b) -> uint64_t {
+        return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(a, b), zero))) & 0xF;
+    };
+
+    for (int i = 0; i < size; i += 2) {
+        const __m256i vars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&varBits[i]));
+        for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j)
+            hasColor[j] |= test(vars, colors[j]) << (2 * i);
+        *hasOjama |= test(vars, ojama) << (2 * i);
+    }
+}
+#else
+// Same as above, but without SIMD.
+void testVariablesSIMD(const FieldBits* varBits, int size,
+                       const FieldBits colorBits[], const FieldBits& ojamaBits,
+                       uint64_t hasColor[], uint64_t* hasOjama)
+{
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j) {
+            if (!(varBits[i] & colorBits[j]).isEmpty())
+                hasColor[j] |= 3ULL << (2 * i);
+        }
+        if (!(varBits[i] & ojamaBits).isEmpty())
+            *hasOjama |= 3ULL << (2 * i);
+    }
+}
+#endif
+
 ColumnPuyoList diff(const CoreField& before, const BitField& after)
 {
     ColumnPuyoList cpl;
@@ -28,6 +99,7 @@ ColumnPuyoList diff(const CoreField& before, const BitField& after)
 PatternBook::PatternBook() :
     root_(new PatternTree())
 {
+    compile();
 }
 
 PatternBook::~PatternBook()
@@ -146,9 +218,52 @@ bool PatternBook::loadFromValue(const toml::Value& patterns, bool ignoreDuplicat
         }
     }
 
+    compile();
     return true;
 }
 
+void PatternBook::compile()
+{
+    nodes_.clear();
+    edgeVarBits_.clear();
+    edgeNotBits_.clear();
+    edgeChildren_.clear();
+    leaves_.clear();
+
+    compileNode(*root_);
+
+    // findCandidateEdges() loads 4 edges at once.
+    for (int i = 0; i < 3; ++i)
+        edgeVarBits_.push_back(FieldBits());
+}
+
+int PatternBook::compileNode(const PatternTree& tree)
+{
+    int nodeIndex = static_cast<int>(nodes_.size());
+    int firstEdge = static_cast<int>(edgeChildren_.size());
+    int numEdges = static_cast<int>(tree.children_.size());
+
+    int leafIndex = -1;
+    if (tree.isLeaf()) {
+        leafIndex = static_cast<int>(leaves_.size());
+        leaves_.push_back(tree.patternBookField());
+    }
+    nodes_.push_back(Node { firstEdge, numEdges, leafIndex });
+
+    // Reserves the edges first so that they are contiguous.
+    for (const auto& entry : tree.children_) {
+        edgeVarBits_.push_back(entry.first.varBits());
+        edgeNotBits_.push_back(entry.first.notBits());
+        edgeChildren_.push_back(-1);
+    }
+    for (int i = 0; i < numEdges; ++i) {
+        int childIndex = compileNode(*tree.children_[i].second);
+        edgeChildren_[firstEdge + i] = childIndex;
+    }
+
+    return nodeIndex;
+}
+
 void PatternBook::complement(const CoreField& originalField,
                                 const PatternBook::ComplementCallback& callback) const
 {
@@ -159,7 +274,7 @@ void PatternBook::complement(const CoreField& originalField,
                                 int allowedNumUnusedVariables,
                                 const ComplementCallback& callback) const
 {
-    iterate(*root_, originalField, originalField.bitField(), FieldBits(), allowedNumUnusedVariables, 0, callback);
+    iterate(nodes_[0], originalField, originalField.bitField(), FieldBits(), allowedNumUnusedVariables, 0, callback);
 }
 
 void PatternBook::complement(const CoreField& originalField,
@@ -167,17 +282,46 @@ void PatternBook::complement(const CoreField& originalField,
                              int allowedNumUnusedVariables,
                              const ComplementCallback& callback) const
 {
-    for (const auto& entry : root_->children_) {
-        if (entry.first.varBits() != ignitionBits)
+    const Node& root = nodes_[0];
+    for (int i = root.firstEdge; i < root.firstEdge + root.numEdges; ++i) {
+        if (edgeVarBits_[i] != ignitionBits)
             continue;
         // TODO(mayah): Probably, we don't need to check notBits.
-        iterate(*entry.second, originalField, originalField.bitField(),
-                entry.first.varBits() & ignitionBits,
+        iterate(nodes_[edgeChildren_[i]], originalField, originalField.bitField(),
+                edgeVarBits_[i] & ignitionBits,
                 allowedNumUnusedVariables, 0, callback);
     }
 }
 
-void PatternBook::iterate(const PatternTree& tree,
+uint32_t PatternBook::findCandidateEdges(int firstEdge, int numEdges,
+                                         const FieldBits colorBits[], const FieldBits& ojamaBits,
+                                         bool needsColor) const
+{
+    DCHECK(0 < numEdges && numEdges <= 32) << numEdges;
+
+    // 2 bits for each edge. The bits are set if the variable has the color (or ojama).
+    uint64_t hasColor[NUM_NORMAL_PUYO_COLORS] {};
+    uint64_t hasOjama = 0;
+
+    testVariablesSIMD(&edgeVarBits_[firstEdge], numEdges, colorBits, ojamaBits, hasColor, &hasOjama);
+
+    const uint64_t lowBits = 0x5555555555555555ULL;
+    for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j)
+        hasColor[j] = (hasColor[j] | hasColor[j] >> 1) & lowBits;
+    hasOjama = (hasOjama | hasOjama >> 1) & lowBits;
+
+    uint64_t anyColor = hasColor[0] | hasColor[1] | hasColor[2] | hasColor[3];
+    uint64_t multiColors = (hasColor[0] & (hasColor[1] | hasColor[2] | hasColor[3])) |
+        (hasColor[1] & (hasColor[2] | hasColor[3])) |
+        (hasColor[2] & hasColor[3]);
+
+    uint64_t candidates = (needsColor ? anyColor : lowBits) & ~multiColors & ~hasOjama;
+    if (numEdges < 32)
+        candidates &= (1ULL << (2 * numEdges)) - 1;
+    return static_cast<uint32_t>(bmi::extractBits(candidates, lowBits));
+}
+
+void PatternBook::iterate(const Node& node,
                           const CoreField& originalField,
                           const BitField& currentField,
                           const FieldBits& matchedBits,
@@ -185,66 +329,91 @@ void PatternBook::iterate(const PatternTree& tree,
                           int numUnusedVariables,
                           const ComplementCallback& callback) const
 {
-    if (tree.isLeaf()) {
-        if ((tree.patternBookField().mustBits() & originalField.bitField().field13Bits()) == tree.patternBookField().mustBits()) {
+    if (node.leafIndex >= 0) {
+        const PatternBookField& patternBookField = leaves_[node.leafIndex];
+        if ((patternBookField.mustBits() & originalField.bitField().field13Bits()) == patternBookField.mustBits()) {
             BitField bf(currentField);
-            bf.setColorAllIfEmpty(tree.patternBookField().ironBits(), PuyoColor::IRON);
+            bf.setColorAllIfEmpty(patternBookField.ironBits(), PuyoColor::IRON);
             if (!bf.hasFloatingPuyo()) {
                 CoreField cf(bf);
-                callback(std::move(cf), diff(originalField, bf), numUnusedVariables, matchedBits, tree.patternBookField());
+                callback(std::move(cf), diff(originalField, bf), numUnusedVariables, matchedBits, patternBookField);
             }
         }
     }
 
-    FieldBits ojamaBits = currentField.bits(PuyoColor::OJAMA);
-    for (const auto& entry : tree.children_) {
-        PuyoColor foundColor = PuyoColor::EMPTY;
-        bool ok = true;
-        FieldBits newMatchedBits(matchedBits);
-        for (PuyoColor c : NORMAL_PUYO_COLORS) {
-            FieldBits matched = entry.first.varBits() & currentField.bits(c);
-            if (matched.isEmpty())
-                continue;
-            if (foundColor != PuyoColor::EMPTY) {
-                ok = false;
-                break;
-            }
+    if (node.numEdges == 0)
+        return;
 
-            newMatchedBits.setAll(matched);
-            foundColor = c;
-        }
-        if (!ok)
-            continue;
+    FieldBits ojamaBits = currentField.bits(PuyoColor::OJAMA);
+    FieldBits colorBits[NUM_NORMAL_PUYO_COLORS];
+    for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j)
+        colorBits[j] = currentField.bits(NORMAL_PUYO_COLORS[j]);
+
+    // A variable without color can be matched only when an unused variable is allowed.
+    const bool needsColor = allowedNumUnusedVariables <= numUnusedVariables;
+
+    const int endEdge = node.firstEdge + node.numEdges;
+    for (int firstEdge = node.firstEdge; firstEdge < endEdge; firstEdge += 32) {
+        const int numEdges = std::min(32, endEdge - firstEdge);
+        // For a few edges, the prefilter doesn't pay for broadcasting the bits.
+        uint32_t candidates = numEdges <= SCALAR_MAX_EDGES ?
+            (1U << numEdges) - 1 :
+            findCandidateEdges(firstEdge, numEdges, colorBits, ojamaBits, needsColor);
+
+        for (; candidates != 0; candidates &= candidates - 1) {
+            const int i = firstEdge + countTrailingZeros32(candidates);
+            const FieldBits& varBits = edgeVarBits_[i];
+            const FieldBits& notBits = edgeNotBits_[i];
+
+            int foundColorIndex = -1;
+            bool ok = true;
+            FieldBits newMatchedBits(matchedBits);
+            for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j) {
+                FieldBits matched = varBits & colorBits[j];
+                if (matched.isEmpty())
+                    continue;
+                if (foundColorIndex >= 0) {
+                    ok = false;
+                    break;
+                }
 
-        // Check ojama.
-        if (!(entry.first.varBits() & ojamaBits).isEmpty())
-            continue;
+                newMatchedBits.setAll(matched);
+                foundColorIndex = j;
+            }
+            if (!ok)
+                continue;
 
-        bool unusedVariableUsed = false;
-        if (foundColor == PuyoColor::EMPTY) {
-            if (allowedNumUnusedVariables <= numUnusedVariables)
+            // Check ojama.
+            if (!(varBits & ojamaBits).isEmpty())
                 continue;
 
-            // TODO(mayah): Should check all colors?
-            for (PuyoColor c : NORMAL_PUYO_COLORS) {
-                if ((entry.first.notBits() & currentField.bits(c)).isEmpty()) {
-                    foundColor = c;
-                    break;
+            bool unusedVariableUsed = false;
+            if (foundColorIndex < 0) {
+                if (needsColor)
+                    continue;
+
+                // TODO(mayah): Should check all colors?
+                for (int j = 0; j < NUM_NORMAL_PUYO_COLORS; ++j) {
+                    if ((notBits & colorBits[j]).isEmpty()) {
+                        foundColorIndex = j;
+                        break;
+                    }
                 }
-            }
 
-            if (foundColor == PuyoColor::EMPTY)
-                continue;
+                if (foundColorIndex < 0)
+                    continue;
 
-            unusedVariableUsed = true;
-        } else {
-            // Check not bits.
-            if (!(entry.first.notBits() & currentField.bits(foundColor)).isEmpty())
-                continue;
-        }
+                unusedVariableUsed = true;
+            } else {
+                // Check not bits.
+                if (!(notBits & colorBits[foundColorIndex]).isEmpty())
+                    continue;
+            }
 
-        BitField bf(currentField);
-        bf.setColorAll(entry.first.varBits(), foundColor);
-        iterate(*entry.second, originalField, bf, newMatchedBits, allowedNumUnusedVariables, unusedVariableUsed ? numUnusedVariables + 1 : numUnusedVariables, callback);
+            BitField bf(currentField);
+            bf.setColorAll(varBits, NORMAL_PUYO_COLORS[foundColorIndex]);
+            iterate(nodes_[edgeChildren_[i]], originalField, bf, newMatchedBits, allowedNumUnusedVariables,
+                    unusedVariableUsed ? numUnusedVariables + 1 : numUnusedVariables, callback);
+        }
     }
 }
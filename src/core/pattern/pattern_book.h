@@ -1,6 +1,7 @@
 #ifndef CORE_PATTERN_PATTERN_BOOK_H_
 #define CORE_PATTERN_PATTERN_BOOK_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -38,7 +39,29 @@ public:
     void complement(const CoreField&, const FieldBits& ignitionBits, int allowedNumUnusedVariables, const ComplementCallback&) const;
 
 private:
-    void iterate(const PatternTree&,
+    // The compiled PatternTree. The nodes are stored in pre-order, and the edges to the children
+    // of a node are stored contiguously, so matching doesn't chase pointers.
+    struct Node {
+        int firstEdge;
+        int numEdges;
+        int leafIndex;  // -1 if not leaf.
+    };
+
+    // Rebuilds the compiled tree from |root_|.
+    void compile();
+    // Returns the index of the compiled node of |tree|.
+    int compileNode(const PatternTree& tree);
+
+    // Returns the edges in [firstEdge, firstEdge + numEdges) that can be matched. |numEdges| must be
+    // at most 32. Bit i is set if the variable of edge (firstEdge + i) doesn't have ojama, and has
+    // at most one color of |colorBits| (exactly one if |needsColor|). These are the checks that
+    // reject most edges, and they are done for several edges at once with AVX2 or AVX-512.
+    // The edges not returned are never matched, so this is a prefilter of iterate().
+    std::uint32_t findCandidateEdges(int firstEdge, int numEdges,
+                                     const FieldBits colorBits[], const FieldBits& ojamaBits,
+                                     bool needsColor) const;
+
+    void iterate(const Node&,
                  const CoreField& oridinalField,
                  const BitField& currentField,
                  const FieldBits& matchedBits,
@@ -46,7 +69,15 @@ private:
                  int numUnusedVariables,
                  const ComplementCallback&) const;
 
+    // |root_| is used only for loading. complement() uses the compiled ones.
     std::unique_ptr<PatternTree> root_;
+    std::vector<Node> nodes_;
+    // The edges are stored in separate arrays, so that varBits of the edges can be loaded at once.
+    // |edgeVarBits_| has some padding at the end.
+    std::vector<FieldBits> edgeVarBits_;
+    std::vector<FieldBits> edgeNotBits_;
+    std::vector<int> edgeChildren_;
+    std::vector<PatternBookField> leaves_;
 };
 
 #endif // CPU_MAYAH_PATTERN_BOOK_H_
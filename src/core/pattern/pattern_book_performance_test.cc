@@ -0,0 +1,83 @@
+#include "core/pattern/pattern_book.h"
+
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "base/base.h"
+#include "base/time.h"
+#include "base/time_stamp_counter.h"
+#include "core/core_field.h"
+
+using namespace std;
+
+namespace {
+
+void runComplement(const CoreField& field, int allowedNumUnusedVariables)
+{
+    const int N = 10000;
+
+    PatternBook patternBook;
+    ASSERT_TRUE(patternBook.load(SRC_DIR "/cpu/mayah/pattern.toml"));
+
+    TimeStampCounterData tsc;
+    int numComplemented = 0;
+    auto callback = [&](CoreField&&, const ColumnPuyoList&, int, const FieldBits&, const PatternBookField&) {
+        ++numComplemented;
+    };
+
+    double beginTime = currentTime();
+    for (int i = 0; i < N; ++i) {
+        ScopedTimeStampCounter stsc(&tsc);
+        patternBook.complement(field, allowedNumUnusedVariables, callback);
+    }
+    double endTime = currentTime();
+
+    cout << "complemented fields: " << numComplemented / N << endl;
+    cout << "complements/sec: " << static_cast<int>(N / (endTime - beginTime)) << endl;
+    tsc.showStatistics();
+}
+
+} // anonymous namespace
+
+TEST(PatternBookPerformanceTest, complementEmpty)
+{
+    runComplement(CoreField(), 0);
+}
+
+TEST(PatternBookPerformanceTest, complementGTR)
+{
+    CoreField field(
+        "......"
+        "RRB..."
+        "BBYBB.");
+
+    runComplement(field, 0);
+}
+
+TEST(PatternBookPerformanceTest, complementMiddle)
+{
+    CoreField field(
+        "......"
+        "B....."
+        "BRY..."
+        "RRBYY."
+        "GGRBBY");
+
+    runComplement(field, 1);
+}
+
+TEST(PatternBookPerformanceTest, complementFilled)
+{
+    CoreField field(
+        "G....."
+        "YG...."
+        "RRB..."
+        "RGBY.."
+        "GBYYG."
+        "GGBRGR"
+        "RRGBRR"
+        "BBYGGY");
+
+    runComplement(field, 2);
+}
@@ -1,15 +1,49 @@
 #include "core/plan/plan.h"
 
 #include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
+#include "base/executor.h"
+#include "base/wait_group.h"
 #include "core/kumipuyo_seq.h"
 #include "core/puyo_controller.h"
 
 using namespace std;
 
-static const Decision DECISIONS[] = {
+namespace {
+
+// Makes a RefPlan from the field before the rensa, and calls |callback| with it.
+// Since the rensa is simulated in place, |fieldBeforeRensa| should be a temporary copy.
+template<typename Callback>
+void callbackWithRefPlan(CoreField& fieldBeforeRensa, const std::vector<Decision>& decisions,
+                         int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire,
+                         const Callback& callback)
+{
+    DCHECK(!decisions.empty());
+
+    RensaResult rensaResult;
+    if (shouldFire) {
+        rensaResult = fieldBeforeRensa.simulate();
+        DCHECK_GT(rensaResult.chains, 0);
+        if (!fieldBeforeRensa.isEmpty(3, 12))
+            return;
+    } else {
+        DCHECK(fieldBeforeRensa.isEmpty(3, 12));
+    }
+
+    callback(RefPlan(fieldBeforeRensa, decisions, rensaResult, numChigiri,
+                     framesToIgnite, lastDropFrames, 0, 0, 0, 0, false));
+}
+
+} // anonymous namespace
+
+// static
+const Decision Plan::DECISIONS[Plan::NUM_DECISIONS] = {
     Decision(2, 3), Decision(3, 3), Decision(3, 1), Decision(4, 1),
     Decision(5, 1), Decision(1, 2), Decision(2, 2), Decision(3, 2),
     Decision(4, 2), Decision(5, 2), Decision(6, 2), Decision(1, 1),
@@ -18,7 +52,8 @@ static const Decision DECISIONS[] = {
     Decision(5, 0), Decision(6, 0),
 };
 
-static const Kumipuyo ALL_KUMIPUYO_KINDS[] = {
+// static
+const Kumipuyo Plan::ALL_KUMIPUYO_KINDS[Plan::NUM_KUMIPUYO_KINDS] = {
     Kumipuyo(PuyoColor::RED, PuyoColor::RED),
     Kumipuyo(PuyoColor::RED, PuyoColor::BLUE),
     Kumipuyo(PuyoColor::RED, PuyoColor::YELLOW),
@@ -70,66 +105,6 @@ std::string RefPlan::decisionText() const
     return ss.str();
 }
 
-template<typename Callback>
-void iterateAvailablePlansInternal(const CoreField& field,
-                                   const KumipuyoSeq& kumipuyoSeq,
-                                   std::vector<Decision>& decisions,
-                                   int currentDepth,
-                                   int maxDepth,
-                                   int currentNumChigiri,
-                                   int totalFrames,
-                                   Callback callback)
-{
-    const Kumipuyo* ptr;
-    int n;
-
-    Kumipuyo tmp;
-    if (currentDepth < kumipuyoSeq.size()) {
-        tmp = kumipuyoSeq.get(currentDepth);
-        ptr = &tmp;
-        n = 1;
-    } else {
-        ptr = ALL_KUMIPUYO_KINDS;
-        n = 10;
-    }
-
-    for (int j = 0; j < 22; j++) {
-        const Decision& decision = DECISIONS[j];
-        if (!PuyoController::isReachable(field, decision))
-            continue;
-
-        bool isChigiri = field.isChigiriDecision(decision);
-        int dropFrames = field.framesToDropNext(decision);
-        if (totalFrames != 0) { // is not first?
-            dropFrames += FRAMES_PREPARING_NEXT;
-        }
-
-        decisions.push_back(decision);
-        for (int i = 0; i < n; ++i) {
-            const Kumipuyo& kumipuyo = ptr[i];
-            int num_decisions = (kumipuyo.axis == kumipuyo.child) ? 11 : 22;
-            if (j >= num_decisions)
-                continue;
-
-            CoreField nextField(field);
-            if (!nextField.dropKumipuyo(decision, kumipuyo))
-                continue;
-
-            bool shouldFire = nextField.rensaWillOccurWhenLastDecisionIs(decision);
-            if (!shouldFire && !nextField.isEmpty(3, 12))
-                continue;
-
-            if (currentDepth + 1 == maxDepth || shouldFire) {
-                callback(nextField, decisions, currentNumChigiri + isChigiri, totalFrames, dropFrames, shouldFire);
-            } else {
-                iterateAvailablePlansInternal(nextField, kumipuyoSeq, decisions, currentDepth + 1, maxDepth,
-                                              currentNumChigiri + isChigiri, totalFrames + dropFrames, callback);
-            }
-        }
-        decisions.pop_back();
-    }
-}
-
 // static
 void Plan::iterateAvailablePlans(const CoreField& field,
                                  const KumipuyoSeq& kumipuyoSeq,
@@ -139,27 +114,13 @@ void Plan::iterateAvailablePlans(const CoreField& field,
     std::vector<Decision> decisions;
     decisions.reserve(maxDepth);
 
-    auto f = [&callback](const CoreField& fieldBeforeRensa, const std::vector<Decision>& decisions,
+    auto f = [&callback](CoreField& fieldBeforeRensa, const std::vector<Decision>& decisions,
                          int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire) {
-        DCHECK(!decisions.empty());
-
-        if (shouldFire) {
-            CoreField cf(fieldBeforeRensa);
-            RensaResult rensaResult = cf.simulate();
-            DCHECK_GT(rensaResult.chains, 0);
-            if (cf.isEmpty(3, 12)) {
-                callback(RefPlan(cf, decisions, rensaResult, numChigiri,
-                                 framesToIgnite, lastDropFrames, 0, 0, 0, 0, false));
-            }
-        } else {
-            DCHECK(fieldBeforeRensa.isEmpty(3, 12));
-            RensaResult rensaResult;
-            callback(RefPlan(fieldBeforeRensa, decisions, rensaResult, numChigiri,
-                             framesToIgnite, lastDropFrames, 0, 0, 0, 0, false));
-        }
+        callbackWithRefPlan(fieldBeforeRensa, decisions, numChigiri, framesToIgnite, lastDropFrames,
+                            shouldFire, callback);
     };
 
-    iterateAvailablePlansInternal(field, kumipuyoSeq, decisions, 0, maxDepth, 0, 0, f);
+    iterateAvailablePlansInternal(field, kumipuyoSeq, &decisions, 0, maxDepth, 0, 0, f);
 }
 
 // static
@@ -170,5 +131,224 @@ void Plan::iterateAvailablePlansWithoutFiring(const CoreField& field,
 {
     std::vector<Decision> decisions;
     decisions.reserve(maxDepth);
-    iterateAvailablePlansInternal(field, kumipuyoSeq, decisions, 0, maxDepth, 0, 0, callback);
+    iterateAvailablePlansInternal(field, kumipuyoSeq, &decisions, 0, maxDepth, 0, 0, callback);
+}
+
+// static
+void Plan::parallelIterateAvailablePlans(Executor* executor,
+                                         int numShards,
+                                         const CoreField& field,
+                                         const KumipuyoSeq& kumipuyoSeq,
+                                         int maxDepth,
+                                         const Plan::ParallelIterationCallback& callback)
+{
+    CHECK_GT(numShards, 0);
+
+    // A plan up to |splitDepth|. If it's not a leaf, the rest is enumerated by a task.
+    struct Work {
+        CoreField field;
+        Decision decisions[2];
+        int numDecisions;
+        int numChigiri;
+        int framesToIgnite;
+        int lastDropFrames;
+        bool shouldFire;
+    };
+
+    const int splitDepth = std::min(maxDepth >= 3 ? 2 : 1, maxDepth);
+    std::vector<Work> works;
+    {
+        std::vector<Decision> decisions;
+        decisions.reserve(splitDepth);
+        auto collect = [&works](const CoreField& fieldBeforeRensa, const std::vector<Decision>& decisions,
+                                int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire) {
+            Work work;
+            work.field = fieldBeforeRensa;
+            std::copy(decisions.begin(), decisions.end(), work.decisions);
+            work.numDecisions = static_cast<int>(decisions.size());
+            work.numChigiri = numChigiri;
+            work.framesToIgnite = framesToIgnite;
+            work.lastDropFrames = lastDropFrames;
+            work.shouldFire = shouldFire;
+            works.push_back(work);
+        };
+        iterateAvailablePlansInternal(field, kumipuyoSeq, &decisions, 0, splitDepth, 0, 0, collect);
+    }
+
+    std::atomic<size_t> nextWork(0);
+    auto runShard = [&](int shard) {
+        // The decisions are kept in a per-shard buffer, which is reused for all the works.
+        std::vector<Decision> decisions;
+        decisions.reserve(maxDepth);
+
+        auto f = [&callback, shard](CoreField& fieldBeforeRensa, const std::vector<Decision>& decisions,
+                                    int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire) {
+            callbackWithRefPlan(fieldBeforeRensa, decisions, numChigiri, framesToIgnite, lastDropFrames, shouldFire,
+                                [&callback, shard](const RefPlan& plan) { callback(shard, plan); });
+        };
+
+        while (true) {
+            size_t i = nextWork.fetch_add(1, memory_order_relaxed);
+            if (i >= works.size())
+                break;
+
+            // Each work is taken only once, so its field can be modified.
+            Work& work = works[i];
+            decisions.assign(work.decisions, work.decisions + work.numDecisions);
+            if (work.shouldFire || work.numDecisions == maxDepth) {
+                f(work.field, decisions, work.numChigiri, work.framesToIgnite, work.lastDropFrames, work.shouldFire);
+            } else {
+                iterateAvailablePlansInternal(work.field, kumipuyoSeq, &decisions, work.numDecisions, maxDepth,
+                                              work.numChigiri, work.framesToIgnite + work.lastDropFrames, f);
+            }
+        }
+    };
+
+    // Executor::wait() runs the shards while waiting, so this works even when it's called
+    // from a worker thread of the executor.
+    WaitGroup wg;
+    if (executor) {
+        for (int shard = 1; shard < numShards; ++shard)
+            executor->submit(&wg, [&runShard, shard]() { runShard(shard); });
+    }
+
+    runShard(0);
+    if (executor)
+        executor->wait(&wg);
+}
+
+// ExpectimaxSearcher searches the plans with expectimax. See expectimaxAvailablePlans().
+class Plan::ExpectimaxSearcher : noncopyable {
+public:
+    ExpectimaxSearcher(const KumipuyoSeq& kumipuyoSeq, int maxDepth, const PlanEvaluationCallback& evaluator) :
+        seq_(kumipuyoSeq),
+        numKnownKumipuyos_(kumipuyoSeq.size()),
+        maxDepth_(maxDepth),
+        evaluator_(evaluator),
+        memo_(maxDepth + 1)
+    {
+        // The unknown kumipuyos are filled on chance nodes.
+        if (seq_.size() < maxDepth)
+            seq_.resize(maxDepth);
+        decisions_.reserve(maxDepth);
+    }
+
+    ExpectimaxResult search(const CoreField& field)
+    {
+        ExpectimaxResult result;
+        result.found = evalKumipuyo(field, 0, 0, 0, &result.value, &result.decision);
+        result.numEvaluatedPlans = numEvaluatedPlans_;
+        result.numMergedPlans = numMergedPlans_;
+        return result;
+    }
+
+private:
+    struct Value {
+        bool found = false;
+        double value = 0.0;
+    };
+
+    // Returns the max value over the placements of the kumipuyo on |depth|.
+    // Returns false if there is no placement.
+    bool evalKumipuyo(const CoreField& field, int depth, int numChigiri, int totalFrames,
+                      double* value, Decision* bestDecision)
+    {
+        bool found = false;
+        auto f = [&](CoreField& nextField, const std::vector<Decision>& decisions,
+                     int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire) {
+            Value v = evalChild(nextField, numChigiri, framesToIgnite, lastDropFrames, shouldFire);
+            if (!v.found || (found && v.value <= *value))
+                return;
+            found = true;
+            *value = v.value;
+            if (bestDecision)
+                *bestDecision = decisions.back();
+        };
+
+        // Enumerates only the placements of the kumipuyo on |depth|.
+        iterateAvailablePlansInternal(field, seq_, &decisions_, depth, depth + 1, numChigiri, totalFrames, f);
+        return found;
+    }
+
+    // Returns the expected value over the kumipuyo kinds on |depth|.
+    // Returns false if no kind has a placement.
+    bool evalChanceNode(const CoreField& field, int depth, int numChigiri, int totalFrames, double* value)
+    {
+        if (depth < numKnownKumipuyos_)
+            return evalKumipuyo(field, depth, numChigiri, totalFrames, value, nullptr);
+
+        double sum = 0.0;
+        double totalProbability = 0.0;
+        for (const Kumipuyo& kumipuyo : ALL_KUMIPUYO_KINDS) {
+            seq_.setAxis(depth, kumipuyo.axis);
+            seq_.setChild(depth, kumipuyo.child);
+
+            double v;
+            if (!evalKumipuyo(field, depth, numChigiri, totalFrames, &v, nullptr))
+                continue;
+
+            double p = kumipuyoKindProbability(kumipuyo);
+            sum += p * v;
+            totalProbability += p;
+        }
+
+        if (totalProbability == 0.0)
+            return false;
+
+        *value = sum / totalProbability;
+        return true;
+    }
+
+    // Returns the value of |nextField|, which is the field just after the last decision.
+    Value evalChild(CoreField& nextField, int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire)
+    {
+        const int depth = static_cast<int>(decisions_.size());
+
+        // The key is the field before rensa. Since memo_[depth] is not modified by the deeper
+        // search, |it| is valid until this returns.
+        auto inserted = memo_[depth].emplace(nextField, Value());
+        auto it = inserted.first;
+        if (!inserted.second) {
+            ++numMergedPlans_;
+            return it->second;
+        }
+
+        Value v;
+        if (shouldFire || depth == maxDepth_) {
+            callbackWithRefPlan(nextField, decisions_, numChigiri, framesToIgnite, lastDropFrames, shouldFire,
+                                [this, &v](const RefPlan& plan) {
+                                    ++numEvaluatedPlans_;
+                                    v.found = true;
+                                    v.value = evaluator_(plan);
+                                });
+        } else {
+            v.found = evalChanceNode(nextField, depth, numChigiri, framesToIgnite + lastDropFrames, &v.value);
+        }
+
+        it->second = v;
+        return v;
+    }
+
+    KumipuyoSeq seq_;
+    const int numKnownKumipuyos_;
+    const int maxDepth_;
+    const PlanEvaluationCallback& evaluator_;
+    std::vector<Decision> decisions_;
+    // memo_[d] has the values of the fields after d decisions.
+    std::vector<std::unordered_map<CoreField, Value>> memo_;
+    int numEvaluatedPlans_ = 0;
+    int numMergedPlans_ = 0;
+};
+
+// static
+Plan::ExpectimaxResult Plan::expectimaxAvailablePlans(const CoreField& field,
+                                                      const KumipuyoSeq& kumipuyoSeq,
+                                                      int maxDepth,
+                                                      const Plan::PlanEvaluationCallback& evaluator)
+{
+    CHECK(!kumipuyoSeq.isEmpty()) << "the first kumipuyo should be known";
+    CHECK_GT(maxDepth, 0);
+
+    ExpectimaxSearcher searcher(kumipuyoSeq, maxDepth, evaluator);
+    return searcher.search(field);
 }
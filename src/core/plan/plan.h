@@ -5,21 +5,27 @@
 #include <string>
 #include <vector>
 
+#include <glog/logging.h>
+
 #include "base/noncopyable.h"
 #include "core/core_field.h"
 #include "core/decision.h"
+#include "core/frame.h"
+#include "core/kumipuyo.h"
+#include "core/kumipuyo_seq.h"
+#include "core/puyo_controller.h"
 #include "core/rensa_result.h"
 
-class KumipuyoSeq;
+class Executor;
 class RefPlan;
 
 class Plan {
 public:
     Plan() {}
-    Plan(const CoreField& field, const std::vector<Decision>& decisions,
+    Plan(const CoreField& field, const DecisionSpan& decisions,
          const RensaResult& rensaResult, int numChigiri, int framesToIgnite, int lastDropFrames,
          int fallenOjama, int fixedOjama, int pendingOjama, int ojamaCommittingFrameId, bool hasZenkeshi) :
-        field_(field), decisions_(decisions), rensaResult_(rensaResult),
+        field_(field), decisions_(decisions.begin(), decisions.end()), rensaResult_(rensaResult),
         numChigiri_(numChigiri), framesToIgnite_(framesToIgnite), lastDropFrames_(lastDropFrames),
         fallenOjama_(fallenOjama), fixedOjama_(fixedOjama), pendingOjama_(pendingOjama),
         ojamaCommittingFrameId_(ojamaCommittingFrameId), hasZenkeshi_(hasZenkeshi)
@@ -34,6 +40,60 @@ public:
                                 int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire)> RensaIterationCallback;
     static void iterateAvailablePlansWithoutFiring(const CoreField&, const KumipuyoSeq&, int depth, const RensaIterationCallback&);
 
+    typedef std::function<void (int shard, const RefPlan&)> ParallelIterationCallback;
+    // Same as iterateAvailablePlans(), but the plans are enumerated by |numShards| tasks in parallel.
+    // The first level (or the first 2 levels when |depth| >= 3) is split into independent works,
+    // and each task takes the works one by one. One task runs in the current thread, and the others
+    // are submitted to |executor|. This returns after all the plans are enumerated.
+    // |callback| is called with the index of the task (0 <= shard < |numShards|). The callback is
+    // never called concurrently for the same shard, so the caller can keep the results per shard
+    // without locks, and merge them after this returns. The order of the plans is not specified.
+    // If |executor| is nullptr, all the works run in the current thread.
+    static void parallelIterateAvailablePlans(Executor*, int numShards, const CoreField&, const KumipuyoSeq&,
+                                              int depth, const ParallelIterationCallback&);
+
+    // ExpectimaxResult is the result of expectimaxAvailablePlans().
+    struct ExpectimaxResult {
+        // True if any plan is found. If false, the other fields are not meaningful.
+        bool found = false;
+        // The first decision that has the max expected value, and the value.
+        Decision decision;
+        double value = 0.0;
+        // The number of plans that are evaluated, and the number of plans whose value is
+        // reused from the identical field.
+        int numEvaluatedPlans = 0;
+        int numMergedPlans = 0;
+    };
+
+    typedef std::function<double (const RefPlan&)> PlanEvaluationCallback;
+    // Searches the plans up to |depth| with expectimax, and returns the best first decision.
+    // The first kumipuyo of |kumipuyoSeq| must be known. On the depth where the kumipuyo is
+    // known, the value is the max over the placements. On the depth where the kumipuyo is unknown
+    // (chance node), the value is the expectation over the 10 kinds of kumipuyo with
+    // kumipuyoKindProbability(). The kinds that have no placement are excluded from the expectation.
+    // |evaluator| is called for each leaf plan, i.e. a plan that fires or reaches |depth|.
+    // The identical fields at the same depth (e.g. R then B vs B then R) are merged, so
+    // |evaluator| is called only for the first path that reaches the field.
+    static ExpectimaxResult expectimaxAvailablePlans(const CoreField&, const KumipuyoSeq&, int depth,
+                                                     const PlanEvaluationCallback& evaluator);
+    // Returns the probability that an unknown kumipuyo is |kumipuyo|.
+    // Since a kumipuyo of 2 colors has 2 orders (e.g. RB and BR), the probability is 2/16.
+    // The probability of a kumipuyo of the same colors is 1/16.
+    static double kumipuyoKindProbability(const Kumipuyo& kumipuyo) { return kumipuyo.isRep() ? 1.0 / 16 : 2.0 / 16; }
+
+    // The max depth of visitAvailablePlans().
+    static const int MAX_VISIT_DEPTH = 8;
+
+    // Same as iterateAvailablePlans(), but |callback| is inlined, and the decisions are kept
+    // in a fixed-size array on stack, so no memory is allocated. |callback| is called as
+    //   callback(const CoreField& field, const Decision* decisions, int numDecisions,
+    //            const RensaResult& rensaResult, int numChigiri, int framesToIgnite, int lastDropFrames)
+    // where |field| is the field after the rensa.
+    // As iterateAvailablePlans(), for a kumipuyo of the same colors, the placements that make
+    // the same field (e.g. (3, 0) and (3, 2) for RR) are enumerated only once.
+    template<typename Callback>
+    static void visitAvailablePlans(const CoreField&, const KumipuyoSeq&, int depth, Callback callback);
+
     const CoreField& field() const { return field_; }
 
     const Decision& firstDecision() const { return decisions_[0]; }
@@ -64,6 +124,43 @@ public:
 
     friend bool operator==(const Plan& lhs, const Plan& rhs);
 private:
+    class ExpectimaxSearcher;
+
+    // DecisionStack is a fixed-size stack of decisions. This has the subset of the interface
+    // of std::vector<Decision> that iterateAvailablePlansInternal() uses.
+    class DecisionStack {
+    public:
+        void push_back(const Decision& decision)
+        {
+            DCHECK_LT(size_, MAX_VISIT_DEPTH);
+            decisions_[size_++] = decision;
+        }
+        void pop_back() { --size_; }
+
+        const Decision* data() const { return decisions_; }
+        int size() const { return size_; }
+
+    private:
+        Decision decisions_[MAX_VISIT_DEPTH];
+        int size_ = 0;
+    };
+
+    // |callback| is called with the field before the rensa. Since the field is a temporary
+    // copy, |callback| can modify it.
+    template<typename Decisions, typename Callback>
+    static void iterateAvailablePlansInternal(const CoreField&, const KumipuyoSeq&, Decisions*,
+                                              int currentDepth, int maxDepth,
+                                              int currentNumChigiri, int totalFrames, Callback& callback);
+
+    // All the decisions. For a kumipuyo of the same colors, the first NUM_REP_DECISIONS
+    // decisions make all the distinct fields, e.g. (3, 2) makes the same field as (3, 0).
+    static const int NUM_DECISIONS = 22;
+    static const int NUM_REP_DECISIONS = 11;
+    static const Decision DECISIONS[NUM_DECISIONS];
+    // All the kinds of kumipuyo. This is used when the kumipuyo is unknown.
+    static const int NUM_KUMIPUYO_KINDS = 10;
+    static const Kumipuyo ALL_KUMIPUYO_KINDS[NUM_KUMIPUYO_KINDS];
+
     CoreField field_;      // Future field (after the rensa has been finished).
     std::vector<Decision> decisions_;
     RensaResult rensaResult_;
@@ -89,7 +186,8 @@ public:
     {
     }
 
-    RefPlan(const CoreField& field, const std::vector<Decision>& decisions,
+    // |decisions| can be in any vector, e.g. ArenaVector<Decision>.
+    RefPlan(const CoreField& field, const DecisionSpan& decisions,
             const RensaResult& rensaResult, int numChigiri, int framesToIgnite, int lastDropFrames,
             int fallenOjama, int fixedOjama, int pendingOjama, int ojamaCommittingFrameId, bool hasZenkeshi) :
         field_(field), decisions_(decisions), rensaResult_(rensaResult),
@@ -100,7 +198,7 @@ public:
     }
 
     const CoreField& field() const { return field_; }
-    const std::vector<Decision>& decisions() const { return decisions_; }
+    const DecisionSpan& decisions() const { return decisions_; }
     const Decision& decision(int nth) const { return decisions_[nth]; }
     const Decision& firstDecision() const { return decision(0); }
     size_t decisionSize() const { return decisions_.size(); }
@@ -131,7 +229,7 @@ public:
 
 private:
     const CoreField& field_;
-    const std::vector<Decision>& decisions_;
+    DecisionSpan decisions_;
     const RensaResult& rensaResult_;
     int numChigiri_;
     int framesToIgnite_;
@@ -143,4 +241,97 @@ private:
     bool hasZenkeshi_;
 };
 
+// static
+template<typename Callback>
+void Plan::visitAvailablePlans(const CoreField& field,
+                               const KumipuyoSeq& kumipuyoSeq,
+                               int maxDepth,
+                               Callback callback)
+{
+    DCHECK(0 < maxDepth && maxDepth <= MAX_VISIT_DEPTH) << maxDepth;
+
+    DecisionStack decisions;
+    auto f = [&callback](CoreField& fieldBeforeRensa, const DecisionStack& decisions,
+                         int numChigiri, int framesToIgnite, int lastDropFrames, bool shouldFire) {
+        DCHECK_GT(decisions.size(), 0);
+
+        RensaResult rensaResult;
+        if (shouldFire) {
+            // |fieldBeforeRensa| is not used after this, so the rensa is simulated in place.
+            rensaResult = fieldBeforeRensa.simulate();
+            DCHECK_GT(rensaResult.chains, 0);
+            if (!fieldBeforeRensa.isEmpty(3, 12))
+                return;
+        }
+
+        callback(fieldBeforeRensa, decisions.data(), decisions.size(),
+                 rensaResult, numChigiri, framesToIgnite, lastDropFrames);
+    };
+
+    iterateAvailablePlansInternal(field, kumipuyoSeq, &decisions, 0, maxDepth, 0, 0, f);
+}
+
+// static
+template<typename Decisions, typename Callback>
+void Plan::iterateAvailablePlansInternal(const CoreField& field,
+                                         const KumipuyoSeq& kumipuyoSeq,
+                                         Decisions* decisions,
+                                         int currentDepth,
+                                         int maxDepth,
+                                         int currentNumChigiri,
+                                         int totalFrames,
+                                         Callback& callback)
+{
+    const Kumipuyo* ptr;
+    int n;
+
+    Kumipuyo tmp;
+    if (currentDepth < kumipuyoSeq.size()) {
+        tmp = kumipuyoSeq.get(currentDepth);
+        ptr = &tmp;
+        n = 1;
+    } else {
+        ptr = ALL_KUMIPUYO_KINDS;
+        n = NUM_KUMIPUYO_KINDS;
+    }
+
+    // When the kumipuyo is known and its colors are the same, the duplicated placements are
+    // skipped up front.
+    int numDecisions = (n == 1 && ptr->isRep()) ? NUM_REP_DECISIONS : NUM_DECISIONS;
+    for (int j = 0; j < numDecisions; j++) {
+        const Decision& decision = DECISIONS[j];
+        if (!PuyoController::isReachable(field, decision))
+            continue;
+
+        bool isChigiri = field.isChigiriDecision(decision);
+        int dropFrames = field.framesToDropNext(decision);
+        if (totalFrames != 0) { // is not first?
+            dropFrames += FRAMES_PREPARING_NEXT;
+        }
+
+        decisions->push_back(decision);
+        for (int i = 0; i < n; ++i) {
+            const Kumipuyo& kumipuyo = ptr[i];
+            if (j >= (kumipuyo.isRep() ? NUM_REP_DECISIONS : NUM_DECISIONS))
+                continue;
+
+            CoreField nextField(field);
+            if (!nextField.dropKumipuyo(decision, kumipuyo))
+                continue;
+
+            bool shouldFire = nextField.rensaWillOccurWhenLastDecisionIs(decision);
+            if (!shouldFire && !nextField.isEmpty(3, 12))
+                continue;
+
+            if (currentDepth + 1 == maxDepth || shouldFire) {
+                callback(nextField, *decisions, currentNumChigiri + isChigiri, totalFrames, dropFrames, shouldFire);
+            } else {
+                iterateAvailablePlansInternal(nextField, kumipuyoSeq, decisions, currentDepth + 1, maxDepth,
+                                              currentNumChigiri + isChigiri, totalFrames + dropFrames, callback);
+            }
+        }
+        decisions->pop_back();
+    }
+}
+
 #endif // CORE_PLAN_PLAN_H_
@@ -1,13 +1,52 @@
 #include "core/plan/plan.h"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "base/executor.h"
 #include "base/time_stamp_counter.h"
 #include "core/core_field.h"
 #include "core/kumipuyo_seq.h"
 
 using namespace std;
 
+namespace {
+
+void runIterateAndVisit(const CoreField& field, const KumipuyoSeq& seq, int depth)
+{
+    TimeStampCounterData tscIterate;
+    TimeStampCounterData tscVisit;
+
+    int iterateCount = 0;
+    int visitCount = 0;
+    for (int i = 0; i < 10; i++) {
+        {
+            ScopedTimeStampCounter stsc(&tscIterate);
+            Plan::iterateAvailablePlans(field, seq, depth, [&](const RefPlan& plan) {
+                iterateCount += plan.chains() + 1;
+            });
+        }
+        {
+            ScopedTimeStampCounter stsc(&tscVisit);
+            Plan::visitAvailablePlans(field, seq, depth, [&](const CoreField&, const Decision*, int,
+                                                             const RensaResult& rensaResult, int, int, int) {
+                visitCount += rensaResult.chains + 1;
+            });
+        }
+    }
+    EXPECT_EQ(iterateCount, visitCount);
+
+    cout << "iterateAvailablePlans:" << endl;
+    tscIterate.showStatistics();
+    cout << "visitAvailablePlans:" << endl;
+    tscVisit.showStatistics();
+}
+
+} // anonymous namespace
+
 TEST(PlanPerformanceTest, Empty44)
 {
     TimeStampCounterData tsc;
@@ -125,3 +164,84 @@ TEST(PlanPerformanceTest, Filled24)
 
     tsc.showStatistics();
 }
+
+TEST(PlanPerformanceTest, IterateVsVisitEmpty2)
+{
+    runIterateAndVisit(CoreField(), KumipuyoSeq("RRGG"), 2);
+}
+
+TEST(PlanPerformanceTest, IterateVsVisitEmpty3)
+{
+    // Since seq has 2 kumipuyo, this will try all kumipuyo color possibilities on the 3rd.
+    runIterateAndVisit(CoreField(), KumipuyoSeq("RRGG"), 3);
+}
+
+TEST(PlanPerformanceTest, IterateVsVisitFilled2)
+{
+    CoreField f("B....."
+                "R....."
+                "B....."
+                "R....."
+                "BR...."
+                "BR...."
+                "BYRBY."
+                "RBYRBY"
+                "RBYRBY"
+                "RBYRBY");
+    runIterateAndVisit(f, KumipuyoSeq("BBGG"), 2);
+}
+
+TEST(PlanPerformanceTest, IterateVsVisitFilled3)
+{
+    CoreField f("B....."
+                "R....."
+                "B....."
+                "R....."
+                "BR...."
+                "BR...."
+                "BYRBY."
+                "RBYRBY"
+                "RBYRBY"
+                "RBYRBY");
+    runIterateAndVisit(f, KumipuyoSeq("BBGGYR"), 3);
+}
+
+TEST(PlanPerformanceTest, SequentialVsParallel3)
+{
+    const int numShards = std::max(1U, std::thread::hardware_concurrency());
+    Executor executor(numShards - 1);
+    executor.start();
+
+    CoreField f;
+    // Since seq has 2 kumipuyo, this will try all kumipuyo color possibilities on the 3rd.
+    KumipuyoSeq seq("RRGB");
+
+    TimeStampCounterData tscSequential;
+    TimeStampCounterData tscParallel;
+    for (int i = 0; i < 10; i++) {
+        int sequentialCount = 0;
+        {
+            ScopedTimeStampCounter stsc(&tscSequential);
+            Plan::iterateAvailablePlans(f, seq, 3, [&](const RefPlan&) { ++sequentialCount; });
+        }
+
+        vector<int> counts(numShards);
+        {
+            ScopedTimeStampCounter stsc(&tscParallel);
+            Plan::parallelIterateAvailablePlans(&executor, numShards, f, seq, 3, [&](int shard, const RefPlan&) {
+                ++counts[shard];
+            });
+        }
+
+        int parallelCount = 0;
+        for (int count : counts)
+            parallelCount += count;
+        EXPECT_EQ(sequentialCount, parallelCount);
+    }
+
+    cout << "shards: " << numShards << endl;
+    cout << "sequential:" << endl;
+    tscSequential.showStatistics();
+    cout << "parallel:" << endl;
+    tscParallel.showStatistics();
+}
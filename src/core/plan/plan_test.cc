@@ -1,7 +1,14 @@
 #include "core/plan/plan.h"
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "base/executor.h"
+#include "base/wait_group.h"
 #include "core/core_field.h"
 #include "core/kumipuyo_seq.h"
 
@@ -72,3 +79,268 @@ TEST(Plan, numChigiri)
 
     EXPECT_TRUE(found);
 }
+
+TEST(Plan, visitAvailablePlans)
+{
+    CoreField field(
+        "  R   "
+        " BYY  "
+        "RRBBG ");
+    KumipuyoSeq seq("RBGY");
+
+    vector<string> expected;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan& plan) {
+        ostringstream ss;
+        ss << toString(plan.decisions()) << ' ' << plan.chains() << ' ' << plan.score() << ' '
+           << plan.numChigiri() << ' ' << plan.framesToIgnite() << ' ' << plan.lastDropFrames() << '\n'
+           << plan.field().toDebugString();
+        expected.push_back(ss.str());
+    });
+
+    vector<string> actual;
+    Plan::visitAvailablePlans(field, seq, 2, [&](const CoreField& f, const Decision* decisions, int numDecisions,
+                                                 const RensaResult& rensaResult, int numChigiri,
+                                                 int framesToIgnite, int lastDropFrames) {
+        ostringstream ss;
+        ss << toString(vector<Decision>(decisions, decisions + numDecisions)) << ' '
+           << rensaResult.chains << ' ' << rensaResult.score << ' '
+           << numChigiri << ' ' << framesToIgnite << ' ' << lastDropFrames << '\n'
+           << f.toDebugString();
+        actual.push_back(ss.str());
+    });
+
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(Plan, visitAvailablePlansRep)
+{
+    CoreField field;
+    KumipuyoSeq seq("RR");
+
+    // 6 vertical placements and 5 horizontal placements.
+    int count = 0;
+    Plan::visitAvailablePlans(field, seq, 1, [&](const CoreField&, const Decision*, int,
+                                                 const RensaResult&, int, int, int) {
+        ++count;
+    });
+    EXPECT_EQ(11, count);
+}
+
+TEST(Plan, parallelIterateAvailablePlans)
+{
+    CoreField field(
+        "  R   "
+        " BYY  "
+        "RRBBG ");
+    KumipuyoSeq seq("RBGY");
+
+    auto toText = [](const RefPlan& plan) {
+        ostringstream ss;
+        ss << toString(plan.decisions()) << ' ' << plan.chains() << ' ' << plan.score() << ' '
+           << plan.numChigiri() << ' ' << plan.framesToIgnite() << ' ' << plan.lastDropFrames() << '\n'
+           << plan.field().toDebugString();
+        return ss.str();
+    };
+
+    for (int depth = 1; depth <= 3; ++depth) {
+        vector<string> expected;
+        Plan::iterateAvailablePlans(field, seq, depth, [&](const RefPlan& plan) {
+            expected.push_back(toText(plan));
+        });
+        sort(expected.begin(), expected.end());
+
+        const int NUM_SHARDS = 3;
+        Executor executor(NUM_SHARDS - 1);
+        executor.start();
+
+        vector<vector<string>> results(NUM_SHARDS);
+        Plan::parallelIterateAvailablePlans(&executor, NUM_SHARDS, field, seq, depth, [&](int shard, const RefPlan& plan) {
+            results[shard].push_back(toText(plan));
+        });
+
+        vector<string> actual;
+        for (const auto& result : results)
+            actual.insert(actual.end(), result.begin(), result.end());
+        sort(actual.begin(), actual.end());
+
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(expected, actual) << "depth=" << depth;
+    }
+}
+
+TEST(Plan, parallelIterateAvailablePlansWithoutExecutor)
+{
+    CoreField field;
+    KumipuyoSeq seq("RBGY");
+
+    int expected = 0;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan&) { ++expected; });
+
+    int actual = 0;
+    Plan::parallelIterateAvailablePlans(nullptr, 4, field, seq, 2, [&](int shard, const RefPlan&) {
+        EXPECT_EQ(0, shard);
+        ++actual;
+    });
+
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(Plan, parallelIterateAvailablePlansFromWorker)
+{
+    CoreField field;
+    KumipuyoSeq seq("RBGY");
+
+    int expected = 0;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan&) { ++expected; });
+
+    // The only worker calls parallelIterateAvailablePlans(). Since this thread doesn't run
+    // the tasks while waiting, nobody else can run the shards.
+    Executor executor(1);
+    executor.start();
+
+    vector<int> counts(4);
+    WaitGroup wg;
+    wg.add(1);
+    executor.submit([&]() {
+        Plan::parallelIterateAvailablePlans(&executor, 4, field, seq, 2, [&](int shard, const RefPlan&) {
+            ++counts[shard];
+        });
+        wg.done();
+    });
+    wg.waitUntilDone();
+
+    int actual = 0;
+    for (int count : counts)
+        actual += count;
+    EXPECT_EQ(expected, actual);
+}
+
+TEST(Plan, kumipuyoKindProbability)
+{
+    double sum = 0.0;
+    for (PuyoColor c1 : NORMAL_PUYO_COLORS) {
+        for (PuyoColor c2 : NORMAL_PUYO_COLORS) {
+            if (c1 <= c2)
+                sum += Plan::kumipuyoKindProbability(Kumipuyo(c1, c2));
+        }
+    }
+    EXPECT_DOUBLE_EQ(1.0, sum);
+    EXPECT_DOUBLE_EQ(1.0 / 16, Plan::kumipuyoKindProbability(Kumipuyo(PuyoColor::RED, PuyoColor::RED)));
+    EXPECT_DOUBLE_EQ(2.0 / 16, Plan::kumipuyoKindProbability(Kumipuyo(PuyoColor::RED, PuyoColor::BLUE)));
+}
+
+TEST(Plan, expectimaxAvailablePlansKnown)
+{
+    CoreField field(
+        "  R   "
+        " BYY  "
+        "RRBBG ");
+    KumipuyoSeq seq("RBYY");
+
+    // The value depends only on the field and the rensa, so merging doesn't change the result.
+    auto evaluator = [](const RefPlan& plan) {
+        return plan.score() + plan.field().countPuyos() * 0.5 + plan.field().height(1);
+    };
+
+    double expected = -1;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan& plan) {
+        expected = max(expected, evaluator(plan));
+    });
+
+    Plan::ExpectimaxResult result = Plan::expectimaxAvailablePlans(field, seq, 2, evaluator);
+    EXPECT_TRUE(result.found);
+    EXPECT_DOUBLE_EQ(expected, result.value);
+    EXPECT_LT(0, result.numEvaluatedPlans);
+
+    double bestOfDecision = -1;
+    Plan::iterateAvailablePlans(field, seq, 2, [&](const RefPlan& plan) {
+        if (plan.firstDecision() == result.decision)
+            bestOfDecision = max(bestOfDecision, evaluator(plan));
+    });
+    EXPECT_DOUBLE_EQ(expected, bestOfDecision);
+}
+
+TEST(Plan, expectimaxAvailablePlansChanceNode)
+{
+    CoreField field(
+        "  R   "
+        " BYY  "
+        "RRBBG ");
+    KumipuyoSeq seq("RB");
+
+    auto evaluator = [](const RefPlan& plan) {
+        return plan.score() + plan.field().countPuyos() * 0.5 + plan.field().height(1);
+    };
+
+    // Computes the expectimax by brute force: for each first decision, takes the max over
+    // the second decisions for each kind, and the expectation over the kinds.
+    static const Kumipuyo KINDS[] = {
+        Kumipuyo(PuyoColor::RED, PuyoColor::RED),
+        Kumipuyo(PuyoColor::RED, PuyoColor::BLUE),
+        Kumipuyo(PuyoColor::RED, PuyoColor::YELLOW),
+        Kumipuyo(PuyoColor::RED, PuyoColor::GREEN),
+        Kumipuyo(PuyoColor::BLUE, PuyoColor::BLUE),
+        Kumipuyo(PuyoColor::BLUE, PuyoColor::YELLOW),
+        Kumipuyo(PuyoColor::BLUE, PuyoColor::GREEN),
+        Kumipuyo(PuyoColor::YELLOW, PuyoColor::YELLOW),
+        Kumipuyo(PuyoColor::YELLOW, PuyoColor::GREEN),
+        Kumipuyo(PuyoColor::GREEN, PuyoColor::GREEN),
+    };
+
+    double expected = -1;
+    for (const Decision& first : { Decision(1, 0), Decision(2, 0), Decision(3, 0), Decision(4, 0), Decision(5, 0),
+                                   Decision(6, 0), Decision(1, 1), Decision(2, 1), Decision(3, 1), Decision(4, 1),
+                                   Decision(5, 1), Decision(1, 2), Decision(2, 2), Decision(3, 2), Decision(4, 2),
+                                   Decision(5, 2), Decision(6, 2), Decision(2, 3), Decision(3, 3), Decision(4, 3),
+                                   Decision(5, 3), Decision(6, 3) }) {
+        bool hasFirst = false;
+        double firstValue = -1;
+        double sum = 0;
+        double totalProbability = 0;
+        for (const Kumipuyo& kind : KINDS) {
+            KumipuyoSeq s { seq.get(0), kind };
+            double best = -1;
+            Plan::iterateAvailablePlans(field, s, 2, [&](const RefPlan& plan) {
+                if (plan.firstDecision() != first)
+                    return;
+                hasFirst = true;
+                if (plan.decisionSize() == 1)
+                    firstValue = evaluator(plan);
+                else
+                    best = max(best, evaluator(plan));
+            });
+            if (best >= 0) {
+                sum += Plan::kumipuyoKindProbability(kind) * best;
+                totalProbability += Plan::kumipuyoKindProbability(kind);
+            }
+        }
+        if (!hasFirst)
+            continue;
+        // A first decision that fires is a leaf.
+        double value = firstValue >= 0 ? firstValue : sum / totalProbability;
+        expected = max(expected, value);
+    }
+
+    Plan::ExpectimaxResult result = Plan::expectimaxAvailablePlans(field, seq, 2, evaluator);
+    EXPECT_TRUE(result.found);
+    EXPECT_NEAR(expected, result.value, 1e-9);
+}
+
+TEST(Plan, expectimaxAvailablePlansMergesIdenticalFields)
+{
+    CoreField field;
+    KumipuyoSeq seq("RR");
+
+    int numEvaluated = 0;
+    Plan::ExpectimaxResult result = Plan::expectimaxAvailablePlans(field, seq, 3, [&](const RefPlan&) {
+        ++numEvaluated;
+        return 1.0;
+    });
+
+    EXPECT_TRUE(result.found);
+    EXPECT_DOUBLE_EQ(1.0, result.value);
+    EXPECT_EQ(numEvaluated, result.numEvaluatedPlans);
+    // e.g. BB on column 1 then YY on column 2 and YY on column 2 then BB on column 1.
+    EXPECT_LT(0, result.numMergedPlans);
+}
@@ -4,12 +4,18 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 
 #include "base/base.h"
+#include "base/deadline.h"
+#include "core/bit_field.h"
+#include "core/bit_field_batch.h"
 #include "core/column_puyo.h"
 #include "core/column_puyo_list.h"
 #include "core/core_field.h"
+#include "core/field_bits.h"
 #include "core/field_checker.h"
 #include "core/position.h"
 #include "core/puyo_color.h"
@@ -76,43 +82,54 @@ const int EXTENTIONS[][3][2] = {
     {{-1, 1}, { 0, 1}, { 0, 2}},
 };
 
-}  // namespace anomymous
+// Returns the bits of (x, fromY), (x, fromY + 1), ..., (x, toY).
+FieldBits columnBits(int x, int fromY, int toY)
+{
+    FieldBits bits;
+    for (int y = fromY; y <= toY; ++y)
+        bits.set(x, y);
+    return bits;
+}
 
-// detectByDropStrategy complements puyos in |originalField|, and fires a rensa.
-// The complemented puyos are always grounded (This is the different point of tryFloatFire).
-// For each detected rensa, |callback| is called.
-// static
-void RensaDetector::detectByDropStrategy(const CoreField& originalField,
-                                         const bool prohibits[FieldConstant::MAP_WIDTH],
-                                         PurposeForFindingRensa purpose,
-                                         int maxComplementPuyos,
-                                         int maxPuyoHeight,
-                                         const RensaDetector::ComplementCallback& callback)
+// The following functions enumerate the puyos to complement |originalField| with.
+// For each candidate, |f| is called with the ColumnPuyoList to drop on |originalField|.
+// The candidates always fit in |maxPuyoHeight|, so dropping them never fails.
+
+template<typename Func>
+void iterateDropStrategyCandidates(const CoreField& originalField,
+                                   const bool prohibits[FieldConstant::MAP_WIDTH],
+                                   PurposeForFindingRensa purpose,
+                                   int maxComplementPuyos,
+                                   int maxPuyoHeight,
+                                   Func f)
 {
+    const BitField& originalBitField = originalField.bitField();
     bool visited[FieldConstant::MAP_WIDTH][NUM_PUYO_COLORS] {};
 
-    FieldBits normalColorBits = originalField.bitField().normalColorBits();
-    FieldBits emptyBits = originalField.bitField().bits(PuyoColor::EMPTY);
+    FieldBits normalColorBits = originalBitField.normalColorBits();
+    FieldBits emptyBits = originalBitField.bits(PuyoColor::EMPTY);
 
     FieldBits edgeBits = (normalColorBits & emptyBits.expandEdge()).maskedField12();
 
     edgeBits.iterateBitPositions([&](int x, int y) {
         DCHECK(originalField.isNormalColor(x, y));
 
-        PuyoColor c = originalField.color(x, y);
+        PuyoColor c = originalBitField.color(x, y);
+        FieldBits colorBits = originalBitField.bits(c);
 
         // Drop puyo on
         for (int d = -1; d <= 1; ++d) {
-            if (prohibits[x + d])
+            int xx = x + d;
+            if (prohibits[xx])
                 continue;
 
-            if (visited[x + d][ordinal(c)])
+            if (visited[xx][ordinal(c)])
                 continue;
 
-            if (x + d <= 0 || FieldConstant::WIDTH < x + d)
+            if (xx <= 0 || FieldConstant::WIDTH < xx)
                 continue;
             if (d == 0) {
-                if (!originalField.isEmpty(x, y + 1))
+                if (!originalBitField.isEmpty(x, y + 1))
                     continue;
 
                 // If the first rensa is this, any rensa won't continue.
@@ -123,67 +140,60 @@ void RensaDetector::detectByDropStrategy(const CoreField& originalField,
                 // CAAACC
                 //
                 // So, we should be able to skip this.
-                if (purpose == PurposeForFindingRensa::FOR_FIRE && !originalField.isConnectedPuyo(x, y))
+                if (purpose == PurposeForFindingRensa::FOR_FIRE && !originalBitField.isConnectedPuyo(x, y, c))
                     continue;
             } else {
-                if (!originalField.isEmpty(x + d, y))
+                if (!originalBitField.isEmpty(xx, y))
                     continue;
             }
 
-            visited[x + d][ordinal(c)] = true;
+            visited[xx][ordinal(c)] = true;
 
+            // Drops |c| on column |xx| until the top puyo is connected with 4 or more puyos.
+            int height = originalField.height(xx);
+            int maxHeight = std::min(std::min(13, maxPuyoHeight), height + maxComplementPuyos);
             int necessaryPuyos = 0;
-
-            bool ok = true;
-            CoreField cf(originalField);
-            while (true) {
-                if (!cf.dropPuyoOnWithMaxHeight(x + d, c, maxPuyoHeight)) {
-                    ok = false;
+            for (int yy = height + 1; yy <= std::min(maxHeight, FieldConstant::HEIGHT); ++yy) {
+                FieldBits bits = (colorBits | columnBits(xx, height + 1, yy)).maskedField12();
+                if (FieldBits(xx, yy).expand4(bits).popcount() >= 4) {
+                    necessaryPuyos = yy - height;
                     break;
                 }
-
-                ++necessaryPuyos;
-
-                if (maxComplementPuyos < necessaryPuyos) {
-                    ok = false;
-                    break;
-                }
-                if (cf.countConnectedPuyosMax4(x + d, cf.height(x + d), c) >= 4)
-                    break;
             }
-
-            if (!ok)
+            if (necessaryPuyos == 0)
                 continue;
 
             ColumnPuyoList cpl;
-            if (!cpl.add(x + d, c, necessaryPuyos))
+            if (!cpl.add(xx, c, necessaryPuyos))
                 continue;
 
-            callback(std::move(cf), cpl);
+            f(cpl);
         }
     });
 }
 
-// static
-void RensaDetector::detectByFloatStrategy(const CoreField& originalField,
-                                          const bool prohibits[FieldConstant::MAP_WIDTH],
-                                          int maxComplementPuyos,
-                                          int maxPuyoHeight,
-                                          const RensaDetector::ComplementCallback& callback)
+template<typename Func>
+void iterateFloatStrategyCandidates(const CoreField& originalField,
+                                    const bool prohibits[FieldConstant::MAP_WIDTH],
+                                    int maxComplementPuyos,
+                                    int maxPuyoHeight,
+                                    Func f)
 {
-    FieldBits normalColorBits = originalField.bitField().normalColorBits();
-    FieldBits emptyBits = originalField.bitField().bits(PuyoColor::EMPTY);
+    const BitField& originalBitField = originalField.bitField();
+
+    FieldBits normalColorBits = originalBitField.normalColorBits();
+    FieldBits emptyBits = originalBitField.bits(PuyoColor::EMPTY);
 
     FieldBits edgeBits = (normalColorBits & emptyBits.expandEdge()).maskedField12();
 
     edgeBits.iterateBitPositions([&](int x, int y) {
         DCHECK(originalField.isNormalColor(x, y));
 
-        int necessaryPuyos = 4 - originalField.countConnectedPuyosMax4(x, y);
+        int necessaryPuyos = 4 - originalBitField.countConnectedPuyosMax4(x, y);
         if (necessaryPuyos > maxComplementPuyos)
             return;
 
-        PuyoColor c = originalField.color(x, y);
+        PuyoColor c = originalBitField.color(x, y);
 
         // float puyo col dx
         for (int dx = x - 1; dx <= x + 1; ++dx) {
@@ -191,124 +201,107 @@ void RensaDetector::detectByFloatStrategy(const CoreField& originalField,
                 continue;
             if (prohibits[dx])
                 continue;
-            if (x != dx && !originalField.isEmpty(dx, y))
+            if (x != dx && !originalBitField.isEmpty(dx, y))
                 continue;
 
-            CoreField cf(originalField);
+            // Puts OJAMA under the complemented puyos so that they float at |y|.
+            int height = originalField.height(dx);
+            int numOjama = std::max(0, y - necessaryPuyos - height);
+            if (std::min(13, maxPuyoHeight) < height + numOjama + necessaryPuyos)
+                continue;
 
-            int restPuyos = necessaryPuyos;
             ColumnPuyoList cpl;
-
-            bool ok = true;
-            while (cf.height(dx) + restPuyos < y) {
-                if (!cf.dropPuyoOnWithMaxHeight(dx, PuyoColor::OJAMA, maxPuyoHeight)) {
-                    ok = false;
-                    break;
-                }
-                if (!cpl.add(dx, PuyoColor::OJAMA)) {
-                    ok = false;
-                    break;
-                }
-            }
-            if (!ok)
+            if (!cpl.add(dx, PuyoColor::OJAMA, numOjama))
                 continue;
-
-            while (restPuyos-- > 0) {
-                if (!cf.dropPuyoOnWithMaxHeight(dx, c, maxPuyoHeight)) {
-                    ok = false;
-                    break;
-                }
-                if (!cpl.add(dx, c)) {
-                    ok = false;
-                    break;
-                }
-            }
-            if (!ok)
+            if (!cpl.add(dx, c, necessaryPuyos))
                 continue;
 
-            callback(std::move(cf), cpl);
+            f(cpl);
         }
     });
 }
 
-// static
-void RensaDetector::detectByExtendStrategy(const CoreField& originalField,
-                                           const bool prohibits[FieldConstant::MAP_WIDTH],
-                                           int maxComplementPuyos,
-                                           int maxPuyoHeight,
-                                           const RensaDetector::ComplementCallback& callback)
+template<typename Func>
+void iterateExtendStrategyCandidates(const CoreField& originalField,
+                                     const bool prohibits[FieldConstant::MAP_WIDTH],
+                                     int maxComplementPuyos,
+                                     int maxPuyoHeight,
+                                     Func f)
 {
+    const BitField& originalBitField = originalField.bitField();
+
+    // The extension may use a puyo on the 13th row, but can't complement a puyo above
+    // |maxPuyoHeight|.
+    auto isInField = [](int x, int y) {
+        return 1 <= x && x <= FieldConstant::WIDTH && 1 <= y && y <= 13;
+    };
+
+    // Returns true if EXTENTIONS[i] from |origin| consists of empty cells or |c|.
+    // If |mustPosition| is given, it must be also in EXTENTIONS[i].
+    auto canExtend = [&](const Position& origin, size_t i, PuyoColor c, const Position* mustPosition) {
+        bool found = !mustPosition;
+        for (int j = 0; j < 3; ++j) {
+            int xx = origin.x + EXTENTIONS[i][j][0];
+            int yy = origin.y + EXTENTIONS[i][j][1];
+            if (!isInField(xx, yy))
+                return false;
+            PuyoColor cc = originalBitField.color(xx, yy);
+            if (!(cc == PuyoColor::EMPTY || cc == c))
+                return false;
+            if (mustPosition && Position(xx, yy) == *mustPosition)
+                found = true;
+        }
+        return found;
+    };
+
+    // Complements |c| on the positions of EXTENTIONS[i] from |origin|.
+    auto extend = [&](const Position& origin, size_t i, PuyoColor c) {
+        FieldBits complemented;
+        ColumnPuyoList cpl;
+        for (int j = 0; j < 3; ++j) {
+            int xx = origin.x + EXTENTIONS[i][j][0];
+            int yy = origin.y + EXTENTIONS[i][j][1];
+            if (originalBitField.isColor(xx, yy, c) || complemented.get(xx, yy))
+                continue;
+            DCHECK(originalBitField.isEmpty(xx, yy));
+            if (originalBitField.isEmpty(xx, yy - 1) && !complemented.get(xx, yy - 1))
+                return;
+            if (prohibits[xx])
+                return;
+            if (std::min(13, maxPuyoHeight) < yy)
+                return;
+            if (!cpl.add(xx, c))
+                return;
+            complemented.set(xx, yy);
+        }
+
+        if (maxComplementPuyos < cpl.size())
+            return;
+
+        f(cpl);
+    };
+
     FieldBits checked;
     Position positions[FieldConstant::HEIGHT * FieldConstant::WIDTH];
     int working[FieldConstant::HEIGHT * FieldConstant::WIDTH];
 
     for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
         for (int y = std::min(12, originalField.height(x)); y >= 1; --y) {
-
-            PuyoColor c = originalField.color(x, y);
+            PuyoColor c = originalBitField.color(x, y);
             if (!isNormalColor(c))
                 continue;
             if (checked.get(x, y))
                 continue;
-            if (!originalField.hasEmptyNeighbor(x, y))
+            if (!originalBitField.hasEmptyNeighbor(x, y))
                 continue;
-            Position* const head = originalField.fillSameColorPosition(x, y, c, positions, &checked);
+            Position* const head = originalBitField.fillSameColorPosition(x, y, c, positions, &checked);
             int size = head - positions;
             switch (size) {
             case 1: {
                 Position origin = positions[0];
                 for (size_t i = 0; i < ARRAY_SIZE(EXTENTIONS); ++i) {
-                    bool ok = true;
-                    for (int j = 0; j < 3; ++j) {
-                        int xx = origin.x + EXTENTIONS[i][j][0];
-                        int yy = origin.y + EXTENTIONS[i][j][1];
-                        if (xx < 1 || FieldConstant::WIDTH < x || yy < 1 || FieldConstant::HEIGHT < y) {
-                            ok = false;
-                            break;
-                        }
-                        if (!(originalField.color(xx, yy) == PuyoColor::EMPTY || originalField.color(xx, yy) == c)) {
-                            ok = false;
-                            break;
-                        }
-                    }
-                    if (!ok)
-                        continue;
-
-                    CoreField cf(originalField);
-                    ColumnPuyoList cpl;
-                    for (int j = 0; j < 3; ++j) {
-                        int xx = origin.x + EXTENTIONS[i][j][0];
-                        int yy = origin.y + EXTENTIONS[i][j][1];
-                        if (xx < 1 || FieldConstant::WIDTH < x || yy < 1 || FieldConstant::HEIGHT < y) {
-                            continue;
-                        }
-                        if (cf.color(xx, yy) == c)
-                            continue;
-                        DCHECK_EQ(originalField.color(xx, yy), PuyoColor::EMPTY);
-                        if (cf.color(xx, yy - 1) == PuyoColor::EMPTY) {
-                            ok = false;
-                            break;
-                        }
-                        if (prohibits[xx]) {
-                            ok = false;
-                            break;
-                        }
-                        if (!cf.dropPuyoOnWithMaxHeight(xx, c, maxPuyoHeight)) {
-                            ok = false;
-                            break;
-                        }
-                        if (!cpl.add(xx, c)) {
-                            ok = false;
-                            break;
-                        }
-                    }
-
-                    if (!ok)
-                        continue;
-                    if (maxComplementPuyos < cpl.size())
-                        continue;
-
-                    callback(std::move(cf), cpl);
+                    if (canExtend(origin, i, c, nullptr))
+                        extend(origin, i, c);
                 }
                 break;
             }
@@ -324,92 +317,34 @@ void RensaDetector::detectByExtendStrategy(const CoreField& originalField,
                 }
 
                 for (size_t i = 0; i < ARRAY_SIZE(EXTENTIONS); ++i) {
-                    bool ok = false;
-                    for (int j = 0; j < 3; ++j) {
-                        int xx = origin.x + EXTENTIONS[i][j][0];
-                        int yy = origin.y + EXTENTIONS[i][j][1];
-                        if (xx < 1 || FieldConstant::WIDTH < x || yy < 1 || FieldConstant::HEIGHT < y) {
-                            ok = false;
-                            break;
-                        }
-                        if (!(originalField.color(xx, yy) == PuyoColor::EMPTY || originalField.color(xx, yy) == c)) {
-                            ok = false;
-                            break;
-                        }
-                        if (Position(xx, yy) == mustPosition)
-                            ok = true;
-                    }
-
-                    if (!ok)
-                        continue;
-
-                    CoreField cf(originalField);
-                    ColumnPuyoList cpl;
-                    for (int j = 0; j < 3; ++j) {
-                        int xx = origin.x + EXTENTIONS[i][j][0];
-                        int yy = origin.y + EXTENTIONS[i][j][1];
-                        if (xx < 1 || FieldConstant::WIDTH < x || yy < 1 || FieldConstant::HEIGHT < y)
-                            continue;
-                        if (cf.color(xx, yy) == c)
-                            continue;
-                        DCHECK_EQ(originalField.color(xx, yy), PuyoColor::EMPTY);
-                        if (cf.color(xx, yy - 1) == PuyoColor::EMPTY) {
-                            ok = false;
-                            break;
-                        }
-                        if (prohibits[xx]) {
-                            ok = false;
-                            break;
-                        }
-                        if (!cf.dropPuyoOnWithMaxHeight(xx, c, maxPuyoHeight)) {
-                            ok = false;
-                            break;
-                        }
-                        if (!cpl.add(xx, c)) {
-                            ok = false;
-                            break;
-                        }
-                    }
-
-                    if (!ok) {
-                        continue;
-                    }
-
-                    if (maxComplementPuyos < cpl.size()) {
-                        continue;
-                    }
-
-                    callback(std::move(cf), cpl);
+                    if (canExtend(origin, i, c, &mustPosition))
+                        extend(origin, i, c);
                 }
                 break;
             }
             case 3: {
                 int pos = 0;
                 for (Position* p = positions; p != head; ++p) {
-                    if (originalField.isEmpty(p->x + 1, p->y) && !originalField.isEmpty(p->x + 1, p->y - 1))
+                    if (originalBitField.isEmpty(p->x + 1, p->y) && !originalBitField.isEmpty(p->x + 1, p->y - 1))
                         working[pos++] = p->x + 1;
-                    if (originalField.isEmpty(p->x - 1, p->y) && !originalField.isEmpty(p->x - 1, p->y - 1))
+                    if (originalBitField.isEmpty(p->x - 1, p->y) && !originalBitField.isEmpty(p->x - 1, p->y - 1))
                         working[pos++] = p->x - 1;
-                    if (originalField.isEmpty(p->x, p->y + 1) && !originalField.isEmpty(p->x, p->y))
+                    if (originalBitField.isEmpty(p->x, p->y + 1) && !originalBitField.isEmpty(p->x, p->y))
                         working[pos++] = p->x;
-                    if (originalField.isEmpty(p->x, p->y - 1) && !originalField.isEmpty(p->x, p->y - 2))
+                    if (originalBitField.isEmpty(p->x, p->y - 1) && !originalBitField.isEmpty(p->x, p->y - 2))
                         working[pos++] = p->x;
                 }
                 std::sort(working, working + pos);
                 int* endX = std::unique(working, working + pos);
-                for (int i = 0; i < endX - working; ++i) {
-                    int xx = working[i];
-                    if (prohibits[xx])
-                        continue;
-                    CoreField cf(originalField);
-                    if (!cf.dropPuyoOn(xx, c))
+                for (int* xx = working; xx != endX; ++xx) {
+                    if (prohibits[*xx])
                         continue;
-                    if (maxPuyoHeight < cf.height(xx))
+                    if (std::min(13, maxPuyoHeight) < originalField.height(*xx) + 1)
                         continue;
                     ColumnPuyoList cpl;
-                    if (!cpl.add(working[i], c))
+                    if (!cpl.add(*xx, c))
                         continue;
-                    callback(std::move(cf), cpl);
+                    f(cpl);
                 }
                 break;
             }
@@ -420,6 +355,147 @@ void RensaDetector::detectByExtendStrategy(const CoreField& originalField,
     }
 }
 
+// Calls |f| for each candidate of |strategy|.
+template<typename Func>
+void iterateCandidates(const CoreField& originalField,
+                       const RensaDetectorStrategy& strategy,
+                       const bool prohibits[FieldConstant::MAP_WIDTH],
+                       PurposeForFindingRensa purpose,
+                       int maxComplementPuyos,
+                       int maxPuyoHeight,
+                       Func f)
+{
+    switch (strategy.mode()) {
+    case RensaDetectorStrategy::Mode::DROP:
+        iterateDropStrategyCandidates(originalField, prohibits, purpose, maxComplementPuyos, maxPuyoHeight, f);
+        break;
+    case RensaDetectorStrategy::Mode::FLOAT:
+        iterateFloatStrategyCandidates(originalField, prohibits, maxComplementPuyos, maxPuyoHeight, f);
+        break;
+    case RensaDetectorStrategy::Mode::EXTEND:
+        iterateExtendStrategyCandidates(originalField, prohibits, maxComplementPuyos, maxPuyoHeight, f);
+        break;
+    default:
+        CHECK(false) << "Unknown mode : " << static_cast<int>(strategy.mode());
+    }
+}
+
+// Calls |callback| with |originalField| complemented by |cpl|.
+void complementAndCallback(const CoreField& originalField,
+                           const ColumnPuyoList& cpl,
+                           const RensaDetector::ComplementCallback& callback)
+{
+    CoreField cf(originalField);
+    if (!cf.dropPuyoListWithMaxHeight(cpl, 13)) {
+        DCHECK(false) << cpl.toString() << '\n' << originalField.toDebugString();
+        return;
+    }
+    callback(std::move(cf), cpl);
+}
+
+}  // namespace anomymous
+
+// detectByDropStrategy complements puyos in |originalField|, and fires a rensa.
+// The complemented puyos are always grounded (This is the different point of tryFloatFire).
+// For each detected rensa, |callback| is called.
+// static
+void RensaDetector::detectByDropStrategy(const CoreField& originalField,
+                                         const bool prohibits[FieldConstant::MAP_WIDTH],
+                                         PurposeForFindingRensa purpose,
+                                         int maxComplementPuyos,
+                                         int maxPuyoHeight,
+                                         const RensaDetector::ComplementCallback& callback)
+{
+    iterateDropStrategyCandidates(originalField, prohibits, purpose, maxComplementPuyos, maxPuyoHeight,
+                                  [&](const ColumnPuyoList& cpl) {
+        complementAndCallback(originalField, cpl, callback);
+    });
+}
+
+// static
+void RensaDetector::detectByFloatStrategy(const CoreField& originalField,
+                                          const bool prohibits[FieldConstant::MAP_WIDTH],
+                                          int maxComplementPuyos,
+                                          int maxPuyoHeight,
+                                          const RensaDetector::ComplementCallback& callback)
+{
+    iterateFloatStrategyCandidates(originalField, prohibits, maxComplementPuyos, maxPuyoHeight,
+                                   [&](const ColumnPuyoList& cpl) {
+        complementAndCallback(originalField, cpl, callback);
+    });
+}
+
+// static
+void RensaDetector::detectByExtendStrategy(const CoreField& originalField,
+                                           const bool prohibits[FieldConstant::MAP_WIDTH],
+                                           int maxComplementPuyos,
+                                           int maxPuyoHeight,
+                                           const RensaDetector::ComplementCallback& callback)
+{
+    iterateExtendStrategyCandidates(originalField, prohibits, maxComplementPuyos, maxPuyoHeight,
+                                    [&](const ColumnPuyoList& cpl) {
+        complementAndCallback(originalField, cpl, callback);
+    });
+}
+
+namespace {
+
+// BatchedRensaSimulator simulates the complemented fields in batches, and appends the fields
+// that fire a rensa to |results|.
+class BatchedRensaSimulator {
+public:
+    explicit BatchedRensaSimulator(vector<RensaDetector::DetectedRensa>* results) : results_(results) {}
+
+    void add(const BitField& complementedField, const ColumnPuyoList& cpl)
+    {
+        fields_[size_] = complementedField;
+        cpls_[size_] = cpl;
+        if (++size_ == BATCH_SIZE)
+            flush();
+    }
+
+    void flush()
+    {
+        RensaResult rensaResults[BATCH_SIZE];
+        BitFieldBatch::simulate(fields_, size_, rensaResults);
+        for (size_t i = 0; i < size_; ++i) {
+            if (rensaResults[i].chains > 0)
+                results_->push_back(RensaDetector::DetectedRensa { cpls_[i], rensaResults[i] });
+        }
+        size_ = 0;
+    }
+
+private:
+    static const size_t BATCH_SIZE = 16;
+
+    vector<RensaDetector::DetectedRensa>* results_;
+    BitField fields_[BATCH_SIZE];
+    ColumnPuyoList cpls_[BATCH_SIZE];
+    size_t size_ = 0;
+};
+
+void detectSingleBatchedInternal(const CoreField& originalField,
+                                 const RensaDetectorStrategy& strategy,
+                                 BatchedRensaSimulator* simulator)
+{
+    const bool noProhibits[FieldConstant::MAP_WIDTH] {};
+    const BitField& originalBitField = originalField.bitField();
+
+    iterateCandidates(originalField, strategy, noProhibits, PurposeForFindingRensa::FOR_FIRE,
+                      strategy.maxNumOfComplementPuyosForFire(), 12, [&](const ColumnPuyoList& cpl) {
+        BitField bf(originalBitField);
+        for (int x = 1; x <= FieldConstant::WIDTH; ++x) {
+            int height = originalField.height(x);
+            for (int i = 0; i < cpl.sizeOn(x); ++i)
+                bf.setColor(x, height + i + 1, cpl.get(x, i));
+        }
+        simulator->add(bf, cpl);
+    });
+    simulator->flush();
+}
+
+}  // anonymous namespace
+
 // static
 void RensaDetector::detect(const CoreField& originalField,
                            const RensaDetectorStrategy& strategy,
@@ -428,7 +504,7 @@ void RensaDetector::detect(const CoreField& originalField,
                            const RensaDetector::ComplementCallback& callback)
 {
     int maxPuyoHeight = 12;
-    int complementPuyos;
+    int complementPuyos = 0;
     switch (purpose) {
     case PurposeForFindingRensa::FOR_KEY:
         complementPuyos = strategy.maxNumOfComplementPuyosForKey();
@@ -442,19 +518,10 @@ void RensaDetector::detect(const CoreField& originalField,
         CHECK(false);
     }
 
-    switch (strategy.mode()) {
-    case RensaDetectorStrategy::Mode::DROP:
-        detectByDropStrategy(originalField, prohibits, purpose, complementPuyos, maxPuyoHeight, callback);
-        break;
-    case RensaDetectorStrategy::Mode::FLOAT:
-        detectByFloatStrategy(originalField, prohibits, complementPuyos, maxPuyoHeight, callback);
-        break;
-    case RensaDetectorStrategy::Mode::EXTEND:
-        detectByExtendStrategy(originalField, prohibits, complementPuyos, maxPuyoHeight, callback);
-        break;
-    default:
-        CHECK(false) << "Unknown mode : " << static_cast<int>(strategy.mode());
-    }
+    iterateCandidates(originalField, strategy, prohibits, purpose, complementPuyos, maxPuyoHeight,
+                      [&](const ColumnPuyoList& cpl) {
+        complementAndCallback(originalField, cpl, callback);
+    });
 }
 
 // static
@@ -466,15 +533,28 @@ void RensaDetector::detectSingle(const CoreField& cf,
     detect(cf, strategy, PurposeForFindingRensa::FOR_FIRE, noProhibits, callback);
 }
 
+// static
+void RensaDetector::detectSingleBatched(const CoreField& originalField,
+                                        const RensaDetectorStrategy& strategy,
+                                        vector<DetectedRensa>* results)
+{
+    BatchedRensaSimulator simulator(results);
+    detectSingleBatchedInternal(originalField, strategy, &simulator);
+}
+
 // static
 void RensaDetector::detectIteratively(const CoreField& originalField,
                                       const RensaDetectorStrategy& strategy,
                                       int maxIteration,
-                                      const RensaSimulationCallback& callback)
+                                      const RensaSimulationCallback& callback,
+                                      const Deadline* deadline)
 {
     DCHECK_LE(1, maxIteration);
 
     auto detectCallback = [&](CoreField&& complementedField, const ColumnPuyoList& firePuyos) {
+        if (deadline && deadline->isExpired())
+            return;
+
         CoreField cf(complementedField);
         RensaLastVanishedPositionTracker tracker;
 
@@ -488,11 +568,12 @@ void RensaDetector::detectIteratively(const CoreField& originalField,
         bool prohibits[FieldConstant::MAP_WIDTH] {};
         makeProhibitArray(originalField, strategy, tracker.result(), firePuyos, prohibits);
         detectIterativelyInternal(originalField, strategy, cf, maxIteration - 1,
-                                  ColumnPuyoList(), firePuyos, chains, prohibits, callback);
+                                  ColumnPuyoList(), firePuyos, chains, prohibits, callback, deadline);
     };
 
     bool prohibits[FieldConstant::MAP_WIDTH] {};
-    detect(originalField, strategy, PurposeForFindingRensa::FOR_FIRE, prohibits, detectCallback);
+    // Pass the lambda with std::ref so that std::function doesn't copy it to the heap.
+    detect(originalField, strategy, PurposeForFindingRensa::FOR_FIRE, prohibits, std::ref(detectCallback));
 }
 
 // static
@@ -504,12 +585,16 @@ void RensaDetector::detectIterativelyInternal(const CoreField& originalField,
                                               const ColumnPuyoList& firstRensaFirePuyos,
                                               int currentTotalChains,
                                               const bool prohibits[FieldConstant::MAP_WIDTH],
-                                              const RensaSimulationCallback& callback)
+                                              const RensaSimulationCallback& callback,
+                                              const Deadline* deadline)
 {
     if (restIterations <= 0)
         return;
 
     auto detectCallback = [&](CoreField&& complementedField, const ColumnPuyoList& currentFirePuyos) {
+        if (deadline && deadline->isExpired())
+            return;
+
         RensaLastVanishedPositionTracker tracker;
         int partialChains = complementedField.simulateFast(&tracker);
         if (partialChains == 0)
@@ -551,10 +636,10 @@ void RensaDetector::detectIterativelyInternal(const CoreField& originalField,
 
         detectIterativelyInternal(originalField, strategy, complementedField,
                                   restIterations - 1, combinedKeyPuyos, firstRensaFirePuyos,
-                                  combinedRensaResult.chains, newProhibits, callback);
+                                  combinedRensaResult.chains, newProhibits, callback, deadline);
     };
 
-    detect(currentField, strategy, PurposeForFindingRensa::FOR_KEY, prohibits, detectCallback);
+    detect(currentField, strategy, PurposeForFindingRensa::FOR_KEY, prohibits, std::ref(detectCallback));
 }
 
 // static
@@ -568,7 +653,7 @@ void RensaDetector::detectSideChain(const CoreField& originalField,
         detectSideChainFromDetectedField(originalField, complementedField, strategy, firePuyoList, callback);
     };
 
-    detect(originalField, strategy, PurposeForFindingRensa::FOR_FIRE, noProhibitedColumn, detectCallback);
+    detect(originalField, strategy, PurposeForFindingRensa::FOR_FIRE, noProhibitedColumn, std::ref(detectCallback));
 }
 
 // static
@@ -611,7 +696,7 @@ void RensaDetector::detectSideChainFromDetectedField(const CoreField& originalFi
         };
 
         // Finds 2-multi or 3-multi.
-        detect(detectedField, strategy, PurposeForFindingRensa::FOR_KEY, prohibitedColumns, detectCallback);
+        detect(detectedField, strategy, PurposeForFindingRensa::FOR_KEY, prohibitedColumns, std::ref(detectCallback));
     }
 }
 
@@ -2,15 +2,17 @@
 #define CORE_RENSA_RENSA_DETECTOR_H_
 
 #include <functional>
+#include <vector>
 
 #include "base/base.h"
 #include "core/rensa/rensa_detector_strategy.h"
+#include "core/column_puyo_list.h"
 #include "core/core_field.h"
 #include "core/field_constant.h"
+#include "core/rensa_result.h"
 #include "core/rensa_tracker/rensa_last_vanished_position_tracker.h"
 
-class ColumnPuyoList;
-struct RensaResult;
+class Deadline;
 
 enum class PurposeForFindingRensa {
     FOR_FIRE,
@@ -27,21 +29,38 @@ public:
     typedef std::function<RensaResult (CoreField&& complementedField,
                                        const ColumnPuyoList& complementedColumnPuyoList)> RensaSimulationCallback;
 
+    // DetectedRensa is a rensa found by detectSingleBatched().
+    struct DetectedRensa {
+        ColumnPuyoList complementedColumnPuyoList;
+        RensaResult rensaResult;
+    };
+
     // Detects a rensa from the field with the specified strategy.
     static void detectSingle(const CoreField&,
                              const RensaDetectorStrategy&,
                              const ComplementCallback&);
 
+    // Same as detectSingle() followed by CoreField::simulate(), but faster.
+    // The complemented fields are built as BitField without copying CoreField, and are simulated
+    // in batches (see BitFieldBatch). The complemented puyos and the rensa result are appended
+    // to |results| in the same order as detectSingle(). Complements that don't fire a rensa
+    // are not appended.
+    static void detectSingleBatched(const CoreField&,
+                                    const RensaDetectorStrategy&,
+                                    std::vector<DetectedRensa>* results);
+
     // Detects a rensa iteratively from CoreField.
     // Algorithm is like the following (not accurate):
     // 1. Detects a rensa.
     // 2. Try to detect another rensa after the field where the previous rensa is finished.
     // 3. Complement 2's ColumnPuyoList, and 1's ColumnPuyoList, and check the size of rensa.
     // Do (2)-(3) |maxIteration - 1| times.
+    // When |deadline| is specified and has expired, the detection stops on the way.
     static void detectIteratively(const CoreField&,
                                   const RensaDetectorStrategy&,
                                   int maxIteration,
-                                  const RensaSimulationCallback&);
+                                  const RensaSimulationCallback&,
+                                  const Deadline* deadline = nullptr);
 
     // Finds 2-double (or more).
     static void detectSideChain(const CoreField&,
@@ -107,7 +126,8 @@ private:
                                           const ColumnPuyoList& firstRensaFirePuyos,
                                           int currentTotalChains,
                                           const bool prohibits[FieldConstant::MAP_WIDTH],
-                                          const RensaSimulationCallback&);
+                                          const RensaSimulationCallback&,
+                                          const Deadline*);
 
     static void complementKeyPuyos13thRowInternal(CoreField& currentField,
                                                   ColumnPuyoList& currentKeyPuyos,
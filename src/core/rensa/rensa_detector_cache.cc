@@ -0,0 +1,174 @@
+#include "core/rensa/rensa_detector_cache.h"
+
+#include <glog/logging.h>
+
+#include "base/deadline.h"
+#include "core/column_puyo_list.h"
+#include "core/core_field.h"
+#include "core/puyo_color.h"
+#include "core/rensa_result.h"
+
+using namespace std;
+
+RensaDetectorCache::RensaDetectorCache(size_t maxBytes) :
+    maxBytes_(maxBytes)
+{
+}
+
+void RensaDetectorCache::detectIteratively(const CoreField& originalField,
+                                           const RensaDetectorStrategy& strategy,
+                                           int maxIteration,
+                                           const RensaDetector::RensaSimulationCallback& callback,
+                                           const Deadline* deadline)
+{
+    Key key = makeKey(originalField, strategy, maxIteration);
+
+    shared_ptr<const Trace> trace;
+    {
+        lock_guard<mutex> lock(mu_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            ++numHits_;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            trace = it->second->second;
+        } else {
+            ++numMisses_;
+        }
+    }
+
+    if (trace) {
+        replay(originalField, *trace, callback);
+        return;
+    }
+
+    TraceBuffer buffer;
+    auto recordingCallback = [&](CoreField&& complementedField, const ColumnPuyoList& cpl) -> RensaResult {
+        encode(cpl, &buffer);
+        return callback(std::move(complementedField), cpl);
+    };
+    RensaDetector::detectIteratively(originalField, strategy, maxIteration, recordingCallback, deadline);
+    if (deadline && deadline->isExpired())
+        return;
+
+    insert(key, make_shared<const Trace>(buffer.begin(), buffer.end()));
+}
+
+void RensaDetectorCache::clear()
+{
+    lock_guard<mutex> lock(mu_);
+    entries_.clear();
+    index_.clear();
+    usedBytes_ = 0;
+    numHits_ = 0;
+    numMisses_ = 0;
+}
+
+size_t RensaDetectorCache::numEntries() const
+{
+    lock_guard<mutex> lock(mu_);
+    return entries_.size();
+}
+
+size_t RensaDetectorCache::numHits() const
+{
+    lock_guard<mutex> lock(mu_);
+    return numHits_;
+}
+
+size_t RensaDetectorCache::numMisses() const
+{
+    lock_guard<mutex> lock(mu_);
+    return numMisses_;
+}
+
+double RensaDetectorCache::hitRate() const
+{
+    lock_guard<mutex> lock(mu_);
+    if (numHits_ + numMisses_ == 0)
+        return 0.0;
+    return static_cast<double>(numHits_) / (numHits_ + numMisses_);
+}
+
+size_t RensaDetectorCache::memoryUsage() const
+{
+    lock_guard<mutex> lock(mu_);
+    return usedBytes_;
+}
+
+// static
+RensaDetectorCache::Key RensaDetectorCache::makeKey(const CoreField& field,
+                                                    const RensaDetectorStrategy& strategy,
+                                                    int maxIteration)
+{
+    Key key;
+    key.field = field.bitField();
+    key.fieldHash = field.hash();
+    key.mode = strategy.mode();
+    key.maxNumOfComplementPuyosForKey = strategy.maxNumOfComplementPuyosForKey();
+    key.maxNumOfComplementPuyosForFire = strategy.maxNumOfComplementPuyosForFire();
+    key.allowsPuttingKeyPuyoOn13thRow = strategy.allowsPuttingKeyPuyoOn13thRow();
+    key.maxIteration = maxIteration;
+    return key;
+}
+
+// static
+void RensaDetectorCache::encode(const ColumnPuyoList& cpl, TraceBuffer* trace)
+{
+    trace->push_back(static_cast<uint8_t>(cpl.size()));
+    for (int x = 1; x <= 6; ++x) {
+        for (int i = 0; i < cpl.sizeOn(x); ++i)
+            trace->push_back(static_cast<uint8_t>(x << 4 | ordinal(cpl.get(x, i))));
+    }
+}
+
+// static
+size_t RensaDetectorCache::entryBytes(const Trace& trace)
+{
+    // The list node, the index node, the trace and its control block.
+    // This is approximate, since the overhead of the allocator is not known.
+    return sizeof(EntryList::value_type) + 2 * sizeof(void*) +
+        sizeof(Key) + sizeof(EntryList::iterator) + 2 * sizeof(void*) +
+        sizeof(Trace) + 2 * sizeof(long) + trace.capacity();
+}
+
+void RensaDetectorCache::replay(const CoreField& originalField,
+                                const Trace& trace,
+                                const RensaDetector::RensaSimulationCallback& callback) const
+{
+    size_t pos = 0;
+    while (pos < trace.size()) {
+        int size = trace[pos++];
+        ColumnPuyoList cpl;
+        for (int i = 0; i < size; ++i) {
+            uint8_t v = trace[pos++];
+            cpl.add(v >> 4, static_cast<PuyoColor>(v & 0xF));
+        }
+
+        CoreField cf(originalField);
+        CHECK(cf.dropPuyoList(cpl)) << cpl.toString() << '\n' << originalField.toDebugString();
+        (void)callback(std::move(cf), cpl);
+    }
+}
+
+void RensaDetectorCache::insert(const Key& key, shared_ptr<const Trace> trace)
+{
+    size_t bytes = entryBytes(*trace);
+    if (maxBytes_ < bytes)
+        return;
+
+    lock_guard<mutex> lock(mu_);
+    // Another thread might have inserted the same key.
+    if (index_.count(key))
+        return;
+
+    while (maxBytes_ < usedBytes_ + bytes) {
+        DCHECK(!entries_.empty());
+        usedBytes_ -= entryBytes(*entries_.back().second);
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+
+    entries_.emplace_front(key, std::move(trace));
+    index_.emplace(key, entries_.begin());
+    usedBytes_ += bytes;
+}
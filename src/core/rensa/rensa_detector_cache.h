@@ -0,0 +1,115 @@
+#ifndef CORE_RENSA_RENSA_DETECTOR_CACHE_H_
+#define CORE_RENSA_RENSA_DETECTOR_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/arena.h"
+#include "base/noncopyable.h"
+#include "core/bit_field.h"
+#include "core/rensa/rensa_detector.h"
+#include "core/rensa/rensa_detector_strategy.h"
+
+// RensaDetectorCache memoizes RensaDetector::detectIteratively().
+//
+// The same field is often detected again and again, e.g. in consecutive think() calls, or
+// when the enemy field is gazed. For each (field, strategy, maxIteration), the cache stores
+// the ColumnPuyoLists that detectIteratively() passed to the callback. On a hit, the callback
+// is called with the same complemented fields in the same order, without detection.
+//
+// Since detectIteratively() uses the RensaResult returned by the callback for pruning,
+// the callback must return the result of simulating the complemented field (as all the
+// callbacks do in practice). Otherwise, the replayed calls might differ from the detection.
+//
+// The cache is bounded by bytes, and the least recently used entry is evicted first.
+// The cache can be shared by threads. The callback is not called with the lock held.
+class RensaDetectorCache : noncopyable {
+public:
+    explicit RensaDetectorCache(std::size_t maxBytes);
+
+    // Same as RensaDetector::detectIteratively(), but the result is cached.
+    // When |deadline| has expired during the detection, the result is not cached,
+    // since the detection might have stopped on the way.
+    void detectIteratively(const CoreField&,
+                           const RensaDetectorStrategy&,
+                           int maxIteration,
+                           const RensaDetector::RensaSimulationCallback&,
+                           const Deadline* deadline = nullptr);
+
+    void clear();
+
+    std::size_t numEntries() const;
+    std::size_t numHits() const;
+    std::size_t numMisses() const;
+    // Returns numHits / (numHits + numMisses). 0 if no lookup has been done.
+    double hitRate() const;
+    // Returns the approximate number of bytes used by the entries.
+    std::size_t memoryUsage() const;
+    std::size_t maxBytes() const { return maxBytes_; }
+
+private:
+    struct Key {
+        BitField field;
+        std::size_t fieldHash;
+        RensaDetectorStrategy::Mode mode;
+        int maxNumOfComplementPuyosForKey;
+        int maxNumOfComplementPuyosForFire;
+        bool allowsPuttingKeyPuyoOn13thRow;
+        int maxIteration;
+
+        friend bool operator==(const Key& lhs, const Key& rhs)
+        {
+            return lhs.fieldHash == rhs.fieldHash &&
+                lhs.mode == rhs.mode &&
+                lhs.maxNumOfComplementPuyosForKey == rhs.maxNumOfComplementPuyosForKey &&
+                lhs.maxNumOfComplementPuyosForFire == rhs.maxNumOfComplementPuyosForFire &&
+                lhs.allowsPuttingKeyPuyoOn13thRow == rhs.allowsPuttingKeyPuyoOn13thRow &&
+                lhs.maxIteration == rhs.maxIteration &&
+                lhs.field == rhs.field;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const
+        {
+            std::uint64_t params = static_cast<std::uint64_t>(key.mode) |
+                static_cast<std::uint64_t>(key.maxNumOfComplementPuyosForKey) << 8 |
+                static_cast<std::uint64_t>(key.maxNumOfComplementPuyosForFire) << 16 |
+                static_cast<std::uint64_t>(key.allowsPuttingKeyPuyoOn13thRow) << 24 |
+                static_cast<std::uint64_t>(key.maxIteration) << 32;
+            return static_cast<std::size_t>(key.fieldHash ^ (params * 0x9E3779B97F4A7C15ULL));
+        }
+    };
+
+    // The ColumnPuyoLists are encoded into bytes. A ColumnPuyoList is the number of puyos,
+    // followed by (x << 4 | color) for each puyo.
+    typedef std::vector<std::uint8_t> Trace;
+    // A trace is recorded in the arena of the current ArenaScope (if any) while detecting,
+    // and then copied to a Trace of the exact size to be cached.
+    typedef ArenaVector<std::uint8_t> TraceBuffer;
+    typedef std::list<std::pair<Key, std::shared_ptr<const Trace>>> EntryList;
+
+    static Key makeKey(const CoreField&, const RensaDetectorStrategy&, int maxIteration);
+    static void encode(const ColumnPuyoList&, TraceBuffer*);
+    static std::size_t entryBytes(const Trace&);
+
+    void replay(const CoreField&, const Trace&, const RensaDetector::RensaSimulationCallback&) const;
+    void insert(const Key&, std::shared_ptr<const Trace>);
+
+    const std::size_t maxBytes_;
+
+    mutable std::mutex mu_;
+    EntryList entries_;  // The most recently used entry is at front.
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index_;
+    std::size_t usedBytes_ = 0;
+    std::size_t numHits_ = 0;
+    std::size_t numMisses_ = 0;
+};
+
+#endif // CORE_RENSA_RENSA_DETECTOR_CACHE_H_
@@ -0,0 +1,178 @@
+#include "core/rensa/rensa_detector_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "base/deadline.h"
+#include "core/column_puyo_list.h"
+#include "core/core_field.h"
+#include "core/rensa_result.h"
+
+using namespace std;
+
+namespace {
+
+typedef vector<pair<CoreField, ColumnPuyoList>> Calls;
+
+RensaDetector::RensaSimulationCallback recordingCallback(Calls* calls)
+{
+    return [calls](CoreField&& cf, const ColumnPuyoList& cpl) -> RensaResult {
+        calls->emplace_back(cf, cpl);
+        return cf.simulate();
+    };
+}
+
+const CoreField& testField()
+{
+    static const CoreField field(
+        "  R G "
+        "R GRBG"
+        "RBGRBG"
+        "RBGRBG");
+    return field;
+}
+
+} // anonymous namespace
+
+TEST(RensaDetectorCacheTest, replay)
+{
+    const RensaDetectorStrategy strategies[] = {
+        RensaDetectorStrategy::defaultDropStrategy(),
+        RensaDetectorStrategy::defaultFloatStrategy(),
+        RensaDetectorStrategy::defaultExtendStrategy(),
+    };
+
+    RensaDetectorCache cache(1024 * 1024);
+    for (const RensaDetectorStrategy& strategy : strategies) {
+        for (int maxIteration = 1; maxIteration <= 3; ++maxIteration) {
+            Calls expected;
+            RensaDetector::detectIteratively(testField(), strategy, maxIteration, recordingCallback(&expected));
+
+            Calls miss;
+            cache.detectIteratively(testField(), strategy, maxIteration, recordingCallback(&miss));
+            Calls hit;
+            cache.detectIteratively(testField(), strategy, maxIteration, recordingCallback(&hit));
+
+            EXPECT_FALSE(expected.empty());
+            EXPECT_EQ(expected, miss);
+            EXPECT_EQ(expected, hit);
+        }
+    }
+
+    EXPECT_EQ(9U, cache.numEntries());
+    EXPECT_EQ(9U, cache.numHits());
+    EXPECT_EQ(9U, cache.numMisses());
+    EXPECT_DOUBLE_EQ(0.5, cache.hitRate());
+    EXPECT_LT(0U, cache.memoryUsage());
+    EXPECT_GE(cache.maxBytes(), cache.memoryUsage());
+}
+
+TEST(RensaDetectorCacheTest, expiredDeadline)
+{
+    RensaDetectorCache cache(1024 * 1024);
+    Deadline deadline;
+    deadline.cancel();
+
+    Calls calls;
+    cache.detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&calls), &deadline);
+    EXPECT_TRUE(calls.empty());
+    EXPECT_EQ(0U, cache.numEntries());
+
+    // The partial result should not be replayed.
+    Calls expected;
+    RensaDetector::detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&expected));
+    Calls actual;
+    cache.detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&actual));
+    EXPECT_EQ(expected, actual);
+    EXPECT_EQ(1U, cache.numEntries());
+}
+
+TEST(RensaDetectorCacheTest, differentField)
+{
+    RensaDetectorCache cache(1024 * 1024);
+    Calls calls;
+    cache.detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&calls));
+
+    CoreField field(testField());
+    ASSERT_TRUE(field.dropPuyoOn(6, PuyoColor::RED));
+    Calls expected;
+    RensaDetector::detectIteratively(field, RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&expected));
+    Calls actual;
+    cache.detectIteratively(field, RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&actual));
+
+    EXPECT_EQ(expected, actual);
+    EXPECT_EQ(0U, cache.numHits());
+    EXPECT_EQ(2U, cache.numMisses());
+}
+
+TEST(RensaDetectorCacheTest, evictLeastRecentlyUsed)
+{
+    RensaDetectorCache largeCache(1024 * 1024);
+    Calls calls;
+    largeCache.detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 1, recordingCallback(&calls));
+    const size_t entryBytes = largeCache.memoryUsage();
+
+    // Only 2 entries of maxIteration 1 can be stored.
+    RensaDetectorCache cache(entryBytes * 2 + entryBytes / 2);
+    const RensaDetectorStrategy strategy = RensaDetectorStrategy::defaultDropStrategy();
+    CoreField fields[3] { testField(), testField(), testField() };
+    ASSERT_TRUE(fields[1].dropPuyoOn(1, PuyoColor::YELLOW));
+    ASSERT_TRUE(fields[2].dropPuyoOn(2, PuyoColor::YELLOW));
+
+    cache.detectIteratively(fields[0], strategy, 1, recordingCallback(&calls));
+    cache.detectIteratively(fields[1], strategy, 1, recordingCallback(&calls));
+    // fields[0] becomes the most recently used.
+    cache.detectIteratively(fields[0], strategy, 1, recordingCallback(&calls));
+    EXPECT_EQ(1U, cache.numHits());
+    // fields[1] should be evicted.
+    cache.detectIteratively(fields[2], strategy, 1, recordingCallback(&calls));
+    EXPECT_EQ(2U, cache.numEntries());
+    EXPECT_GE(cache.maxBytes(), cache.memoryUsage());
+
+    cache.detectIteratively(fields[0], strategy, 1, recordingCallback(&calls));
+    EXPECT_EQ(2U, cache.numHits());
+    cache.detectIteratively(fields[1], strategy, 1, recordingCallback(&calls));
+    EXPECT_EQ(2U, cache.numHits());
+    EXPECT_EQ(4U, cache.numMisses());
+}
+
+TEST(RensaDetectorCacheTest, clear)
+{
+    RensaDetectorCache cache(1024 * 1024);
+    Calls calls;
+    cache.detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 2, recordingCallback(&calls));
+    cache.clear();
+
+    EXPECT_EQ(0U, cache.numEntries());
+    EXPECT_EQ(0U, cache.memoryUsage());
+    EXPECT_EQ(0U, cache.numMisses());
+    EXPECT_DOUBLE_EQ(0.0, cache.hitRate());
+}
+
+TEST(RensaDetectorCacheTest, multiThreads)
+{
+    Calls expected;
+    RensaDetector::detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 3, recordingCallback(&expected));
+
+    RensaDetectorCache cache(1024 * 1024);
+    Calls calls[4];
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&cache, &calls, i]() {
+            for (int j = 0; j < 10; ++j) {
+                calls[i].clear();
+                cache.detectIteratively(testField(), RensaDetectorStrategy::defaultDropStrategy(), 3, recordingCallback(&calls[i]));
+            }
+        });
+    }
+    for (thread& t : threads)
+        t.join();
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(expected, calls[i]);
+    EXPECT_EQ(1U, cache.numEntries());
+    EXPECT_EQ(40U, cache.numHits() + cache.numMisses());
+}
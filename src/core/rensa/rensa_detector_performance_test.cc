@@ -4,9 +4,12 @@
 
 #include <cstddef>
 #include <iostream>
+#include <vector>
 
 #include "base/time_stamp_counter.h"
+#include "core/column_puyo_list.h"
 #include "core/core_field.h"
+#include "core/rensa/rensa_detector_cache.h"
 
 class ColumnPuyoList;
 class RensaChainTrackResult;
@@ -79,3 +82,91 @@ TEST(RensaDetectorPerformanceTest, detectIteratively_Extend)
 
     tsc.showStatistics();
 }
+
+namespace {
+
+void runDetectSingleAndBatched(const RensaDetectorStrategy& strategy)
+{
+    const CoreField original(
+        "  R G "
+        "R GRBG"
+        "RBGRBG"
+        "RBGRBG");
+
+    TimeStampCounterData tscSingle;
+    TimeStampCounterData tscBatched;
+
+    auto callback = [&](CoreField&& cf, const ColumnPuyoList&) {
+        (void)cf.simulate();
+    };
+
+    vector<RensaDetector::DetectedRensa> results;
+    results.reserve(128);
+
+    for (int i = 0; i < 10000; ++i) {
+        {
+            ScopedTimeStampCounter stsc(&tscSingle);
+            RensaDetector::detectSingle(original, strategy, callback);
+        }
+        {
+            ScopedTimeStampCounter stsc(&tscBatched);
+            results.clear();
+            RensaDetector::detectSingleBatched(original, strategy, &results);
+        }
+    }
+
+    cout << "detectSingle + simulate" << endl;
+    tscSingle.showStatistics();
+    cout << "detectSingleBatched" << endl;
+    tscBatched.showStatistics();
+}
+
+} // anonymous namespace
+
+TEST(RensaDetectorPerformanceTest, detectSingleVsBatched_Drop)
+{
+    runDetectSingleAndBatched(RensaDetectorStrategy::defaultDropStrategy());
+}
+
+TEST(RensaDetectorPerformanceTest, detectSingleVsBatched_Float)
+{
+    runDetectSingleAndBatched(RensaDetectorStrategy::defaultFloatStrategy());
+}
+
+TEST(RensaDetectorPerformanceTest, detectSingleVsBatched_Extend)
+{
+    runDetectSingleAndBatched(RensaDetectorStrategy::defaultExtendStrategy());
+}
+
+TEST(RensaDetectorPerformanceTest, detectIteratively_Cached)
+{
+    TimeStampCounterData tscUncached;
+    TimeStampCounterData tscCached;
+
+    const CoreField original(
+        "  R G "
+        "R GRBG"
+        "RBGRBG"
+        "RBGRBG");
+
+    auto callback = [&](CoreField&& cf, const ColumnPuyoList&) -> RensaResult {
+        return cf.simulate();
+    };
+
+    RensaDetectorCache cache(1024 * 1024);
+    for (int i = 0; i < 10000; ++i) {
+        {
+            ScopedTimeStampCounter stsc(&tscUncached);
+            RensaDetector::detectIteratively(original, RensaDetectorStrategy::defaultDropStrategy(), 3, callback);
+        }
+        {
+            ScopedTimeStampCounter stsc(&tscCached);
+            cache.detectIteratively(original, RensaDetectorStrategy::defaultDropStrategy(), 3, callback);
+        }
+    }
+
+    cout << "uncached" << endl;
+    tscUncached.showStatistics();
+    cout << "cached: hit rate = " << cache.hitRate() << ", memory = " << cache.memoryUsage() << " bytes" << endl;
+    tscCached.showStatistics();
+}
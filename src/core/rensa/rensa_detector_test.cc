@@ -7,6 +7,7 @@
 #include <utility>
 
 #include "base/base.h"
+#include "base/deadline.h"
 #include "core/column_puyo.h"
 #include "core/column_puyo_list.h"
 #include "core/core_field.h"
@@ -509,6 +510,28 @@ TEST(RensaDetectorTest, detectIteratively_depth1_1)
     EXPECT_FALSE(foundUnexpected);
 }
 
+TEST(RensaDetectorTest, detectIterativelyWithDeadline)
+{
+    const CoreField original(
+        " G    "
+        " BR   "
+        " GYR  "
+        "BGGY  "
+        "YYYR  ");
+
+    int numCalled = 0;
+    Deadline deadline;
+    // Cancel the detection after the first rensa is found.
+    auto callback = [&](CoreField&& complementedField, const ColumnPuyoList&) -> RensaResult {
+        ++numCalled;
+        deadline.cancel();
+        return complementedField.simulate();
+    };
+
+    RensaDetector::detectIteratively(original, RensaDetectorStrategy::defaultDropStrategy(), 3, callback, &deadline);
+    EXPECT_EQ(1, numCalled);
+}
+
 TEST(RensaDetectorTest, detectIteratively_depth1_2)
 {
     const CoreField original(
@@ -711,6 +734,72 @@ TEST(RensaDetectorTest, detectIteratively_DontCrash)
     RensaDetector::detectIteratively(original, RensaDetectorStrategy::defaultDropStrategy(), 2, callback);
 }
 
+TEST(RensaDetectorTest, detectSingleBatched)
+{
+    const CoreField fields[] = {
+        CoreField(),
+        CoreField(
+            "  R G "
+            "R GRBG"
+            "RBGRBG"
+            "RBGRBG"),
+        CoreField(
+            ".RGYG."
+            "RGYGB."
+            "RGYGB."
+            "RGYGB."),
+        CoreField(
+            "Y....."
+            "BB...."
+            "RG...."
+            "RRGG.."
+            "BBYY.."),
+        CoreField(
+            "O....." // 13
+            "OB...." // 12
+            "OBY..."
+            "OOGG.."
+            "OOOR.."
+            "OOOOO." // 8
+            "OOOOO."
+            "OOOOO."
+            "OOOOO."
+            "OOOOO." // 4
+            "OOOOO."
+            "OOOOO."
+            "OOOOOB"),
+    };
+
+    const RensaDetectorStrategy strategies[] = {
+        RensaDetectorStrategy::defaultDropStrategy(),
+        RensaDetectorStrategy::defaultFloatStrategy(),
+        RensaDetectorStrategy::defaultExtendStrategy(),
+        RensaDetectorStrategy(RensaDetectorStrategy::Mode::DROP, 2, 2, false),
+        RensaDetectorStrategy(RensaDetectorStrategy::Mode::FLOAT, 1, 1, false),
+    };
+
+    for (const CoreField& original : fields) {
+        for (const RensaDetectorStrategy& strategy : strategies) {
+            vector<RensaDetector::DetectedRensa> expected;
+            auto callback = [&](CoreField&& cf, const ColumnPuyoList& cpl) {
+                RensaResult rensaResult = cf.simulate();
+                if (rensaResult.chains > 0)
+                    expected.push_back(RensaDetector::DetectedRensa { cpl, rensaResult });
+            };
+            RensaDetector::detectSingle(original, strategy, callback);
+
+            vector<RensaDetector::DetectedRensa> actual;
+            RensaDetector::detectSingleBatched(original, strategy, &actual);
+
+            ASSERT_EQ(expected.size(), actual.size()) << original.toDebugString();
+            for (size_t i = 0; i < expected.size(); ++i) {
+                EXPECT_EQ(expected[i].complementedColumnPuyoList, actual[i].complementedColumnPuyoList);
+                EXPECT_EQ(expected[i].rensaResult, actual[i].rensaResult);
+            }
+        }
+    }
+}
+
 TEST(RensaDetectorTest, complementKeyPuyosOn13thRow1)
 {
     CoreField original;
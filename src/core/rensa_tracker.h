@@ -1,6 +1,7 @@
 #ifndef CORE_RENSA_TRACKER_H_
 #define CORE_RENSA_TRACKER_H_
 
+#include "base/base.h"
 #include "base/unit.h"
 #include "core/field_bits.h"
 
@@ -29,7 +30,7 @@ public:
     void trackCoef(int /*nthChain*/, int /*numErasedPuyo*/, int /*longBonusCoef*/, int /*colorBonusCoef*/) {}
     void trackVanish(int /*nthChain*/, const FieldBits& /*vanishedPuyoBits*/, const FieldBits& /*vanishedOjamaPuyoBits*/) {}
     void trackDrop(FieldBits /*blender*/, FieldBits /*leftOnes*/, FieldBits /*rightOnes*/) {}
-#ifdef __BMI2__
+#if defined(__BMI2__) || defined(PORTABLE_AVX2_BMI2)
     void trackDropBMI2(std::uint64_t /*oldLowBits*/, std::uint64_t /*oldHighBits*/, std::uint64_t /*newLowBits*/, std::uint64_t /*newHighBits*/) {}
 #endif
 };
@@ -30,10 +30,20 @@ DEFINE_bool(timeout, true, "if false, wait ai's thought without timeout");
 
 using namespace std;
 
+namespace {
+
+// About 17 seconds of frames. When a queue is full, its receiver thread stops reading
+// responses from the AI until receive() catches up.
+const size_t RESPONSE_QUEUE_CAPACITY = 1024;
+
+}
+
 ConnectorManager::ConnectorManager(bool always_wait_timeout) :
     should_stop_(false),
     always_wait_timeout_(always_wait_timeout)
 {
+    for (int i = 0; i < 2; ++i)
+        resp_queue_[i].reset(new base::SPSCQueue<FrameResponse>(RESPONSE_QUEUE_CAPACITY));
 }
 
 ConnectorManager::~ConnectorManager()
@@ -73,7 +83,13 @@ void ConnectorManager::runReceiverThreadLoop(int player_id)
             return;
         }
 
-        resp_queue_[player_id].push(resp);
+        // Don't block forever on a full queue, so that stop() can join this thread
+        // even when receive() is no longer called.
+        while (!resp_queue_[player_id]->pushWithTimeout(
+                   std::chrono::steady_clock::now() + std::chrono::milliseconds(100), std::move(resp))) {
+            if (should_stop_)
+                return;
+        }
     }
 }
 
@@ -115,7 +131,7 @@ bool ConnectorManager::receive(int frameId, vector<FrameResponse> cfr[NUM_PLAYER
         std::vector<FrameResponse> resps;
         FrameResponse resp;
 
-        while (resp_queue_[i].takeWithTimeout(timeout, &resp)) {
+        while (resp_queue_[i]->takeWithTimeout(timeout, &resp)) {
             resps.push_back(resp);
             if (resp.frameId == frameId)
                 break;
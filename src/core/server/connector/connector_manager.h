@@ -6,7 +6,7 @@
 #include <thread>
 #include <vector>
 
-#include "base/blocking_queue.h"
+#include "base/spsc_queue.h"
 #include "core/frame_response.h"
 #include "core/player.h"
 
@@ -47,7 +47,8 @@ private:
 
     // If true, ConnectorManager always consume 16ms.
     bool always_wait_timeout_;
-    base::InfiniteBlockingQueue<FrameResponse> resp_queue_[2];
+    // Each queue has one producer (the receiver thread) and one consumer (receive()).
+    std::unique_ptr<base::SPSCQueue<FrameResponse>> resp_queue_[2];
     std::thread receiver_thread_[2];
 };
 
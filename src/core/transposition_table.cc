@@ -0,0 +1,182 @@
+#include "core/transposition_table.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <glog/logging.h>
+
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+#elif defined(OS_WIN)
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+#if defined(OS_LINUX)
+namespace {
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+} // anonymous namespace
+#endif
+
+TranspositionTable::TranspositionTable(size_t megaBytes, bool useHugePages) :
+    buckets_(nullptr),
+    numBuckets_(1),
+    allocatedBytes_(0),
+    usesHugePages_(false),
+    isMmapped_(false),
+    generation_(1)
+{
+    static_assert(sizeof(Bucket) == 64, "Bucket should be one cache line");
+
+    size_t bytes = megaBytes * 1024 * 1024;
+    while (numBuckets_ * 2 * sizeof(Bucket) <= bytes)
+        numBuckets_ *= 2;
+    allocatedBytes_ = numBuckets_ * sizeof(Bucket);
+
+#if defined(OS_LINUX)
+    if (useHugePages) {
+        allocatedBytes_ = (allocatedBytes_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        void* p = mmap(nullptr, allocatedBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            usesHugePages_ = true;
+        } else {
+            // No huge pages are reserved. Try transparent huge pages.
+            p = mmap(nullptr, allocatedBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            PCHECK(p != MAP_FAILED) << "failed to allocate TranspositionTable";
+            usesHugePages_ = madvise(p, allocatedBytes_, MADV_HUGEPAGE) == 0;
+        }
+        buckets_ = static_cast<Bucket*>(p);
+        isMmapped_ = true;
+    }
+#else
+    LOG_IF(WARNING, useHugePages) << "huge pages are not supported on this platform";
+#endif
+
+    if (!buckets_) {
+#if defined(OS_WIN)
+        buckets_ = static_cast<Bucket*>(_aligned_malloc(allocatedBytes_, sizeof(Bucket)));
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, sizeof(Bucket), allocatedBytes_) == 0)
+            buckets_ = static_cast<Bucket*>(p);
+#endif
+        CHECK(buckets_) << "failed to allocate TranspositionTable";
+    }
+
+    for (size_t i = 0; i < numBuckets_; ++i)
+        new (&buckets_[i]) Bucket;
+    clear();
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    // Bucket is trivially destructible.
+#if defined(OS_LINUX)
+    if (isMmapped_) {
+        munmap(buckets_, allocatedBytes_);
+        return;
+    }
+#endif
+
+#if defined(OS_WIN)
+    _aligned_free(buckets_);
+#else
+    free(buckets_);
+#endif
+}
+
+bool TranspositionTable::probe(uint64_t hash, uint32_t tag, int32_t* value) const
+{
+    uint64_t key = makeKey(hash, tag);
+    uint64_t data;
+    if (find(bucketFor(key), key, &data) < 0)
+        return false;
+
+    *value = static_cast<int32_t>(static_cast<uint32_t>(data));
+    return true;
+}
+
+void TranspositionTable::store(uint64_t hash, uint32_t tag, int32_t value)
+{
+    storeKey(makeKey(hash, tag), value);
+}
+
+bool TranspositionTable::insertIfAbsent(uint64_t hash, uint32_t tag, int32_t value)
+{
+    uint64_t key = makeKey(hash, tag);
+    uint64_t data;
+    if (find(bucketFor(key), key, &data) >= 0)
+        return false;
+
+    storeKey(key, value);
+    return true;
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i < numBuckets_; ++i) {
+        for (Entry& e : buckets_[i].entries) {
+            e.keyXorData.store(0, memory_order_relaxed);
+            e.data.store(0, memory_order_relaxed);
+        }
+    }
+}
+
+// static
+uint64_t TranspositionTable::makeKey(uint64_t hash, uint32_t tag)
+{
+    // Mixes tag with the finalizer of MurmurHash3, so that the keys of the same field
+    // with different tags go to different buckets.
+    uint64_t t = tag + 1;
+    t ^= t >> 33;
+    t *= 0xFF51AFD7ED558CCDULL;
+    t ^= t >> 33;
+    t *= 0xC4CEB9FE1A85EC53ULL;
+    t ^= t >> 33;
+    return hash ^ t;
+}
+
+// static
+int TranspositionTable::find(const Bucket& bucket, uint64_t key, uint64_t* data)
+{
+    for (int i = 0; i < ENTRIES_PER_BUCKET; ++i) {
+        const Entry& e = bucket.entries[i];
+        uint64_t d = e.data.load(memory_order_relaxed);
+        if (d != 0 && (e.keyXorData.load(memory_order_relaxed) ^ d) == key) {
+            *data = d;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void TranspositionTable::storeKey(uint64_t key, int32_t value)
+{
+    Bucket& bucket = bucketFor(key);
+    uint64_t data = makeData(value);
+    uint32_t currentGeneration = static_cast<uint32_t>(data >> 32);
+
+    uint64_t existing;
+    int index = find(bucket, key, &existing);
+    if (index < 0) {
+        // Takes an empty entry, or the entry of the oldest generation.
+        // If all the entries are in the current generation, one of them is chosen by key.
+        index = static_cast<int>(key >> 62);
+        uint32_t oldestGeneration = currentGeneration;
+        for (int i = 0; i < ENTRIES_PER_BUCKET; ++i) {
+            uint32_t generation = static_cast<uint32_t>(bucket.entries[i].data.load(memory_order_relaxed) >> 32);
+            if (generation < oldestGeneration) {
+                oldestGeneration = generation;
+                index = i;
+            }
+        }
+    }
+
+    Entry& e = bucket.entries[index];
+    e.keyXorData.store(key ^ data, memory_order_relaxed);
+    e.data.store(data, memory_order_relaxed);
+}
@@ -0,0 +1,81 @@
+#ifndef CORE_TRANSPOSITION_TABLE_H_
+#define CORE_TRANSPOSITION_TABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "base/noncopyable.h"
+
+// TranspositionTable is a fixed-size hash table keyed by a field hash (e.g. CoreField::hash())
+// and a tag. The tag distinguishes the same field in different contexts, e.g. search depth,
+// sequence id, or what the value means. The table can be shared by threads without locks.
+//
+// A bucket is one cache line, which has 4 entries. An entry is 2 atomic 64-bit words
+// (key ^ data, data). When 2 threads write the same entry at once, a reader might see
+// the words from different writes, but then key ^ data doesn't match, and it's just
+// a miss (lockless hashing by Hyatt and Mann).
+//
+// Since the table is fixed-size, an entry might be evicted by another entry anytime.
+// A miss doesn't mean the key has not been stored. Entries stored before newGeneration()
+// are evicted first. Two keys are confused when their 64-bit keys collide, which happens
+// with probability about 2^-64 per pair.
+class TranspositionTable : noncopyable {
+public:
+    // Allocates about |megaBytes| MB. The number of buckets is rounded down to a power of 2.
+    // If |useHugePages| is true, huge pages are used if the platform supports them.
+    explicit TranspositionTable(std::size_t megaBytes, bool useHugePages = false);
+    ~TranspositionTable();
+
+    // Returns true if (hash, tag) is found. Its value is set to |value|.
+    bool probe(std::uint64_t hash, std::uint32_t tag, std::int32_t* value) const;
+    // Stores |value| for (hash, tag).
+    void store(std::uint64_t hash, std::uint32_t tag, std::int32_t value);
+    // Stores (hash, tag) if it's not found. Returns true if stored.
+    // When 2 threads insert the same key at once, both might get true.
+    // This is useful to dedup nodes in search.
+    bool insertIfAbsent(std::uint64_t hash, std::uint32_t tag, std::int32_t value = 0);
+
+    // Makes the current entries preferred to be evicted. Call this e.g. when a new search starts.
+    void newGeneration() { generation_.fetch_add(1, std::memory_order_relaxed); }
+    // Removes all the entries. This is not thread-safe.
+    void clear();
+
+    std::size_t numEntries() const { return numBuckets_ * ENTRIES_PER_BUCKET; }
+    std::size_t sizeInBytes() const { return numBuckets_ * sizeof(Bucket); }
+    bool usesHugePages() const { return usesHugePages_; }
+
+private:
+    static const int ENTRIES_PER_BUCKET = 4;
+
+    struct Entry {
+        std::atomic<std::uint64_t> keyXorData;
+        std::atomic<std::uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Entry entries[ENTRIES_PER_BUCKET];
+    };
+
+    static std::uint64_t makeKey(std::uint64_t hash, std::uint32_t tag);
+    // data is (generation << 32 | value). Since generation starts with 1, data is never 0.
+    std::uint64_t makeData(std::int32_t value) const
+    {
+        return static_cast<std::uint64_t>(generation_.load(std::memory_order_relaxed)) << 32 |
+            static_cast<std::uint32_t>(value);
+    }
+
+    Bucket& bucketFor(std::uint64_t key) const { return buckets_[key & (numBuckets_ - 1)]; }
+    // Returns the index of the entry that has |key| in |bucket|. -1 if not found.
+    static int find(const Bucket& bucket, std::uint64_t key, std::uint64_t* data);
+    void storeKey(std::uint64_t key, std::int32_t value);
+
+    Bucket* buckets_;
+    std::size_t numBuckets_;
+    std::size_t allocatedBytes_;
+    bool usesHugePages_;
+    bool isMmapped_;
+    std::atomic<std::uint32_t> generation_;
+};
+
+#endif // CORE_TRANSPOSITION_TABLE_H_
@@ -0,0 +1,118 @@
+#include "core/transposition_table.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(TranspositionTableTest, size)
+{
+    TranspositionTable table(1);
+    EXPECT_EQ(1024U * 1024U, table.sizeInBytes());
+    EXPECT_EQ(1024U * 1024U / 16, table.numEntries());
+}
+
+TEST(TranspositionTableTest, storeAndProbe)
+{
+    TranspositionTable table(1);
+
+    int32_t value;
+    EXPECT_FALSE(table.probe(12345, 1, &value));
+
+    table.store(12345, 1, -100);
+    EXPECT_TRUE(table.probe(12345, 1, &value));
+    EXPECT_EQ(-100, value);
+
+    // Tag distinguishes the same hash.
+    EXPECT_FALSE(table.probe(12345, 2, &value));
+
+    table.store(12345, 1, 200);
+    EXPECT_TRUE(table.probe(12345, 1, &value));
+    EXPECT_EQ(200, value);
+
+    // Hash 0 is also a valid key.
+    table.store(0, 0, 0);
+    EXPECT_TRUE(table.probe(0, 0, &value));
+    EXPECT_EQ(0, value);
+
+    table.clear();
+    EXPECT_FALSE(table.probe(12345, 1, &value));
+    EXPECT_FALSE(table.probe(0, 0, &value));
+}
+
+TEST(TranspositionTableTest, insertIfAbsent)
+{
+    TranspositionTable table(1);
+
+    EXPECT_TRUE(table.insertIfAbsent(1, 3));
+    EXPECT_FALSE(table.insertIfAbsent(1, 3));
+    EXPECT_TRUE(table.insertIfAbsent(1, 4));
+    EXPECT_TRUE(table.insertIfAbsent(2, 3));
+}
+
+TEST(TranspositionTableTest, oldGenerationIsEvictedFirst)
+{
+    // The smallest table has only one bucket, i.e. 4 entries.
+    TranspositionTable table(0);
+    ASSERT_EQ(4U, table.numEntries());
+
+    table.store(100, 0, 100);
+    table.newGeneration();
+    for (int i = 0; i < 3; ++i)
+        table.store(i, 0, i);
+
+    // The entry of the old generation should be evicted.
+    table.store(200, 0, 200);
+
+    int32_t value;
+    EXPECT_FALSE(table.probe(100, 0, &value));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(table.probe(i, 0, &value));
+        EXPECT_EQ(i, value);
+    }
+    EXPECT_TRUE(table.probe(200, 0, &value));
+}
+
+TEST(TranspositionTableTest, hugePages)
+{
+    // Even if huge pages are not available, the table should work.
+    TranspositionTable table(4, true);
+
+    int32_t value;
+    table.store(1, 2, 3);
+    EXPECT_TRUE(table.probe(1, 2, &value));
+    EXPECT_EQ(3, value);
+}
+
+TEST(TranspositionTableTest, concurrentAccess)
+{
+    const int NUM_THREADS = 4;
+    const int N = 100000;
+
+    // Small table so that threads write the same entries.
+    TranspositionTable table(0);
+
+    vector<thread> threads;
+    vector<int> errors(NUM_THREADS);
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&table, &errors, t]() {
+            for (int i = 0; i < N; ++i) {
+                uint64_t hash = (i * NUM_THREADS + t) % 64;
+                table.store(hash, 0, static_cast<int32_t>(hash * 7));
+
+                int32_t value;
+                uint64_t other = (hash * 31 + 1) % 64;
+                if (table.probe(other, 0, &value) && value != static_cast<int32_t>(other * 7))
+                    ++errors[t];
+            }
+        });
+    }
+
+    for (auto& th : threads)
+        th.join();
+
+    for (int t = 0; t < NUM_THREADS; ++t)
+        EXPECT_EQ(0, errors[t]);
+}
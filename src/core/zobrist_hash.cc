@@ -0,0 +1,39 @@
+#include "core/zobrist_hash.h"
+
+namespace {
+
+// SplitMix64. These are constexpr, so that ZobristHash::KEYS is initialized at compile time.
+constexpr std::uint64_t finalizeSplitMix64(std::uint64_t z)
+{
+    return z ^ (z >> 31);
+}
+
+constexpr std::uint64_t mixSplitMix64(std::uint64_t z)
+{
+    return finalizeSplitMix64((z ^ (z >> 27)) * 0x94D049BB133111EBULL);
+}
+
+constexpr std::uint64_t splitMix64(std::uint64_t n)
+{
+    return mixSplitMix64(((n * 0x9E3779B97F4A7C15ULL) ^ ((n * 0x9E3779B97F4A7C15ULL) >> 30)) * 0xBF58476D1CE4E5B9ULL);
+}
+
+} // anonymous namespace
+
+#define KEY(n) splitMix64((n) + 1)
+#define KEY4(n) KEY(n), KEY((n) + 1), KEY((n) + 2), KEY((n) + 3)
+#define KEY16(n) KEY4(n), KEY4((n) + 4), KEY4((n) + 8), KEY4((n) + 12)
+#define KEY128(n) KEY16(n), KEY16((n) + 16), KEY16((n) + 32), KEY16((n) + 48), \
+        KEY16((n) + 64), KEY16((n) + 80), KEY16((n) + 96), KEY16((n) + 112)
+
+// static
+const std::uint64_t ZobristHash::KEYS[3][128] = {
+    { KEY128(0) },
+    { KEY128(128) },
+    { KEY128(256) },
+};
+
+#undef KEY128
+#undef KEY16
+#undef KEY4
+#undef KEY
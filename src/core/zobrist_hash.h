@@ -0,0 +1,81 @@
+#ifndef CORE_ZOBRIST_HASH_H_
+#define CORE_ZOBRIST_HASH_H_
+
+#include <cstdint>
+
+#include <glog/logging.h>
+
+#include "base/builtin.h"
+#include "base/sse.h"
+#include "core/bit_field.h"
+#include "core/field_bits.h"
+#include "core/puyo_color.h"
+
+// ZobristHash is a 64-bit Zobrist hash of BitField.
+//
+// A key is assigned to each bit of the 3 planes of BitField in the field area
+// (1 <= x <= 6, 1 <= y <= 14), and the hash is XOR of the keys of the bits that are set.
+// Since a color is represented by the bits on the 3 planes, the key of color c on (x, y)
+// is XOR of the plane keys of the bits of c. So, when a puyo changes from c1 to c2,
+// the hash can be updated with key(x, y, c1) ^ key(x, y, c2). The key of EMPTY is 0.
+//
+// Collision rate: the hash is linear over GF(2), so two distinct fields collide iff
+// XOR of the keys of their different bits is 0, which happens with probability 2^-64
+// if the keys are random. When n distinct fields are hashed, the expected number of
+// colliding pairs is about n^2 / 2^65 (~3e-8 for n = 10^6). The keys are generated by
+// SplitMix64 at compile time, which is good enough as random keys here.
+class ZobristHash {
+public:
+    // Returns the key of |c| on (x, y).
+    static std::uint64_t key(int x, int y, PuyoColor c)
+    {
+        DCHECK(1 <= x && x <= 6 && 1 <= y && y <= 14) << x << ' ' << y;
+
+        int index = x * 16 + y;
+        int v = static_cast<int>(c);
+        std::uint64_t k = 0;
+        if (v & 1)
+            k ^= KEYS[0][index];
+        if (v & 2)
+            k ^= KEYS[1][index];
+        if (v & 4)
+            k ^= KEYS[2][index];
+        return k;
+    }
+
+    // Returns the hash of |bf|.
+    static std::uint64_t hash(const BitField& bf)
+    {
+        return hashPlane(0, bf.m_[0]) ^ hashPlane(1, bf.m_[1]) ^ hashPlane(2, bf.m_[2]);
+    }
+
+    // Returns hash(before) ^ hash(after). This is cheap when a few bits are different.
+    static std::uint64_t diff(const BitField& before, const BitField& after)
+    {
+        return hashPlane(0, before.m_[0] ^ after.m_[0]) ^
+            hashPlane(1, before.m_[1] ^ after.m_[1]) ^
+            hashPlane(2, before.m_[2] ^ after.m_[2]);
+    }
+
+private:
+    // KEYS[plane][x * 16 + y] is the key of the bit on (x, y) of |plane|.
+    static const std::uint64_t KEYS[3][128];
+
+    static std::uint64_t hashPlane(int plane, FieldBits bits)
+    {
+        // Takes 1 <= x <= 6, 1 <= y <= 14. The walls are not hashed.
+        const __m128i area = _mm_setr_epi16(0, 0x7FFE, 0x7FFE, 0x7FFE, 0x7FFE, 0x7FFE, 0x7FFE, 0);
+
+        sse::Decomposer d;
+        d.m = _mm_and_si128(bits.xmm(), area);
+
+        std::uint64_t h = 0;
+        for (int i = 0; i < 2; ++i) {
+            for (std::uint64_t v = d.ui64[i]; v; v &= v - 1)
+                h ^= KEYS[plane][i * 64 + countTrailingZeros64(v)];
+        }
+        return h;
+    }
+};
+
+#endif // CORE_ZOBRIST_HASH_H_
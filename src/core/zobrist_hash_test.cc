@@ -0,0 +1,66 @@
+#include "core/zobrist_hash.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "core/bit_field.h"
+
+using namespace std;
+
+TEST(ZobristHashTest, empty)
+{
+    EXPECT_EQ(0ULL, ZobristHash::hash(BitField()));
+
+    for (int x = 1; x <= 6; ++x) {
+        for (int y = 1; y <= 14; ++y) {
+            EXPECT_EQ(0ULL, ZobristHash::key(x, y, PuyoColor::EMPTY));
+        }
+    }
+}
+
+TEST(ZobristHashTest, key)
+{
+    BitField bf(
+        "RBYG.."
+        "OOIRRB");
+
+    uint64_t expected = 0;
+    for (int x = 1; x <= 6; ++x) {
+        for (int y = 1; y <= 2; ++y) {
+            expected ^= ZobristHash::key(x, y, bf.color(x, y));
+        }
+    }
+
+    EXPECT_EQ(expected, ZobristHash::hash(bf));
+}
+
+TEST(ZobristHashTest, keysAreDistinct)
+{
+    static const PuyoColor COLORS[] = {
+        PuyoColor::OJAMA, PuyoColor::IRON,
+        PuyoColor::RED, PuyoColor::BLUE, PuyoColor::YELLOW, PuyoColor::GREEN,
+    };
+
+    set<uint64_t> keys;
+    for (int x = 1; x <= 6; ++x) {
+        for (int y = 1; y <= 14; ++y) {
+            for (PuyoColor c : COLORS) {
+                EXPECT_TRUE(keys.insert(ZobristHash::key(x, y, c)).second) << x << ' ' << y << ' ' << c;
+            }
+        }
+    }
+}
+
+TEST(ZobristHashTest, diff)
+{
+    BitField before(
+        "..R..."
+        "RRBB..");
+    BitField after(before);
+    after.setColor(4, 3, PuyoColor::BLUE);
+    after.setColor(1, 1, PuyoColor::YELLOW);
+
+    EXPECT_EQ(ZobristHash::hash(before) ^ ZobristHash::hash(after), ZobristHash::diff(before, after));
+    EXPECT_EQ(0ULL, ZobristHash::diff(before, before));
+}
@@ -2,8 +2,8 @@
 
 #include <map>
 #include <set>
-#include <unordered_set>
 
+#include "base/arena.h"
 #include "base/time.h"
 #include "base/wait_group.h"
 #include "core/field_pretty_printer.h"
@@ -16,11 +16,25 @@
 DEFINE_int32(beam_width, 400, "beam width");
 DEFINE_int32(beam_depth, 50, "beam depth");
 DEFINE_int32(beam_num, 12, "beam iteration number");
+DEFINE_int32(beam_transposition_table_mb, 64, "the size of transposition table for beam search [MB]");
+DEFINE_bool(beam_transposition_table_huge_pages, false, "use huge pages for transposition table for beam search");
 
 using namespace std;
 
 namespace {
 
+// The tag of TranspositionTable to memoize evalSuperLight(). The other tags are used to dedup fields.
+// A collision of 64-bit keys in the memo only gives a wrong estimate of the chains.
+const std::uint32_t EVAL_TAG = ~0U;
+
+// Returns the tag to dedup fields in |turn| of |k|-th search in |thinkCount|-th think().
+// The value of the entry is the index of the state in the next states.
+std::uint32_t dedupTag(std::uint32_t thinkCount, int k, int turn)
+{
+    DCHECK(0 <= k && k < 256 && 0 <= turn && turn < 255) << k << ' ' << turn;
+    return (thinkCount & 0xFFFF) << 16 | k << 8 | turn;
+}
+
 struct SearchResult {
     std::set<Decision> firstDecisions;
     int maxChains = 0;
@@ -52,14 +66,17 @@ struct State {
     int pending_enemy_ojama_drop_frame = 0;
 };
 
-std::pair<double, int> evalSuperLight(const CoreField& fieldBeforeRensa)
+std::pair<double, int> evalSuperLight(const CoreField& fieldBeforeRensa, TranspositionTable* table)
 {
     int maxChains = 0;
-    auto callback = [&maxChains](CoreField&& complementedField, const ColumnPuyoList& /*cpl*/) {
-        maxChains = std::max(maxChains, complementedField.simulateFast());
-    };
-    static const bool prohibits[FieldConstant::MAP_WIDTH] {};
-    RensaDetector::detectByDropStrategy(fieldBeforeRensa, prohibits, PurposeForFindingRensa::FOR_FIRE, 2, 13, callback);
+    if (!table->probe(fieldBeforeRensa.hash(), EVAL_TAG, &maxChains)) {
+        auto callback = [&maxChains](CoreField&& complementedField, const ColumnPuyoList& /*cpl*/) {
+            maxChains = std::max(maxChains, complementedField.simulateFast());
+        };
+        static const bool prohibits[FieldConstant::MAP_WIDTH] {};
+        RensaDetector::detectByDropStrategy(fieldBeforeRensa, prohibits, PurposeForFindingRensa::FOR_FIRE, 2, 13, callback);
+        table->store(fieldBeforeRensa.hash(), EVAL_TAG, maxChains);
+    }
 
     double maxScore = 0;
     maxScore += maxChains * 1000;
@@ -95,17 +112,26 @@ std::pair<double, int> evalSuperLight(const CoreField& fieldBeforeRensa)
 }
 
 SearchResult run(const std::vector<State>& initialStates, KumipuyoSeq seq, int maxSearchTurns,
-                 std::mutex& mu)
+                 TranspositionTable* table, std::uint32_t thinkCount, int k, std::mutex& mu)
 {
+    // The states are allocated in the arena of this worker thread. The arena keeps the
+    // buffers after the search, so the next search doesn't call malloc for them.
+    ArenaScope arenaScope;
     SearchResult result;
 
-    std::vector<State> currentStates(initialStates);
+    // Each state has at most 22 next states, and we keep at most max(beam width, 22 * 22)
+    // states in each turn. So reserving this never makes the vectors reallocate.
+    const size_t capacity = 22 * std::max<size_t>(initialStates.size(), std::max(FLAGS_beam_width, 22 * 22));
+
+    ArenaVector<State> currentStates;
+    currentStates.reserve(capacity);
+    currentStates.assign(initialStates.begin(), initialStates.end());
 
     int maxOverallFiredChains = 0;
     int maxOverallFiredScore = 0;
 
-    std::vector<State> nextStates;
-    nextStates.reserve(100000);
+    ArenaVector<State> nextStates;
+    nextStates.reserve(capacity);
 
     std::vector<double> time(std::max(maxSearchTurns, 10));
 
@@ -116,7 +142,7 @@ SearchResult run(const std::vector<State>& initialStates, KumipuyoSeq seq, int m
 
         seq.dropFront();
 
-        std::unordered_set<size_t> visited;
+        const std::uint32_t tag = dedupTag(thinkCount, k, turn);
 
         int maxFiredScore = 0;
         int maxFiredRensa = 0;
@@ -124,8 +150,14 @@ SearchResult run(const std::vector<State>& initialStates, KumipuyoSeq seq, int m
         for (const State& s : currentStates) {
             Plan::iterateAvailablePlans(s.field, seq, 1, [&](const RefPlan& plan) {
                 const CoreField& fieldBeforeRensa = plan.field();
-                if (!visited.insert(fieldBeforeRensa.hash()).second)
+                // The table only finds a candidate. The field is compared, so that a distinct field
+                // is not pruned even if the keys collide.
+                std::int32_t index;
+                if (table->probe(fieldBeforeRensa.hash(), tag, &index) &&
+                    static_cast<size_t>(index) < nextStates.size() && nextStates[index].field == fieldBeforeRensa) {
                     return;
+                }
+                table->store(fieldBeforeRensa.hash(), tag, static_cast<std::int32_t>(nextStates.size()));
 
                 int total_frames = s.total_frames + plan.totalFrames() + FRAMES_PREPARING_NEXT;
 
@@ -143,7 +175,7 @@ SearchResult run(const std::vector<State>& initialStates, KumipuyoSeq seq, int m
 
                 double maxScore;
                 int maxChains;
-                std::tie(maxScore, maxChains) = evalSuperLight(fieldBeforeRensa);
+                std::tie(maxScore, maxChains) = evalSuperLight(fieldBeforeRensa, table);
                 nextStates.emplace_back(plan.field(), s.firstDecision, maxScore, maxChains, total_frames);
             });
         }
@@ -210,6 +242,20 @@ SearchResult run(const std::vector<State>& initialStates, KumipuyoSeq seq, int m
 
 } // anonymous namespace
 
+BeamThinker::BeamThinker(Executor* executor) :
+    executor_(executor),
+    thinkCount_(0)
+{
+}
+
+TranspositionTable* BeamThinker::table() const
+{
+    std::call_once(tableOnce_, [this]() {
+        table_.reset(new TranspositionTable(FLAGS_beam_transposition_table_mb, FLAGS_beam_transposition_table_huge_pages));
+    });
+    return table_.get();
+}
+
 DropDecision BeamThinker::think(int /*frameId*/, const CoreField& field, const KumipuyoSeq& seq,
                                 const PlayerState& /*me*/, const PlayerState& /*enemy*/, bool /*fast*/) const
 {
@@ -251,27 +297,26 @@ DropDecision BeamThinker::think(int /*frameId*/, const CoreField& field, const K
     cout << "maxSearchTurns = " << maxSearchTurns << endl;
 #endif
 
-    for (int k = 0; k < FLAGS_beam_num; ++k) {
-        wg.add(1);
+    // The entries of the previous think() should be evicted first.
+    TranspositionTable* table = this->table();
+    table->newGeneration();
+    const std::uint32_t thinkCount = thinkCount_++;
 
-        executor_->submit([&]() {
+    for (int k = 0; k < FLAGS_beam_num; ++k) {
+        executor_->submit(&wg, [&, k]() {
             KumipuyoSeq tmpSeq(seq.subsequence(2));
             tmpSeq.append(KumipuyoSeqGenerator::generateRandomSequence(40));
 
-            SearchResult searchResult = run(nextStates, tmpSeq, maxSearchTurns, mu_);
+            SearchResult searchResult = run(nextStates, tmpSeq, maxSearchTurns, table, thinkCount, k, mu_);
 
-            {
-                lock_guard<mutex> lk(mu);
-                for (const auto& d : searchResult.firstDecisions) {
-                    score[d] += searchResult.maxChains;
-                }
+            lock_guard<mutex> lk(mu);
+            for (const auto& d : searchResult.firstDecisions) {
+                score[d] += searchResult.maxChains;
             }
-            // wg.done() should be called after releasing mu, because of deadlock.
-            wg.done();
         });
     }
 
-    wg.waitUntilDone();
+    executor_->wait(&wg);
 
     Decision d;
     int s = 0;
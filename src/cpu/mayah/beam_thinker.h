@@ -1,6 +1,8 @@
 #ifndef CPU_MAYAH_BEAM_THINKER_H_
 #define CPU_MAYAH_BEAM_THINKER_H_
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include "base/executor.h"
@@ -8,17 +10,28 @@
 #include "core/core_field.h"
 #include "core/kumipuyo_seq.h"
 #include "core/player_state.h"
+#include "core/transposition_table.h"
 
 class BeamThinker {
 public:
-    explicit BeamThinker(Executor* executor) : executor_(executor) {}
+    explicit BeamThinker(Executor* executor);
 
     DropDecision think(int frame_id, const CoreField& field, const KumipuyoSeq& seq,
                        const PlayerState& me, const PlayerState& enemy, bool fast) const;
 
 private:
+    // Returns the table. It's allocated at the first call, since it's large and
+    // the AIs that don't use beam search don't need it.
+    TranspositionTable* table() const;
+
     Executor* executor_;
 
+    // Shared by all the search threads, and kept over think() calls.
+    // Used to dedup fields in the beam, and to memoize the evaluation of fields.
+    mutable std::once_flag tableOnce_;
+    mutable std::unique_ptr<TranspositionTable> table_;
+    mutable std::atomic<std::uint32_t> thinkCount_;
+
     mutable std::mutex mu_;  // for cout
 };
 
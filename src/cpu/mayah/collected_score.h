@@ -25,7 +25,8 @@ struct CollectedSimpleSubScore {
         return s;
     }
 
-    std::array<double, NUM_EVALUATION_MODES> scoreMap {{}};
+    // Padded to EVALUATION_MODE_STRIDE, so that a score collector can add the scores of all the modes at once.
+    std::array<double, EVALUATION_MODE_STRIDE> scoreMap {{}};
 };
 
 typedef CollectedSimpleSubScore CollectedSimpleMoveScore;
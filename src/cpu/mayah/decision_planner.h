@@ -3,9 +3,13 @@
 
 // TODO(mayah): Move this to core/algorithm.
 
+#include <atomic>
 #include <vector>
 
+#include "base/arena.h"
+#include "base/deadline.h"
 #include "base/executor.h"
+#include "base/trace.h"
 #include "base/wait_group.h"
 #include "core/plan/plan.h"
 #include "core/core_field.h"
@@ -36,14 +40,34 @@ public:
     // When decision sequence is specified, we consider only this decision sequence.
     void setSpecifiedDecisions(const std::vector<Decision>& decisions) { decisions_ = decisions; }
 
-    void iterate(int frameId, const CoreField& originalField, const KumipuyoSeq& kumipuyoSeq,
+    // When |deadline| has expired, iterate() stops expanding and evaluating plans.
+    // Don't take the ownership of |deadline|.
+    void setDeadline(const Deadline* deadline) { deadline_ = deadline; }
+
+    // Returns false when iterate() has stopped because of the deadline. In that case,
+    // only a part of the plans have been evaluated.
+    bool iterate(int frameId, const CoreField& originalField, const KumipuyoSeq& kumipuyoSeq,
                  const PlayerState& me, const PlayerState& enemy, int maxDepth);
 
 private:
+    // The decisions of each node are allocated in the arena of the task that expands the node.
+    // Since a task has only a few hundred nodes, a small block is enough.
+    static const size_t ARENA_BLOCK_SIZE = 16 * 1024;
+
+    // Returns true if the deadline has expired. This is checked before each plan is expanded
+    // or evaluated, so that iterate() can return soon after the deadline.
+    bool isCancelled()
+    {
+        if (!deadline_ || !deadline_->isExpired())
+            return false;
+        cancelled_ = true;
+        return true;
+    }
+
     void iterateRest(int initialFrameId,
                      const CoreField& currentField,
                      const KumipuyoSeq& kumipuyoSeq,
-                     const std::vector<Decision>& currentDecisions,
+                     const DecisionSpan& currentDecisions,
                      int currentNumChigiri,
                      int currentTotalFrames,
                      int currentDepth,
@@ -54,6 +78,7 @@ private:
                      int ojamaCommittingFrameId,
                      bool hasZenkeshi,
                      const MidEvaluationResult& midEvaluationResult,
+                     Arena* arena,
                      WaitGroup* wg);
 
     void parallelEval(int currentDepth, const RefPlan& plan, const MidEvaluationResult& midEvaluationResult, WaitGroup* wg);
@@ -66,6 +91,8 @@ private:
     std::vector<Decision> decisions_;
     MidEvaluationCallback midEval_;
     EvaluationCallback eval_;
+    const Deadline* deadline_ = nullptr;
+    std::atomic<bool> cancelled_ { false };
 };
 
 // ----------------------------------------------------------------------
@@ -145,6 +172,9 @@ void DecisionPlanner<MidEvaluationResult>::iterateKumipuyoDrop(int currentDepth,
     }
 
     for (int i = 0; i < numDecisions; ++i) {
+        if (isCancelled())
+            return;
+
         const Decision& decision = decisionsHead[i];
 
         if (!PuyoController::isReachable(currentField, decision))
@@ -169,7 +199,7 @@ template<typename MidEvaluationResult>
 void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
                                                        const CoreField& currentField,
                                                        const KumipuyoSeq& kumipuyoSeq,
-                                                       const std::vector<Decision>& currentDecisions,
+                                                       const DecisionSpan& currentDecisions,
                                                        int currentNumChigiri,
                                                        int currentTotalFrames,
                                                        int currentDepth,
@@ -180,10 +210,14 @@ void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
                                                        int ojamaCommittingFrameId,
                                                        bool hasZenkeshi,
                                                        const MidEvaluationResult& midEvaluationResult,
+                                                       Arena* arena,
                                                        WaitGroup* wg)
 {
     auto f = [&](CoreField&& fieldAfterDecision, const Decision& decision, bool isChigiri, int dropFrames) {
-        std::vector<Decision> decisions(currentDecisions);
+        // Reserve first so that appending the decision doesn't reallocate.
+        ArenaVector<Decision> decisions { ArenaAllocator<Decision>(arena) };
+        decisions.reserve(currentDecisions.size() + 1);
+        decisions.assign(currentDecisions.begin(), currentDecisions.end());
         decisions.push_back(decision);
 
         int newFixedOjama = fixedOjama;
@@ -225,17 +259,22 @@ void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
 
         int totalFrames = currentTotalFrames + dropFrames + ojamaDroppingFrames;
         if (executor_ && currentDepth <= 1) {
-            wg->add(1);
-            executor_->submit([=]() {
-                iterateRest(initialFrameId, fieldAfterDecision, kumipuyoSeq, decisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
+            // |decisions| lives in |arena| and is destroyed when this callback returns, and
+            // Arena is not thread-safe, so the task must take its own copy of the decisions.
+            std::vector<Decision> taskDecisions(decisions.begin(), decisions.end());
+            // Subtasks submitted in this task go to the worker's own queue.
+            executor_->submit(wg, [=]() {
+                // The task runs on another thread, so it has its own arena.
+                Arena taskArena(ARENA_BLOCK_SIZE);
+                iterateRest(initialFrameId, fieldAfterDecision, kumipuyoSeq, taskDecisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
                             fallenOjama + ojamaCount,
-                            newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult, wg);
-
-                wg->done();
+                            newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult,
+                            &taskArena, wg);
             });
         } else {
             iterateRest(initialFrameId, fieldAfterDecision, kumipuyoSeq, decisions, numChigiri, totalFrames, currentDepth + 1, maxDepth,
-                        fallenOjama + ojamaCount, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult, wg);
+                        fallenOjama + ojamaCount, newFixedOjama, newPendingOjama, newOjamaCommittingFrameId, newHasZenkeshi, midEvaluationResult,
+                        arena, wg);
         }
     };
 
@@ -243,17 +282,21 @@ void DecisionPlanner<MidEvaluationResult>::iterateRest(int initialFrameId,
 }
 
 template <typename MidEvaluationResult>
-void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
+bool DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
                                                    const CoreField& originalField,
                                                    const KumipuyoSeq& kumipuyoSeq,
                                                    const PlayerState& me,
                                                    const PlayerState& enemy,
                                                    int maxDepth)
 {
-    DCHECK(maxDepth >= 2);
+    TRACE_SCOPE("DecisionPlanner::iterate");
+    DCHECK(maxDepth >= 1);
     DCHECK(kumipuyoSeq.size() >= maxDepth);
 
+    cancelled_ = false;
+
     WaitGroup wg;
+    Arena arena(ARENA_BLOCK_SIZE);
 
     auto f = [&](const CoreField& fieldAfterDecision, const Decision& decision, bool isChigiri, int dropFrames) {
         int fixedOjama = me.fixedOjama;
@@ -268,7 +311,7 @@ void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
         int ojamaCommittingFrameId = enemy.isRensaOngoing() ? enemy.rensaFinishingFrameId() : 0;
         bool hasZenkeshi = me.hasZenkeshi;
 
-        std::vector<Decision> decisions { decision };
+        ArenaVector<Decision> decisions({ decision }, ArenaAllocator<Decision>(&arena));
 
         int numChigiri = isChigiri ? 1 : 0;
 
@@ -286,14 +329,14 @@ void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
             parallelEval(0, RefPlan(cf, decisions, rensaResult, numChigiri, 0, dropFrames + ojamaDroppingFrames,
                                     ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi),
                          MidEvaluationResult(), &wg);
+            if (maxDepth == 1)
+                return;
 
             MidEvaluationResult midEvaluationResult =
                 midEval_(RefPlan(cf, decisions, rensaResult, numChigiri, 0, dropFrames + ojamaDroppingFrames,
                                  ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi));
             iterateRest(initialFrameId, cf, kumipuyoSeq, decisions, numChigiri, rensaResult.frames + dropFrames + ojamaDroppingFrames,
-                        1, maxDepth, ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi, midEvaluationResult, &wg);
-
-            decisions.pop_back();
+                        1, maxDepth, ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi, midEvaluationResult, &arena, &wg);
             return;
         }
 
@@ -303,8 +346,13 @@ void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
         int ojamaCount = updateOjama(currentFrameId, 0, &fixedOjama, &pendingOjama, &ojamaCommittingFrameId);
         int ojamaDroppingFrames = fallOjama(&cf, ojamaCount);
 
-        if (cf.color(3, 12) != PuyoColor::EMPTY) {
-            decisions.pop_back();
+        if (cf.color(3, 12) != PuyoColor::EMPTY)
+            return;
+
+        if (maxDepth == 1) {
+            parallelEval(0, RefPlan(cf, decisions, RensaResult(), numChigiri, 0, dropFrames + ojamaDroppingFrames,
+                                    ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi),
+                         MidEvaluationResult(), &wg);
             return;
         }
 
@@ -313,26 +361,33 @@ void DecisionPlanner<MidEvaluationResult>::iterate(int initialFrameId,
                              ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, me.hasZenkeshi));
 
         iterateRest(initialFrameId, cf, kumipuyoSeq, decisions, numChigiri, dropFrames + ojamaDroppingFrames, 1, maxDepth,
-                    ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi, midEvaluationResult, &wg);
+                    ojamaCount, fixedOjama, pendingOjama, ojamaCommittingFrameId, hasZenkeshi, midEvaluationResult, &arena, &wg);
 
     };
 
     iterateKumipuyoDrop(0, originalField, kumipuyoSeq.get(0), true, f);
-    wg.waitUntilDone();
+    if (executor_)
+        executor_->wait(&wg);
+    else
+        wg.waitUntilDone();
+
+    return !cancelled_;
 }
 
 template<typename MidEvaluationResult>
 void DecisionPlanner<MidEvaluationResult>::parallelEval(int currentDepth, const RefPlan& refPlan,
                                                         const MidEvaluationResult& midEvaluationResult, WaitGroup* wg)
 {
+    if (isCancelled())
+        return;
+
     // We only submit a task to executor when currentDepth <= 1. (current + next).
     // If we submit a task for currentDepth == 2, the number of task is too much, and overhead is high.
     if (executor_ && currentDepth <= 1) {
-        wg->add(1);
         Plan plan(refPlan.toPlan());
-        executor_->submit([this, plan, midEvaluationResult, wg]() {
-                this->eval_(RefPlan(plan), midEvaluationResult);
-                wg->done();
+        executor_->submit(wg, [this, plan, midEvaluationResult]() {
+                if (!this->isCancelled())
+                    this->eval_(RefPlan(plan), midEvaluationResult);
         });
     } else {
         eval_(refPlan, midEvaluationResult);
@@ -1,8 +1,11 @@
 #include "decision_planner.h"
 
+#include <algorithm>
 #include <atomic>
+#include <memory>
 #include <gtest/gtest.h>
 
+#include "base/executor.h"
 #include "base/unit.h"
 #include "core/core_field.h"
 #include "core/kumipuyo_seq.h"
@@ -101,3 +104,66 @@ TEST(DecisionPlannerTest, numChigiri)
     runTest(field, seq, 2, f);
     EXPECT_TRUE(found);
 }
+
+TEST(DecisionPlannerTest, iterateDepth1)
+{
+    CoreField field(
+        "  RR  ");
+    KumipuyoSeq seq("RRBB");
+
+    vector<vector<Decision>> actual;
+    auto f = [&](const RefPlan& plan, const Unit&) {
+        EXPECT_EQ(1U, plan.decisions().size());
+        actual.push_back(plan.decisions().toVector());
+    };
+
+    runTest(field, seq, 1, f);
+
+    // RR has 11 distinct placements. The rensa plan (3, 2) is evaluated only once.
+    EXPECT_EQ(11U, actual.size());
+    EXPECT_EQ(1, count(actual.begin(), actual.end(), vector<Decision> { Decision(3, 2) }));
+}
+
+TEST(DecisionPlannerTest, deadline)
+{
+    CoreField field(
+        "  RR  "
+        " BYGG ");
+    KumipuyoSeq seq("RRBBYY");
+
+    PlayerState me;
+    PlayerState enemy;
+    me.field = field;
+    me.seq = seq;
+
+    {
+        Deadline deadline;
+        int numEvaluated = 0;
+        auto f = [&](const RefPlan&, const Unit&) { ++numEvaluated; };
+        DecisionPlanner<Unit> planner(unitMidEvaluator, f);
+        planner.setDeadline(&deadline);
+        EXPECT_TRUE(planner.iterate(100, field, seq, me, enemy, 2));
+        EXPECT_LT(10, numEvaluated);
+    }
+
+    for (bool usesExecutor : { false, true }) {
+        unique_ptr<Executor> executor;
+        if (usesExecutor)
+            executor = Executor::makeDefaultExecutor();
+
+        // The deadline expires while the 10th plan is evaluated.
+        Deadline deadline;
+        atomic<int> numEvaluated(0);
+        auto f = [&](const RefPlan&, const Unit&) {
+            if (++numEvaluated == 10)
+                deadline.cancel();
+        };
+        DecisionPlanner<Unit> planner(executor.get(), unitMidEvaluator, f);
+        planner.setDeadline(&deadline);
+        EXPECT_FALSE(planner.iterate(100, field, seq, me, enemy, 3));
+        EXPECT_LE(10, numEvaluated.load());
+        if (!usesExecutor) {
+            EXPECT_EQ(10, numEvaluated.load());
+        }
+    }
+}
@@ -59,3 +59,27 @@ const EvaluationRensaSparseFeature EvaluationRensaSparseFeatures::features_[] {
 
 const EvaluationRensaSparseFeature* EvaluationRensaSparseFeatures::begin() const { return std::begin(features_); }
 const EvaluationRensaSparseFeature* EvaluationRensaSparseFeatures::end() const { return std::end(features_); }
+
+const int EvaluationMoveFeatureSet::sparseDenseIndices_[] {
+#define DEFINE_MOVE_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_MOVE_SPARSE_PARAM(NAME, numValue, tweakability) NUM_EVALUATION_MOVE_FEATURES + EvaluationMoveSparseFeatureSlot::NAME##_BEGIN,
+#define DEFINE_RENSA_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_RENSA_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#include "evaluation_feature.tab"
+#undef DEFINE_MOVE_PARAM
+#undef DEFINE_MOVE_SPARSE_PARAM
+#undef DEFINE_RENSA_PARAM
+#undef DEFINE_RENSA_SPARSE_PARAM
+};
+
+const int EvaluationRensaFeatureSet::sparseDenseIndices_[] {
+#define DEFINE_MOVE_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_MOVE_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#define DEFINE_RENSA_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_RENSA_SPARSE_PARAM(NAME, numValue, tweakability) NUM_EVALUATION_RENSA_FEATURES + EvaluationRensaSparseFeatureSlot::NAME##_BEGIN,
+#include "evaluation_feature.tab"
+#undef DEFINE_MOVE_PARAM
+#undef DEFINE_MOVE_SPARSE_PARAM
+#undef DEFINE_RENSA_PARAM
+#undef DEFINE_RENSA_SPARSE_PARAM
+};
@@ -63,6 +63,62 @@ enum EvaluationRensaSparseFeatureKey {
 #undef DEFINE_RENSA_SPARSE_PARAM
 };
 
+const int NUM_EVALUATION_MOVE_FEATURES = 0
+#define DEFINE_MOVE_PARAM(NAME, tweakability) + 1
+#define DEFINE_MOVE_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#define DEFINE_RENSA_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_RENSA_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#include "evaluation_feature.tab"
+#undef DEFINE_MOVE_PARAM
+#undef DEFINE_MOVE_SPARSE_PARAM
+#undef DEFINE_RENSA_PARAM
+#undef DEFINE_RENSA_SPARSE_PARAM
+    ;
+
+const int NUM_EVALUATION_RENSA_FEATURES = 0
+#define DEFINE_MOVE_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_MOVE_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#define DEFINE_RENSA_PARAM(NAME, tweakability) + 1
+#define DEFINE_RENSA_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#include "evaluation_feature.tab"
+#undef DEFINE_MOVE_PARAM
+#undef DEFINE_MOVE_SPARSE_PARAM
+#undef DEFINE_RENSA_PARAM
+#undef DEFINE_RENSA_SPARSE_PARAM
+    ;
+
+// Each value of a sparse feature has its own slot in a dense feature vector.
+// NAME_BEGIN is the first slot of the sparse feature NAME, and NUM_SLOTS is the number of slots.
+struct EvaluationMoveSparseFeatureSlot {
+    enum : int {
+#define DEFINE_MOVE_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_MOVE_SPARSE_PARAM(NAME, numValue, tweakability) NAME##_BEGIN, NAME##_LAST = NAME##_BEGIN + (numValue) - 1,
+#define DEFINE_RENSA_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_RENSA_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#include "evaluation_feature.tab"
+#undef DEFINE_MOVE_PARAM
+#undef DEFINE_MOVE_SPARSE_PARAM
+#undef DEFINE_RENSA_PARAM
+#undef DEFINE_RENSA_SPARSE_PARAM
+        NUM_SLOTS
+    };
+};
+
+struct EvaluationRensaSparseFeatureSlot {
+    enum : int {
+#define DEFINE_MOVE_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_MOVE_SPARSE_PARAM(NAME, numValue, tweakability) /* ignored */
+#define DEFINE_RENSA_PARAM(NAME, tweakability) /* ignored */
+#define DEFINE_RENSA_SPARSE_PARAM(NAME, numValue, tweakability) NAME##_BEGIN, NAME##_LAST = NAME##_BEGIN + (numValue) - 1,
+#include "evaluation_feature.tab"
+#undef DEFINE_MOVE_PARAM
+#undef DEFINE_MOVE_SPARSE_PARAM
+#undef DEFINE_RENSA_PARAM
+#undef DEFINE_RENSA_SPARSE_PARAM
+        NUM_SLOTS
+    };
+};
+
 template<typename FeatureKey>
 class EvaluationFeature {
 public:
@@ -172,13 +228,23 @@ inline const EvaluationRensaSparseFeature& toFeature(EvaluationRensaSparseFeatur
 
 // ----------------------------------------------------------------------
 
+// A feature set also defines the layout of the dense feature vector.
+// The features come first in the order of evaluation_feature.tab, then the slots of the sparse features.
 class EvaluationMoveFeatureSet {
 public:
   typedef EvaluationMoveFeatureKey FeatureKey;
   typedef EvaluationMoveSparseFeatureKey SparseFeatureKey;
 
+  static const int DENSE_SIZE = NUM_EVALUATION_MOVE_FEATURES + EvaluationMoveSparseFeatureSlot::NUM_SLOTS;
+
   static EvaluationMoveFeatures features() { return EvaluationMoveFeatures(); }
   static EvaluationMoveSparseFeatures sparseFeatures() { return EvaluationMoveSparseFeatures(); }
+
+  static int denseIndex(FeatureKey key) { return key; }
+  static int denseIndex(SparseFeatureKey key, int idx) { return sparseDenseIndices_[key] + idx; }
+
+private:
+  static const int sparseDenseIndices_[];
 };
 
 class EvaluationRensaFeatureSet {
@@ -186,8 +252,16 @@ public:
   typedef EvaluationRensaFeatureKey FeatureKey;
   typedef EvaluationRensaSparseFeatureKey SparseFeatureKey;
 
+  static const int DENSE_SIZE = NUM_EVALUATION_RENSA_FEATURES + EvaluationRensaSparseFeatureSlot::NUM_SLOTS;
+
   static EvaluationRensaFeatures features() { return EvaluationRensaFeatures(); }
   static EvaluationRensaSparseFeatures sparseFeatures() { return EvaluationRensaSparseFeatures(); }
+
+  static int denseIndex(FeatureKey key) { return key; }
+  static int denseIndex(SparseFeatureKey key, int idx) { return sparseDenseIndices_[key] + idx; }
+
+private:
+  static const int sparseDenseIndices_[];
 };
 
 #endif // CPU_MAYAH_EVALUATION_FEATURE_H_
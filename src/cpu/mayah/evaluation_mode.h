@@ -27,4 +27,9 @@ inline int ordinal(EvaluationMode mode) { return static_cast<int>(mode); }
 std::string toString(EvaluationMode);
 const int NUM_EVALUATION_MODES = ARRAY_SIZE(ALL_EVALUATION_MODES);
 
+// Values for all the modes are laid out in EVALUATION_MODE_STRIDE doubles,
+// so that they fit in one AVX-512 register. The padding is always 0.
+const int EVALUATION_MODE_STRIDE = 8;
+static_assert(NUM_EVALUATION_MODES <= EVALUATION_MODE_STRIDE, "EVALUATION_MODE_STRIDE is too small");
+
 #endif // CPU_MAYAH_EVALUATION_MODE_H_
@@ -11,6 +11,10 @@
 #include <glog/logging.h>
 #include <toml/toml.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
 #include "base/base.h"
 #include "evaluation_feature.h"
 #include "evaluation_mode.h"
@@ -192,12 +196,41 @@ typedef EvaluationParameter<EvaluationRensaFeatureSet> EvaluationRensaParameter;
 
 // ----------------------------------------------------------------------
 
+// EvaluationParameterSet keeps the parameters for each mode, and a mode x feature matrix
+// of the effective parameters. The matrix is stored column by column, i.e. the weights of all
+// the modes for a dense feature index are contiguous, so that the scores of all the modes
+// can be accumulated with one SIMD multiply-add per collected feature.
+// The matrix is updated whenever a parameter is changed.
 template<typename Param, typename FeatureSet>
 class EvaluationParameterSet {
 public:
     typedef typename FeatureSet::FeatureKey FeatureKey;
     typedef typename FeatureSet::SparseFeatureKey SparseFeatureKey;
 
+    EvaluationParameterSet() : weights_(FeatureSet::DENSE_SIZE * EVALUATION_MODE_STRIDE) {}
+
+    // Returns EVALUATION_MODE_STRIDE weights. weights(key)[ordinal(mode)] == param(mode, key).
+    const double* weights(FeatureKey key) const
+    {
+        return &weights_[FeatureSet::denseIndex(key) * EVALUATION_MODE_STRIDE];
+    }
+
+    const double* weights(SparseFeatureKey key, int idx) const
+    {
+        return &weights_[FeatureSet::denseIndex(key, idx) * EVALUATION_MODE_STRIDE];
+    }
+
+    // Adds the scores of all the modes to |scores|, which has EVALUATION_MODE_STRIDE doubles.
+    void addScores(FeatureKey key, double v, double* scores) const
+    {
+        addWeights(weights(key), v, scores);
+    }
+
+    void addScores(SparseFeatureKey key, int idx, int n, double* scores) const
+    {
+        addWeights(weights(key, idx), n, scores);
+    }
+
     double param(EvaluationMode mode, FeatureKey key) const
     {
         if (params_[ordinal(mode)].hasParam(key))
@@ -215,21 +248,25 @@ public:
     void setParam(EvaluationMode mode, FeatureKey key, double value)
     {
         params_[ordinal(mode)].setParam(key, value);
+        updateWeights(key);
     }
 
     void setParam(EvaluationMode mode, SparseFeatureKey key, int index, double value)
     {
         params_[ordinal(mode)].setParam(key, index, value);
+        updateWeights(key);
     }
 
     void setDefault(FeatureKey key, double value)
     {
         defaultParam_.setParam(key, value);
+        updateWeights(key);
     }
 
     void setDefault(SparseFeatureKey key, int index, double value)
     {
         defaultParam_.setParam(key, index, value);
+        updateWeights(key);
     }
 
     void removeNontokopuyoParameter()
@@ -238,6 +275,7 @@ public:
         for (auto& param : params_) {
             param.removeNontokopuyoParameter();
         }
+        updateAllWeights();
     }
 
     void clear()
@@ -246,6 +284,7 @@ public:
         for (auto& param : params_) {
             param.clear();
         }
+        updateAllWeights();
     }
 
     toml::Value toTomlValue(const std::string& anotherKey) const
@@ -264,6 +303,14 @@ public:
     }
 
     bool loadValue(const toml::Value& value, const std::string& anotherKey)
+    {
+        bool ok = loadParams(value, anotherKey);
+        updateAllWeights();
+        return ok;
+    }
+
+private:
+    bool loadParams(const toml::Value& value, const std::string& anotherKey)
     {
         CHECK(!anotherKey.empty()) << "another key should not be empty.";
 
@@ -303,9 +350,52 @@ public:
         return true;
     }
 
-private:
+    void updateWeights(FeatureKey key)
+    {
+        double* ws = &weights_[FeatureSet::denseIndex(key) * EVALUATION_MODE_STRIDE];
+        for (const auto& mode : ALL_EVALUATION_MODES)
+            ws[ordinal(mode)] = param(mode, key);
+    }
+
+    void updateWeights(SparseFeatureKey key)
+    {
+        for (size_t i = 0; i < toFeature(key).size(); ++i) {
+            double* ws = &weights_[FeatureSet::denseIndex(key, i) * EVALUATION_MODE_STRIDE];
+            for (const auto& mode : ALL_EVALUATION_MODES)
+                ws[ordinal(mode)] = param(mode, key, i);
+        }
+    }
+
+    void updateAllWeights()
+    {
+        for (const auto& ef : FeatureSet::features())
+            updateWeights(ef.key());
+        for (const auto& ef : FeatureSet::sparseFeatures())
+            updateWeights(ef.key());
+    }
+
+    static void addWeights(const double* ws, double v, double* scores)
+    {
+#if defined(__AVX512F__)
+        __m512d s = _mm512_loadu_pd(scores);
+        // Not fused, so that the scores are the same as the scalar computation.
+        s = _mm512_add_pd(s, _mm512_mul_pd(_mm512_loadu_pd(ws), _mm512_set1_pd(v)));
+        _mm512_storeu_pd(scores, s);
+#elif defined(__AVX__)
+        __m256d x = _mm256_set1_pd(v);
+        __m256d s0 = _mm256_add_pd(_mm256_loadu_pd(scores), _mm256_mul_pd(_mm256_loadu_pd(ws), x));
+        __m256d s1 = _mm256_add_pd(_mm256_loadu_pd(scores + 4), _mm256_mul_pd(_mm256_loadu_pd(ws + 4), x));
+        _mm256_storeu_pd(scores, s0);
+        _mm256_storeu_pd(scores + 4, s1);
+#else
+        for (int i = 0; i < EVALUATION_MODE_STRIDE; ++i)
+            scores[i] += ws[i] * v;
+#endif
+    }
+
     Param defaultParam_;
     std::array<Param, NUM_EVALUATION_MODES> params_;
+    std::vector<double> weights_;
 };
 
 typedef EvaluationParameterSet<EvaluationMoveParameter, EvaluationMoveFeatureSet> EvaluationMoveParameterSet;
@@ -24,3 +24,48 @@ TEST(EvaluationParameterTest, setter)
     EXPECT_EQ(2.0, m.moveParamSet().param(EvaluationMode::EARLY, TOTAL_FRAMES));
     EXPECT_EQ(1.0, m.moveParamSet().param(EvaluationMode::MIDDLE, TOTAL_FRAMES));
 }
+
+TEST(EvaluationParameterTest, weights)
+{
+    EvaluationParameterMap m;
+    m.mutableMoveParamSet()->setDefault(TOTAL_FRAMES, 1.0);
+    m.mutableMoveParamSet()->setParam(EvaluationMode::EARLY, TOTAL_FRAMES, 2.0);
+    m.mutableMoveParamSet()->setDefault(VALLEY_DEPTH, 3, 3.0);
+    m.mutableMoveParamSet()->setParam(EvaluationMode::LATE, VALLEY_DEPTH, 4, 4.0);
+
+    const double* ws = m.moveParamSet().weights(TOTAL_FRAMES);
+    EXPECT_EQ(1.0, ws[ordinal(EvaluationMode::INITIAL)]);
+    EXPECT_EQ(2.0, ws[ordinal(EvaluationMode::EARLY)]);
+    EXPECT_EQ(1.0, ws[ordinal(EvaluationMode::MIDDLE)]);
+    for (int i = NUM_EVALUATION_MODES; i < EVALUATION_MODE_STRIDE; ++i)
+        EXPECT_EQ(0.0, ws[i]);
+
+    // Once LATE has VALLEY_DEPTH, LATE doesn't use the default VALLEY_DEPTH.
+    EXPECT_EQ(3.0, m.moveParamSet().weights(VALLEY_DEPTH, 3)[ordinal(EvaluationMode::MIDDLE)]);
+    EXPECT_EQ(0.0, m.moveParamSet().weights(VALLEY_DEPTH, 3)[ordinal(EvaluationMode::LATE)]);
+    EXPECT_EQ(4.0, m.moveParamSet().weights(VALLEY_DEPTH, 4)[ordinal(EvaluationMode::LATE)]);
+
+    m.mutableMoveParamSet()->clear();
+    EXPECT_EQ(0.0, m.moveParamSet().weights(TOTAL_FRAMES)[ordinal(EvaluationMode::EARLY)]);
+}
+
+TEST(EvaluationParameterTest, weightsAfterLoad)
+{
+    EvaluationParameterMap m;
+    ASSERT_TRUE(m.load(SRC_DIR "/cpu/mayah/feature.toml"));
+
+    for (const auto& mode : ALL_EVALUATION_MODES) {
+        for (const auto& ef : EvaluationMoveFeatureSet::features())
+            EXPECT_EQ(m.moveParamSet().param(mode, ef.key()), m.moveParamSet().weights(ef.key())[ordinal(mode)]);
+        for (const auto& ef : EvaluationMoveFeatureSet::sparseFeatures()) {
+            for (size_t i = 0; i < ef.size(); ++i)
+                EXPECT_EQ(m.moveParamSet().param(mode, ef.key(), i), m.moveParamSet().weights(ef.key(), i)[ordinal(mode)]);
+        }
+        for (const auto& ef : EvaluationRensaFeatureSet::features())
+            EXPECT_EQ(m.mainRensaParamSet().param(mode, ef.key()), m.mainRensaParamSet().weights(ef.key())[ordinal(mode)]);
+        for (const auto& ef : EvaluationRensaFeatureSet::sparseFeatures()) {
+            for (size_t i = 0; i < ef.size(); ++i)
+                EXPECT_EQ(m.sideRensaParamSet().param(mode, ef.key(), i), m.sideRensaParamSet().weights(ef.key(), i)[ordinal(mode)]);
+        }
+    }
+}
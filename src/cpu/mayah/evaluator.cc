@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <set>
@@ -227,9 +228,9 @@ template<typename ScoreCollector>
 void Evaluator<ScoreCollector>::evalMidEval(const MidEvalResult& midEvalResult)
 {
     // Copy midEvalResult.
-    for (const auto& entry : midEvalResult.collectedFeatures()) {
-        sc_->addScore(entry.first, entry.second);
-    }
+    midEvalResult.iterateFeatures([this](EvaluationMoveFeatureKey key, double value) {
+        sc_->addScore(key, value);
+    });
 }
 
 template<typename ScoreCollector>
@@ -408,7 +409,8 @@ void Evaluator<ScoreCollector>::eval(const RefPlan& plan,
         }
     };
 
-    PatternRensaDetector detector(patternBook(), fieldBeforeRensa, evalCallback);
+    PatternRensaDetector detector(patternBook(), fieldBeforeRensa, std::ref(evalCallback));
+    detector.setDeadline(deadline_);
     detector.iteratePossibleRensas(maxIteration);
 
     RensaDetector::detectSideChain(fieldBeforeRensa, RensaDetectorStrategy::defaultDropStrategy(),
@@ -420,7 +422,7 @@ void Evaluator<ScoreCollector>::eval(const RefPlan& plan,
 
     int rensaHandValue = 0;
     if (!fast && usesRensaHandTree) {
-        RensaHandTree myRensaTree(vector<RensaHandNode>{ handTreeMaker.makeNode() });
+        RensaHandTree myRensaTree(ArenaVector<RensaHandNode>{ handTreeMaker.makeNode(deadline_) });
         // TODO(mayah): num ojama is correct? frame id is correct? not sure...
         int myOjama = plan.totalOjama();
         int myOjamaCommittingFrameId = plan.ojamaCommittingFrameId();
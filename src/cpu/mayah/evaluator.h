@@ -1,9 +1,12 @@
 #ifndef CPU_MAYAH_EVALUATOR_H_
 #define CPU_MAYAH_EVALUATOR_H_
 
+#include <array>
+#include <cstdint>
 #include <map>
 #include <vector>
 
+#include "base/builtin.h"
 #include "core/pattern/pattern_book.h"
 
 #include "evaluation_feature.h"
@@ -11,6 +14,7 @@
 
 class ColumnPuyoList;
 class CoreField;
+class Deadline;
 class GazeResult;
 class KumipuyoSeq;
 class RefPlan;
@@ -43,26 +47,41 @@ public:
     PreEvalResult preEval(const CoreField& currentField);
 };
 
+// MidEvalResult keeps the features in a dense array, so that it can be created and copied
+// without allocation.
 class MidEvalResult {
 public:
     void add(EvaluationMoveFeatureKey key, double value)
     {
-        collectedFeatures_[key] = value;
+        values_[key] = value;
+        hasValue_ |= std::uint64_t(1) << key;
     }
 
-    double feature(EvaluationMoveFeatureKey key) const
-    {
-        auto it = collectedFeatures_.find(key);
-        if (it == collectedFeatures_.end())
-            return 0;
+    double feature(EvaluationMoveFeatureKey key) const { return values_[key]; }
 
-        return it->second;
+    // Calls |callback(key, value)| for each added feature in the order of the keys.
+    template<typename Callback>
+    void iterateFeatures(Callback callback) const
+    {
+        for (std::uint64_t bits = hasValue_; bits != 0; bits &= bits - 1) {
+            EvaluationMoveFeatureKey key = static_cast<EvaluationMoveFeatureKey>(countTrailingZeros64(bits));
+            callback(key, values_[key]);
+        }
     }
 
-    const std::map<EvaluationMoveFeatureKey, double>& collectedFeatures() const { return collectedFeatures_; }
+    // For debugging.
+    std::map<EvaluationMoveFeatureKey, double> collectedFeatures() const
+    {
+        std::map<EvaluationMoveFeatureKey, double> features;
+        iterateFeatures([&features](EvaluationMoveFeatureKey key, double value) { features[key] = value; });
+        return features;
+    }
 
 private:
-    std::map<EvaluationMoveFeatureKey, double> collectedFeatures_;
+    static_assert(NUM_EVALUATION_MOVE_FEATURES <= 64, "hasValue_ should have a bit for each feature");
+
+    std::array<double, NUM_EVALUATION_MOVE_FEATURES> values_ {{}};
+    std::uint64_t hasValue_ = 0;
 };
 
 class MidEvaluator : public EvaluatorBase {
@@ -93,6 +112,11 @@ public:
         EvaluatorBase(patternBook),
         sc_(sc) {}
 
+    // When |deadline| has expired, eval() stops detecting possible rensas on the way.
+    // The collected score is not reliable in that case.
+    // Don't take the ownership of |deadline|.
+    void setDeadline(const Deadline* deadline) { deadline_ = deadline; }
+
     void eval(const RefPlan&, const KumipuyoSeq&, int currentFrameId, int maxIteration,
               const PlayerState& me, const PlayerState& enemy,
               const MidEvalResult&, bool fast, bool usesRensaHandTree, const GazeResult&);
@@ -111,6 +135,7 @@ private:
     CollectedCoef calculateDefaultCoef(const PlayerState& me, const PlayerState& enemy) const;
 
     ScoreCollector* sc_;
+    const Deadline* deadline_ = nullptr;
 };
 
 #endif // CPU_MAYAH_EVALUATOR_H_
@@ -7,6 +7,7 @@
 
 #include <glog/logging.h>
 
+#include "base/trace.h"
 #include "core/plan/plan.h"
 #include "core/rensa/rensa_detector.h"
 #include "core/field_checker.h"
@@ -170,6 +171,7 @@ void Gazer::initialize(int frameIdGameWillBegin)
 
 void Gazer::gaze(int frameId, const CoreField& originalField, const KumipuyoSeq& kumipuyoSeq)
 {
+    TRACE_SCOPE("Gazer::gaze");
     LOG(INFO) << "Gaze: frame_id=" << frameId << "\n"
               << originalField.toDebugString() << "\nSeq: " << kumipuyoSeq.toString();
 
@@ -207,7 +209,7 @@ void Gazer::gaze(int frameId, const CoreField& originalField, const KumipuyoSeq&
         int maxDepth = std::min<int>(3, kumipuyoSeq.size());
         Plan::iterateAvailablePlansWithoutFiring(originalField, kumipuyoSeq, maxDepth, callback);
 
-        RensaHandTree tree = RensaHandTree(std::vector<RensaHandNode> { maker.makeNode() });
+        RensaHandTree tree = RensaHandTree(ArenaVector<RensaHandNode> { maker.makeNode() });
         LOG(INFO) << "Feasible: " << endl << tree.toString();
         gazeResult_.setFeasibleRensaHandTree(std::move(tree));
     }
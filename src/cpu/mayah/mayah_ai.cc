@@ -7,7 +7,9 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "base/deadline.h"
 #include "base/time.h"
+#include "base/trace.h"
 #include "base/wait_group.h"
 #include "core/plan/plan.h"
 #include "core/frame_request.h"
@@ -19,8 +21,35 @@
 
 DECLARE_bool(from_wrapper);
 
+DEFINE_bool(think_with_deadline, true,
+            "search deeper while time remains in think(). If false, the depth of the search is fixed.");
+DEFINE_bool(ponder, true,
+            "search the predicted next position while waiting for the next think(). "
+            "This works only with --think_with_deadline.");
+
 using namespace std;
 
+namespace {
+
+// Returns true if the states used in the evaluation except the field are the same.
+bool hasSameOjamaState(const PlayerState& lhs, const PlayerState& rhs)
+{
+    return lhs.hasZenkeshi == rhs.hasZenkeshi &&
+        lhs.fixedOjama == rhs.fixedOjama &&
+        lhs.pendingOjama == rhs.pendingOjama &&
+        lhs.unusedScore == rhs.unusedScore &&
+        lhs.currentChainStartedFrameId == rhs.currentChainStartedFrameId &&
+        lhs.currentRensaResult == rhs.currentRensaResult;
+}
+
+} // anonymous namespace
+
+bool MayahAI::PonderedSearch::isFor(const CoreField& f, const KumipuyoSeq& s,
+                                    const PlayerState& m, const PlayerState& e) const
+{
+    return field == f && seq == s && hasSameOjamaState(me, m) && hasSameOjamaState(enemy, e);
+}
+
 MayahAI::MayahAI(int argc, char* argv[], std::unique_ptr<Executor> executor) :
     MayahBaseAI(argc, argv, "mayah", std::move(executor))
 {
@@ -30,6 +59,7 @@ MayahAI::MayahAI(int argc, char* argv[], std::unique_ptr<Executor> executor) :
     }
 
     setBehaviorRethinkAfterOpponentRensa(true);
+    setBehaviorPonder(FLAGS_ponder && FLAGS_think_with_deadline);
 }
 
 MayahAI::~MayahAI()
@@ -39,8 +69,42 @@ MayahAI::~MayahAI()
 DropDecision MayahAI::think(int frame_id, const CoreField& f, const KumipuyoSeq& kumipuyo_seq,
                             const PlayerState& me, const PlayerState& enemy, bool fast) const
 {
+    TRACE_SCOPE("MayahAI::think");
+    if (!FLAGS_think_with_deadline) {
+        return pattern_thinker_->think(frame_id, f, kumipuyo_seq, me, enemy, gazer_.gazeResult(), fast,
+                                       usesDecisionBook_, usesRensaHandTree_);
+    }
+
+    Deadline deadline(thinkDeadline(frame_id, fast));
+    PatternThinker::SearchProgress progress;
+    if (pondered_ && pondered_->isFor(f, kumipuyo_seq, me, enemy)) {
+        LOG(INFO) << "resume the pondered search: completed stages=" << pondered_->progress.numCompletedStages;
+        progress = pondered_->progress;
+    }
+
     return pattern_thinker_->think(frame_id, f, kumipuyo_seq, me, enemy, gazer_.gazeResult(), fast,
-                                   usesDecisionBook_, usesRensaHandTree_);
+                                   usesDecisionBook_, usesRensaHandTree_, &deadline, &progress);
+}
+
+void MayahAI::gaze(int frameId, const CoreField& enemyField, const KumipuyoSeq& kumipuyoSeq)
+{
+    MayahBaseAI::gaze(frameId, enemyField, kumipuyoSeq);
+
+    // The pondered search used the old gaze result.
+    pondered_.reset();
+}
+
+void MayahAI::ponder(int frameId, const CoreField& f, const KumipuyoSeq& kumipuyoSeq,
+                     const PlayerState& me, const PlayerState& enemy, const Deadline& deadline)
+{
+    TRACE_SCOPE("MayahAI::ponder");
+
+    // Resume the search if we've pondered the same position.
+    if (!pondered_ || !pondered_->isFor(f, kumipuyoSeq, me, enemy))
+        pondered_.reset(new PonderedSearch { f, kumipuyoSeq, me, enemy, PatternThinker::SearchProgress() });
+
+    pattern_thinker_->think(frameId, f, kumipuyoSeq, me, enemy, gazer_.gazeResult(), false,
+                            usesDecisionBook_, usesRensaHandTree_, &deadline, &pondered_->progress);
 }
 
 ThoughtResult MayahAI::thinkPlan(int frameId, const CoreField& cf, const KumipuyoSeq& seq,
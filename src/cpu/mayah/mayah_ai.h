@@ -29,9 +29,31 @@ public:
         const PlayerState& me, const PlayerState& enemy,
         const MidEvalResult&, bool fast, const GazeResult& gazeResult) const;
 
+    void gaze(int frameId, const CoreField& enemyField, const KumipuyoSeq&) override;
+
 protected:
+    void ponder(int frameId, const CoreField&, const KumipuyoSeq&,
+                const PlayerState& me, const PlayerState& enemy, const Deadline&) override;
+
     bool usesDecisionBook_ = true;
     bool usesRensaHandTree_ = true;
+
+private:
+    // The search pondered for the predicted position of the next think().
+    // Since ponder() doesn't run concurrently with think() and gaze(), this doesn't need a lock.
+    struct PonderedSearch {
+        // frameId is not compared, since the predicted frameId is not accurate
+        // (e.g. think() is called when NEXT2 has appeared).
+        bool isFor(const CoreField&, const KumipuyoSeq&, const PlayerState& me, const PlayerState& enemy) const;
+
+        CoreField field;
+        KumipuyoSeq seq;
+        PlayerState me;
+        PlayerState enemy;
+        PatternThinker::SearchProgress progress;
+    };
+
+    std::unique_ptr<PonderedSearch> pondered_;
 };
 
 class DebuggableMayahAI : public MayahAI {
@@ -45,6 +67,7 @@ public:
     using MayahAI::loadEvaluationParameter;
 
     using MayahAI::gameWillBegin;
+    using MayahAI::ponder;
     using MayahAI::gameHasEnded;
     using MayahAI::next2AppearedForEnemy;
     using MayahAI::decisionRequestedForEnemy;
@@ -57,6 +80,7 @@ public:
     using MayahAI::mutableEnemyPlayerState;
 
     void setUsesRensaHandTree(bool flag) { usesRensaHandTree_ = flag; }
+    PatternThinker* mutablePatternThinker() { return pattern_thinker_.get(); }
 
     void removeNontokopuyoParameter() { evaluationParameterMap_.removeNontokopuyoParameter(); }
 
@@ -1,4 +1,7 @@
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
+#include <new>
 
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
@@ -15,6 +18,24 @@
 
 using namespace std;
 
+namespace {
+std::atomic<long long> numAllocations(0);
+}
+
+// Counts the number of global allocations, to see how many mallocs think() does.
+void* operator new(size_t size)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
 unique_ptr<MayahAI> makeAI(std::unique_ptr<Executor> executor)
 {
     int argc = 1;
@@ -66,11 +87,15 @@ void runTest(int depth, int iteration, const CoreField& cf, const KumipuyoSeq& k
     unique_ptr<MayahAI> ai(makeAI(Executor::makeDefaultExecutor()));
     int frameId = 1;
 
-    for (int i = 0; i < 3; ++i) {
+    const int N = 3;
+    long long allocationsBegin = numAllocations;
+    for (int i = 0; i < N; ++i) {
         ScopedTimeStampCounter stsc(&tsc);
         (void)ai->thinkPlan(frameId, cf, kumipuyoSeq, PlayerState(), PlayerState(), depth, iteration);
     }
+    long long allocationsEnd = numAllocations;
 
+    cout << "allocations per thinkPlan: " << (allocationsEnd - allocationsBegin) / N << endl;
     tsc.showStatistics();
 }
 
@@ -4,6 +4,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "base/deadline.h"
 #include "base/executor.h"
 #include "core/frame_request.h"
 #include "core/kumipuyo_seq.h"
@@ -40,6 +41,68 @@ TEST(MayahAITest, parallel)
     EXPECT_EQ(thoughtResult.virtualRensaScore, parallelThoughtResult.virtualRensaScore);
 }
 
+TEST(MayahAITest, thinkPlanWithDeadline)
+{
+    CoreField f(
+        " R    "
+        "YY BBB"
+        "RRRGGG");
+
+    KumipuyoSeq seq("GGRRBY");
+
+    auto ai = makeAI();
+    const PatternThinker* thinker = ai->mutablePatternThinker();
+
+    ThoughtResult expected = thinker->thinkPlan(2, f, seq, PlayerState(), PlayerState(), 2, 3, GazeResult());
+
+    // A deadline that doesn't expire should not change the result.
+    Deadline infinite;
+    ThoughtResult actual = thinker->thinkPlan(2, f, seq, PlayerState(), PlayerState(), 2, 3, GazeResult(),
+                                              false, true, true, nullptr, &infinite);
+    EXPECT_TRUE(actual.searchCompleted);
+    EXPECT_EQ(expected.plan, actual.plan);
+    EXPECT_EQ(expected.rensaScore, actual.rensaScore);
+
+    Deadline expired;
+    expired.cancel();
+    ThoughtResult timeout = thinker->thinkPlan(2, f, seq, PlayerState(), PlayerState(), 2, 3, GazeResult(),
+                                               false, true, true, nullptr, &expired);
+    EXPECT_FALSE(timeout.searchCompleted);
+
+    // think() should complete the depth 1 search even if the deadline has already expired.
+    ThoughtResult depth1 = thinker->thinkPlan(2, f, seq, PlayerState(), PlayerState(), 1, 1, GazeResult(),
+                                              false, false, true);
+    ASSERT_FALSE(depth1.plan.decisions().empty());
+    DropDecision decision = thinker->think(2, f, seq, PlayerState(), PlayerState(), GazeResult(), false,
+                                           true, true, &expired);
+    EXPECT_EQ(depth1.plan.decisions().front(), decision.decision());
+}
+
+TEST(MayahAITest, ponder)
+{
+    CoreField f(
+        " R    "
+        "YY BBB"
+        "RRRGGG");
+
+    KumipuyoSeq seq("GGRRBY");
+
+    auto ai = makeAI();
+    FrameRequest req;
+    req.frameId = 1;
+    ai->gameWillBegin(req);
+
+    // Ponder until all the stages are searched.
+    Deadline infinite;
+    ai->ponder(2, f, seq, PlayerState(), PlayerState(), infinite);
+
+    // think() should resume from the pondered result.
+    DropDecision expected = ai->mutablePatternThinker()->think(2, f, seq, PlayerState(), PlayerState(), GazeResult(), false,
+                                                               true, true, &infinite);
+    DropDecision actual = ai->think(2, f, seq, PlayerState(), PlayerState(), false);
+    EXPECT_EQ(expected.decision(), actual.decision());
+}
+
 // TODO(mayah): Move this test to situation_test.
 TEST(MayahAITest, fromReal1)
 {
@@ -1,9 +1,12 @@
 #include "pattern_rensa_detector.h"
 
 #include <algorithm>
+#include <functional>
 
 #include <gflags/gflags.h>
 
+#include "base/trace.h"
+
 using namespace std;
 
 DEFINE_bool(use_side_chain, false, "Use sidechain iteration");
@@ -15,6 +18,7 @@ const int MAX_UNUSED_VARIABLES = 1;
 
 void PatternRensaDetector::iteratePossibleRensas(int maxIteration)
 {
+    TRACE_SCOPE("PatternRensaDetector::iteratePossibleRensas");
     DCHECK_GE(maxIteration, 1);
 
     const int maxHeight = strategy_.allowsPuttingKeyPuyoOn13thRow() ? 13 : 12;
@@ -58,7 +62,7 @@ void PatternRensaDetector::iteratePossibleRensas(int maxIteration)
                                       maxIteration - 1, restUnusedVariables,
                                       pbf.name(), patternScore);
     };
-    patternBook_.complement(originalField_, MAX_UNUSED_VARIABLES_FOR_FIRST_PATTERN, callback);
+    patternBook_.complement(originalField_, MAX_UNUSED_VARIABLES_FOR_FIRST_PATTERN, std::ref(callback));
 
     // --- Iterate without complementing.
     auto detectCallback = [&](const CoreField& complementedField, const ColumnPuyoList& cpl) {
@@ -91,12 +95,12 @@ void PatternRensaDetector::iteratePossibleRensas(int maxIteration)
                 callback_(cf, rensaResult, puyosToComplement, firePuyoColor, "", 0.0);
             };
             RensaDetector::detectSideChainFromDetectedField(
-                originalField_, complementedField, strategy_, cpl, sideChainCallback);
+                originalField_, complementedField, strategy_, cpl, std::ref(sideChainCallback));
         }
     };
 
     const bool prohibits[FieldConstant::MAP_WIDTH] {};
-    RensaDetector::detect(originalField_, strategy_, PurposeForFindingRensa::FOR_FIRE, prohibits, detectCallback);
+    RensaDetector::detect(originalField_, strategy_, PurposeForFindingRensa::FOR_FIRE, prohibits, std::ref(detectCallback));
 }
 
 void PatternRensaDetector::iteratePossibleRensasInternal(const CoreField& currentField,
@@ -110,6 +114,9 @@ void PatternRensaDetector::iteratePossibleRensasInternal(const CoreField& curren
                                                          double currentPatternScore,
                                                          bool addsPatternScore)
 {
+    if (deadline_ && deadline_->isExpired())
+        return;
+
     // With complement.
     FieldBits ignitionPosition = currentField.ignitionPuyoBits();
 
@@ -164,7 +171,7 @@ void PatternRensaDetector::iteratePossibleRensasInternal(const CoreField& curren
                                       patternName.empty() ? pbf.name() : patternName,
                                       patternScore);
     };
-    patternBook_.complement(currentField, ignitionPosition, restUnusedVariables, callback);
+    patternBook_.complement(currentField, ignitionPosition, restUnusedVariables, std::ref(callback));
 
     if (!needsToProceedWithoutComplement)
         return;
@@ -201,7 +208,7 @@ void PatternRensaDetector::iteratePossibleRensasInternal(const CoreField& curren
                                       firePuyo, keyPuyos, restIteration - 1, restUnusedVariables,
                                       patternName, currentPatternScore);
     };
-    RensaDetector::detect(cf, strategy_, PurposeForFindingRensa::FOR_KEY, prohibits, detectCallback);
+    RensaDetector::detect(cf, strategy_, PurposeForFindingRensa::FOR_KEY, prohibits, std::ref(detectCallback));
 }
 
 bool PatternRensaDetector::checkDup(const ColumnPuyo& firePuyo,
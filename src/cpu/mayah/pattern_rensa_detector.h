@@ -1,9 +1,12 @@
 #ifndef CPU_MAYAH_PATTERN_RENSA_DETECTOR_H_
 #define CPU_MAYAH_PATTERN_RENSA_DETECTOR_H_
 
+#include <functional>
 #include <string>
 #include <unordered_set>
 
+#include "base/arena.h"
+#include "base/deadline.h"
 #include "core/column_puyo_list.h"
 #include "core/core_field.h"
 #include "core/pattern/pattern_book.h"
@@ -28,8 +31,11 @@ public:
     {
     }
 
-    void iteratePossibleRensas(int maxIteration);
+    // When |deadline| has expired, iteratePossibleRensas() stops on the way.
+    // Don't take the ownership of |deadline|.
+    void setDeadline(const Deadline* deadline) { deadline_ = deadline; }
 
+    void iteratePossibleRensas(int maxIteration);
 
 private:
     void iteratePossibleRensasInternal(const CoreField& currentField,
@@ -57,8 +63,10 @@ private:
     const CoreField& originalField_;
     Callback callback_;
     const RensaDetectorStrategy strategy_;
+    const Deadline* deadline_ = nullptr;
 
-    std::unordered_set<ColumnPuyoList> usedSet_;
+    std::unordered_set<ColumnPuyoList, std::hash<ColumnPuyoList>, std::equal_to<ColumnPuyoList>,
+                       ArenaAllocator<ColumnPuyoList>> usedSet_;
 };
 
 #endif // CPU_MAYAH_PATTERN_RENSA_DETECTOR_H_
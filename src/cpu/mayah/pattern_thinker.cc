@@ -2,6 +2,11 @@
 
 #include <vector>
 
+#include "base/arena.h"
+#include "base/base.h"
+#include "base/time.h"
+#include "base/trace.h"
+
 #include "decision_planner.h"
 #include "score_collector.h"
 
@@ -21,19 +26,30 @@ PatternThinker::PatternThinker(const EvaluationParameterMap& evaluationParameter
 DropDecision PatternThinker::think(int frame_id, const CoreField& field, const KumipuyoSeq& kumipuyo_seq,
                                    const PlayerState& me, const PlayerState& enemy,
                                    const GazeResult& gazeResult, bool fast,
-                                   bool usesDecisionBook, bool usesRensaHandTree) const
+                                   bool usesDecisionBook, bool usesRensaHandTree,
+                                   const Deadline* deadline, SearchProgress* progress) const
 {
-    int depth;
-    int iteration;
-    if (fast) {
-        depth = FAST_DEPTH;
-        iteration = FAST_NUM_ITERATION;
+    TRACE_SCOPE("PatternThinker::think");
+    ThoughtResult thoughtResult;
+    if (deadline) {
+        SearchProgress newProgress;
+        if (!progress)
+            progress = &newProgress;
+        thoughtResult = thinkWithDeadline(frame_id, field, kumipuyo_seq, me, enemy, gazeResult, fast,
+                                          usesDecisionBook, usesRensaHandTree, *deadline, progress);
     } else {
-        depth = DEFAULT_DEPTH;
-        iteration = DEFAULT_NUM_ITERATION;
-    }
+        int depth;
+        int iteration;
+        if (fast) {
+            depth = FAST_DEPTH;
+            iteration = FAST_NUM_ITERATION;
+        } else {
+            depth = DEFAULT_DEPTH;
+            iteration = DEFAULT_NUM_ITERATION;
+        }
 
-    ThoughtResult thoughtResult = thinkPlan(frame_id, field, kumipuyo_seq, me, enemy, depth, iteration, gazeResult, fast, usesDecisionBook, usesRensaHandTree);
+        thoughtResult = thinkPlan(frame_id, field, kumipuyo_seq, me, enemy, depth, iteration, gazeResult, fast, usesDecisionBook, usesRensaHandTree);
+    }
 
     const Plan& plan = thoughtResult.plan;
     if (plan.decisions().empty())
@@ -41,14 +57,106 @@ DropDecision PatternThinker::think(int frame_id, const CoreField& field, const K
     return DropDecision(plan.decisions().front(), thoughtResult.message);
 }
 
+ThoughtResult PatternThinker::thinkWithDeadline(int frameId, const CoreField& field, const KumipuyoSeq& kumipuyoSeq,
+                                                const PlayerState& me, const PlayerState& enemy,
+                                                const GazeResult& gazeResult, bool fast,
+                                                bool usesDecisionBook, bool usesRensaHandTree,
+                                                const Deadline& deadline, SearchProgress* progress) const
+{
+    ThoughtResult result;
+    if (thinkWithoutSearch(field, kumipuyoSeq, enemy, usesDecisionBook, &result))
+        return result;
+
+    // Each stage is more expensive than the previous one. The first stage ignores the deadline,
+    // so that some decision is always made from a completed search. It's cheap enough.
+    static const struct {
+        int depth;
+        int maxIteration;
+    } STAGES[] = {
+        { 1, 1 },
+        { 2, 1 },
+        { FAST_DEPTH, FAST_NUM_ITERATION },
+        { DEFAULT_DEPTH, DEFAULT_NUM_ITERATION },
+        { MAX_DEPTH, MAX_NUM_ITERATION },
+    };
+
+    double lastStageTime = 0.0;
+    for (size_t i = progress->numCompletedStages; i < ARRAY_SIZE(STAGES); ++i) {
+        if (i > 0) {
+            // We cannot search deeper than the known kumipuyos.
+            if (kumipuyoSeq.size() < STAGES[i].depth)
+                break;
+            // The next stage won't be completed in time.
+            if (deadline.remainingTime() < lastStageTime)
+                break;
+        }
+
+        double beginTime = currentTime();
+        const Deadline* stageDeadline = i > 0 ? &deadline : nullptr;
+        ThoughtResult tr = thinkPlan(frameId, field, kumipuyoSeq, me, enemy, STAGES[i].depth, STAGES[i].maxIteration,
+                                     gazeResult, fast, false, usesRensaHandTree, nullptr, stageDeadline);
+        lastStageTime = currentTime() - beginTime;
+
+        LOG(INFO) << "depth=" << STAGES[i].depth
+                  << " iteration=" << STAGES[i].maxIteration
+                  << " completed=" << tr.searchCompleted
+                  << " time=" << lastStageTime;
+
+        if (!tr.searchCompleted)
+            break;
+
+        progress->result = std::move(tr);
+        progress->numCompletedStages = static_cast<int>(i + 1);
+        if (deadline.isExpired())
+            break;
+    }
+
+    return progress->result;
+}
+
+bool PatternThinker::thinkWithoutSearch(const CoreField& field, const KumipuyoSeq& kumipuyoSeq,
+                                        const PlayerState& enemy, bool usesDecisionBook,
+                                        ThoughtResult* result) const
+{
+    if (kumipuyoSeq.size() < 2) {
+        LOG(ERROR) << "The size of kumipuyoSeq is " << kumipuyoSeq.size() << ", which is < 2.";
+        // TODO(mayah): This shouldn't happen. However, this happens on wii.
+        CoreField cf(field);
+        Decision d(1, 1);
+        vector<Decision> decisions { d };
+
+        *result = ThoughtResult(Plan(cf, decisions, RensaResult(), 0, 0, 0, 0, 0, 0, 0, false),
+                                0.0, 0.0, MidEvalResult(), "Invalid KumipuyoSeq.");
+        return true;
+    }
+
+    if (usesDecisionBook && !enemy.hasZenkeshi) {
+        Decision d = decisionBook_.nextDecision(field, kumipuyoSeq);
+        if (d.isValid()) {
+            CoreField cf(field);
+            cf.dropKumipuyo(d, kumipuyoSeq.front());
+            vector<Decision> decisions { d };
+
+            *result = ThoughtResult(Plan(cf, decisions, RensaResult(), 0, 0, 0, 0, 0, 0, 0, false),
+                                    0.0, 0.0, MidEvalResult(), "BY DECISION BOOK");
+            return true;
+        }
+    }
+
+    return false;
+}
+
 ThoughtResult PatternThinker::thinkPlan(int frameId, const CoreField& field, const KumipuyoSeq& kumipuyoSeq,
                                         const PlayerState& me, const PlayerState& enemy,
                                         int depth, int maxIteration,
                                         const GazeResult& gazeResult,
                                         bool fast,
                                         bool usesDecisionBook, bool usesRensaHandTree,
-                                        vector<Decision>* specifiedDecisions) const
+                                        vector<Decision>* specifiedDecisions,
+                                        const Deadline* deadline) const
 {
+    TRACE_SCOPE("PatternThinker::thinkPlan");
+
     // TODO(mayah): Do we need field and kumipuyoSeq?
     // CHECK(field, me.field);
     // CHECK(kumipuyoSeq, me.kumipuyoSeq);
@@ -67,30 +175,9 @@ ThoughtResult PatternThinker::thinkPlan(int frameId, const CoreField& field, con
                 << "----------------------------------------------------------------------" << endl;
     }
 
-    if (kumipuyoSeq.size() < 2) {
-        LOG(ERROR) << "The size of kumipuyoSeq is " << kumipuyoSeq.size() << ", which is < 2.";
-        // TODO(mayah): This shouldn't happen. However, this happens on wii.
-        CoreField cf(field);
-        Decision d(1, 1);
-        vector<Decision> decisions { d };
-
-        ThoughtResult tr(Plan(cf, decisions, RensaResult(), 0, 0, 0, 0, 0, 0, 0, false),
-                         0.0, 0.0, MidEvalResult(), "Invalid KumipuyoSeq.");
-        return tr;
-    }
-
-    if (usesDecisionBook && !enemy.hasZenkeshi) {
-        Decision d = decisionBook_.nextDecision(field, kumipuyoSeq);
-        if (d.isValid()) {
-            CoreField cf(field);
-            cf.dropKumipuyo(d, kumipuyoSeq.front());
-            vector<Decision> decisions { d };
-
-            ThoughtResult tr(Plan(cf, decisions, RensaResult(), 0, 0, 0, 0, 0, 0, 0, false),
-                             0.0, 0.0, MidEvalResult(), "BY DECISION BOOK");
-            return tr;
-        }
-    }
+    ThoughtResult resultWithoutSearch;
+    if (thinkWithoutSearch(field, kumipuyoSeq, enemy, usesDecisionBook, &resultWithoutSearch))
+        return resultWithoutSearch;
 
     Plan bestPlan;
     double bestScore = -100000000.0;
@@ -109,7 +196,11 @@ ThoughtResult PatternThinker::thinkPlan(int frameId, const CoreField& field, con
     auto evalRefPlan = [&, this, frameId, maxIteration](const RefPlan& plan, const MidEvalResult& midEvalResult) {
         KumipuyoSeq restSeq(kumipuyoSeq.subsequence(plan.decisions().size()));
         // Here, we iterate enemy's possible rensa.
-        EvalResult evalResult = eval(plan, restSeq, frameId, maxIteration, me, enemy, midEvalResult, fast, usesRensaHandTree, gazeResult);
+        EvalResult evalResult = eval(plan, restSeq, frameId, maxIteration, me, enemy, midEvalResult, fast, usesRensaHandTree, gazeResult, deadline);
+        // The rensa detection might have been stopped on the way. Such a plan is underestimated,
+        // so it cannot be compared with the others.
+        if (deadline && deadline->isExpired())
+            return;
         Plan evaledPlan = plan.toPlan();
 
         // Hmm, it looks weaker if we search this...
@@ -139,7 +230,7 @@ ThoughtResult PatternThinker::thinkPlan(int frameId, const CoreField& field, con
                 p.setLastDropFrames(p.lastDropFrames() + ojamaFrames);
 
                 // TODO(mayah): Instead of gazeResult, we need to use edge.tree().
-                EvalResult result = eval(RefPlan(p), restSeq, frameId, maxIteration, me, enemy, midEvalResult, fast, usesRensaHandTree, gazeResult);
+                EvalResult result = eval(RefPlan(p), restSeq, frameId, maxIteration, me, enemy, midEvalResult, fast, usesRensaHandTree, gazeResult, deadline);
                 if (result.score() < evalResult.score()) {
                     evalResult = result;
                     evaledPlan = p;
@@ -177,13 +268,20 @@ ThoughtResult PatternThinker::thinkPlan(int frameId, const CoreField& field, con
     };
     auto evalMidEval = [&](const RefPlan& plan) {
         return midEval(plan, field, kumipuyoSeq.subsequence(plan.decisions().size()),
-                       frameId, maxIteration, me, enemy, gazeResult, usesRensaHandTree);
+                       frameId, maxIteration, me, enemy, gazeResult, usesRensaHandTree, deadline);
     };
 
     DecisionPlanner<MidEvalResult> planner(executor_, evalMidEval, evalRefPlan);
     if (specifiedDecisions)
         planner.setSpecifiedDecisions(*specifiedDecisions);
-    planner.iterate(frameId, field, kumipuyoSeq, me, enemy, depth);
+    planner.setDeadline(deadline);
+    if (!planner.iterate(frameId, field, kumipuyoSeq, me, enemy, depth)) {
+        // We don't have time to make the message. |bestPlan| is chosen only from the plans
+        // evaluated before the deadline, but we don't use the rensa plan of the partial search.
+        ThoughtResult tr(bestPlan, bestRensaScore, bestVirtualRensaScore, bestMidEvalResult, "TIMEOUT");
+        tr.searchCompleted = false;
+        return tr;
+    }
 
     if (!ojamaFallen && bestVirtualRensaScore < bestRensaScore) {
         std::string message = makeMessageFrom(frameId, kumipuyoSeq, maxIteration,
@@ -209,10 +307,13 @@ MidEvalResult PatternThinker::midEval(const RefPlan& plan,
                                       const PlayerState& me,
                                       const PlayerState& enemy,
                                       const GazeResult& gazeResult,
-                                      bool usesRensaHandTree) const
+                                      bool usesRensaHandTree,
+                                      const Deadline* deadline) const
 {
+    TRACE_SCOPE("PatternThinker::midEval");
     SimpleScoreCollector sc(evaluationParameterMap_);
     Evaluator<SimpleScoreCollector> evaluator(patternBook_, &sc);
+    evaluator.setDeadline(deadline);
 
     // MidEval always sets 'fast'.
     evaluator.eval(plan, restSeq, currentFrameId, maxIteration, me, enemy, MidEvalResult(), true, usesRensaHandTree, gazeResult);
@@ -228,10 +329,18 @@ EvalResult PatternThinker::eval(const RefPlan& plan,
                                 const PlayerState& me, const PlayerState& enemy,
                                 const MidEvalResult& midEvalResult,
                                 bool fast, bool usesRensaHandTree,
-                                const GazeResult& gazeResult) const
+                                const GazeResult& gazeResult,
+                                const Deadline* deadline) const
 {
+    TRACE_SCOPE("PatternThinker::eval");
+
+    // The rensa hand trees are made in the arena of this thread. They are freed at once
+    // when this evaluation finishes, and the arena is reused for the next evaluation.
+    ArenaScope arenaScope;
+
     SimpleScoreCollector sc(evaluationParameterMap_);
     Evaluator<SimpleScoreCollector> evaluator(patternBook_, &sc);
+    evaluator.setDeadline(deadline);
     evaluator.eval(plan, restSeq, currentFrameId, maxIteration, me, enemy, midEvalResult, fast, usesRensaHandTree, gazeResult);
 
     const CollectedSimpleScore& simpleScore = sc.collectedScore();
@@ -249,6 +358,8 @@ CollectedFeatureCoefScore PatternThinker::evalWithCollectingFeature(const RefPla
                                                                     bool usesRensaHandTree,
                                                                     const GazeResult& gazeResult) const
 {
+    ArenaScope arenaScope;
+
     FeatureScoreCollector sc(evaluationParameterMap_);
     Evaluator<FeatureScoreCollector> evaluator(patternBook_, &sc);
     evaluator.eval(plan, restSeq, currentFrameId, maxIteration, me, enemy, midEvalResult, fast, usesRensaHandTree, gazeResult);
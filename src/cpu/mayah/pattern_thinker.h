@@ -1,6 +1,7 @@
 #ifndef CPU_MAYAH_PATTERN_THINKER_H_
 #define CPU_MAYAH_PATTERN_THINKER_H_
 
+#include "base/deadline.h"
 #include "base/executor.h"
 #include "base/time.h"
 #include "core/client/ai/ai.h"
@@ -27,32 +28,54 @@ struct ThoughtResult {
     double virtualRensaScore;
     MidEvalResult midEvalResult;
     std::string message;
+    // False when the search has been stopped by the deadline. Then, |plan| is the best plan
+    // among the plans evaluated before the deadline, and the scores are not reliable.
+    bool searchCompleted = true;
 };
 
 class PatternThinker {
 public:
+    // The progress of the iterative deepening in think(). When the same position is
+    // thought again with this, the search is resumed from the next stage.
+    struct SearchProgress {
+        int numCompletedStages = 0;
+        // The result of the last completed stage.
+        ThoughtResult result;
+    };
+
     static const int DEFAULT_DEPTH = 2;
     static const int DEFAULT_NUM_ITERATION = 3;
     static const int FAST_DEPTH = 2;
     static const int FAST_NUM_ITERATION = 2;
+    // With a deadline, think() searches deeper and deeper up to these.
+    static const int MAX_DEPTH = 3;
+    static const int MAX_NUM_ITERATION = 3;
 
     PatternThinker(const EvaluationParameterMap& evaluationParameterMap,
                    const DecisionBook& decisionBook,
                    const PatternBook& patternBook,
                    Executor* executor);
 
+    // When |deadline| is nullptr, think() searches with the fixed depth and iteration.
+    // Otherwise, think() searches deeper and deeper while time remains (iterative deepening),
+    // and returns the result of the deepest search that has been completed before the deadline.
+    // The shallowest search (depth 1) is always completed even if the deadline has expired.
+    // When |progress| is specified, the search is resumed from it, and it's updated.
     DropDecision think(int frameId, const CoreField& f, const KumipuyoSeq& kumipuyoSeq,
                        const PlayerState& me, const PlayerState& enemy,
                        const GazeResult& gazeResult, bool fast,
-                       bool usesDecisionBook, bool usesRensaHandTree) const;
+                       bool usesDecisionBook, bool usesRensaHandTree,
+                       const Deadline* deadline = nullptr, SearchProgress* progress = nullptr) const;
 
     // Use this directly in test. Otherwise, use via think.
     // When |specifiedDecisionsOnly| is specified, only that decision will be considered.
+    // When |deadline| has expired, the search stops, and the best plan so far is returned.
     ThoughtResult thinkPlan(int frameId, const CoreField&, const KumipuyoSeq&,
                             const PlayerState& me, const PlayerState& enemy,
                             int depth, int maxIteration, const GazeResult&, bool fast = false,
                             bool usesDecisionBook = true, bool usesRensaHandTree = true,
-                            std::vector<Decision>* specifiedDecisions = nullptr) const;
+                            std::vector<Decision>* specifiedDecisions = nullptr,
+                            const Deadline* deadline = nullptr) const;
 
     CollectedFeatureCoefScore evalWithCollectingFeature(
         const RefPlan&, const KumipuyoSeq& restSeq, int currentFrameId, int maxIteration,
@@ -60,14 +83,25 @@ public:
         const MidEvalResult&, bool fast, bool usesRensaHandTree, const GazeResult& gazeResult) const;
 
 private:
+    ThoughtResult thinkWithDeadline(int frameId, const CoreField&, const KumipuyoSeq&,
+                                    const PlayerState& me, const PlayerState& enemy,
+                                    const GazeResult&, bool fast,
+                                    bool usesDecisionBook, bool usesRensaHandTree,
+                                    const Deadline&, SearchProgress*) const;
+    // Returns true if the decision can be made without search, e.g. by the decision book.
+    // In that case, |result| is set.
+    bool thinkWithoutSearch(const CoreField&, const KumipuyoSeq&, const PlayerState& enemy,
+                            bool usesDecisionBook, ThoughtResult* result) const;
+
     MidEvalResult midEval(const RefPlan&, const CoreField& currentField,
                           const KumipuyoSeq& restSeq,
                           int currentFrameId, int maxIteration,
                           const PlayerState& me, const PlayerState& enemy,
-                          const GazeResult&, bool usesRensaHandTree) const;
+                          const GazeResult&, bool usesRensaHandTree, const Deadline*) const;
     EvalResult eval(const RefPlan&, const KumipuyoSeq& restSeq, int currentFrameId, int maxIteration,
                     const PlayerState& me, const PlayerState& enemy,
-                    const MidEvalResult&, bool fast, bool usesRensaHandTree, const GazeResult&) const;
+                    const MidEvalResult&, bool fast, bool usesRensaHandTree, const GazeResult&,
+                    const Deadline*) const;
 
     std::string makeMessageFrom(int frameId, const KumipuyoSeq&, int maxIteration,
                                 const PlayerState& me, const PlayerState& enemy,
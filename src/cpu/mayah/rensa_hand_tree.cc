@@ -1,9 +1,13 @@
 #include "rensa_hand_tree.h"
 
+#include <cmath>
+#include <functional>
 #include <iostream>
 #include <sstream>
 
+#include "base/trace.h"
 #include "core/rensa/rensa_detector.h"
+#include "core/rensa/rensa_detector_cache.h"
 #include "core/core_field.h"
 #include "core/frame.h"
 #include "core/probability/column_puyo_list_probability.h"
@@ -12,6 +16,8 @@
 
 using namespace std;
 
+DEFINE_int32(rensa_hand_tree_cache_mb, 8, "the size of cache for rensa detection in RensaHandTree [MB]. 0 to disable.");
+
 namespace {
 
 // TODO(mayah): more accurate number?
@@ -24,6 +30,14 @@ static const int FRAMES_TO_DIG[6] = {
     13 * NUM_FRAMES_OF_ONE_HAND + 4 * NUM_FRAMES_OF_ONE_RENSA,
 };
 
+// RensaHandTree is made for the same field again and again (e.g. the enemy field is gazed
+// every time it's changed), so rensa detection is cached among the calls.
+RensaDetectorCache* rensaDetectorCache()
+{
+    static RensaDetectorCache* cache = new RensaDetectorCache(FLAGS_rensa_hand_tree_cache_mb * 1024 * 1024);
+    return cache;
+}
+
 } // namespace
 
 string RensaHand::toString() const
@@ -64,12 +78,15 @@ RensaHandTree RensaHandTree::makeTree(int restIteration,
                                       const CoreField& currentField,
                                       const PuyoSet& usedPuyoSet,
                                       int usedPuyoMoveFrames,
-                                      const KumipuyoSeq& wholeKumipuyoSeq)
+                                      const KumipuyoSeq& wholeKumipuyoSeq,
+                                      const Deadline* deadline)
 {
     if (restIteration <= 0)
         return RensaHandTree();
 
-    vector<RensaHandNode> nodes(6);
+    TRACE_SCOPE("RensaHandTree::makeTree");
+
+    ArenaVector<RensaHandNode> nodes(6);
     for (int ojamaLines = 0; ojamaLines <= 5; ++ojamaLines) {
         CoreField field(currentField);
         const int dropFrames = field.fallOjama(ojamaLines);
@@ -80,7 +97,7 @@ RensaHandTree RensaHandTree::makeTree(int restIteration,
             // frames += static_cast<int>(ColumnPuyoListProbability::instanceSlow()->necessaryKumipuyos(puyosToComplement) * NUM_FRAMES_OF_ONE_HAND / 2);
             return maker.add(std::move(cf), puyosToComplement, frames, usedPuyoSet);
         };
-        RensaDetector::detectIteratively(field, RensaDetectorStrategy::defaultDropStrategy(), 3, callback);
+        rensaDetectorCache()->detectIteratively(field, RensaDetectorStrategy::defaultDropStrategy(), 3, std::ref(callback), deadline);
         nodes[ojamaLines] = maker.makeNode();
     }
 
@@ -246,7 +263,7 @@ int RensaHandTree::eval(const RensaHandTree& myTree,
             }
         };
 
-        vector<Candidate> candidates;
+        ArenaVector<Candidate> candidates;
 
         for (int ojamaLines = 0; ojamaLines <= myOjamaLineIndex; ++ojamaLines) {
             int framesToDig = FRAMES_TO_DIG[myOjamaLineIndex - ojamaLines];
@@ -363,14 +380,14 @@ RensaResult RensaHandNodeMaker::add(CoreField&& cf,
     return rensaResult;
 }
 
-RensaHandNode RensaHandNodeMaker::makeNode()
+RensaHandNode RensaHandNodeMaker::makeNode(const Deadline* deadline)
 {
     if (data_.empty())
         return RensaHandNode();
 
     sort(data_.begin(), data_.end(), SortByTotalFrames());
 
-    vector<RensaHandEdge> edges;
+    ArenaVector<RensaHandEdge> edges;
     for (const RensaHandCandidate& info : data_) {
         // Don't consider if chain side is too close.
         if (!edges.empty() && info.score() <= edges.back().rensaHand().score() + 140)
@@ -382,7 +399,8 @@ RensaHandNode RensaHandNodeMaker::makeNode()
                                                    info.fieldAfterRensa,
                                                    info.alreadyUsedPuyoSet,
                                                    info.alreadyConsumedFramesToMovePuyo,
-                                                   kumipuyoSeq_));
+                                                   kumipuyoSeq_,
+                                                   deadline));
     }
     return RensaHandNode(std::move(edges));
 }
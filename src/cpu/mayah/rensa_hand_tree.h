@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "base/arena.h"
 #include "core/core_field.h"
 #include "core/frame.h"
 #include "core/kumipuyo_seq.h"
@@ -14,6 +15,7 @@
 
 class ColumnPuyoList;
 class CoreField;
+class Deadline;
 class KumipuyoSeq;
 class PuyoSet;
 
@@ -50,14 +52,16 @@ struct RensaHand {
 class RensaHandTree {
 public:
     RensaHandTree() {}
-    explicit RensaHandTree(std::vector<RensaHandNode> nodes) :
+    explicit RensaHandTree(ArenaVector<RensaHandNode> nodes) :
         nodes_(std::move(nodes)) {}
 
+    // When |deadline| has expired, the tree is made from the rensas detected so far.
     static RensaHandTree makeTree(int restIteration,
                                   const CoreField& currentField,
                                   const PuyoSet& usedPuyoSet,
                                   int usedPuyoMoveFrames,
-                                  const KumipuyoSeq& wholeKumipuyoSeq);
+                                  const KumipuyoSeq& wholeKumipuyoSeq,
+                                  const Deadline* deadline = nullptr);
 
     static int eval(const RensaHandTree& myTree,
                     int myStartingFrameId,
@@ -70,7 +74,7 @@ public:
                     int enemyNumOjama,
                     int enemyOjamaCommittingFrameId);
 
-    const std::vector<RensaHandNode>& nodes() const { return nodes_; }
+    const ArenaVector<RensaHandNode>& nodes() const { return nodes_; }
     const RensaHandNode& node(int index) const { return nodes_[index]; }
 
     void clear() { nodes_.clear(); }
@@ -80,14 +84,15 @@ public:
     void dumpTo(int depth, std::ostream* os) const;
 
 private:
-    std::vector<RensaHandNode> nodes_;  // by ojama lines
+    // The nodes are made in the arena while evaluating a plan.
+    ArenaVector<RensaHandNode> nodes_;  // by ojama lines
 };
 
 class RensaHandEdge {
 public:
-    RensaHandEdge(const RensaHand& rensaHand, const RensaHandTree& tree) :
+    RensaHandEdge(const RensaHand& rensaHand, RensaHandTree tree) :
         rensaHand_(rensaHand),
-        tree_(tree)
+        tree_(std::move(tree))
     {
     }
 
@@ -102,13 +107,13 @@ private:
 class RensaHandNode {
 public:
     RensaHandNode() {}
-    explicit RensaHandNode(std::vector<RensaHandEdge> edges) :
+    explicit RensaHandNode(ArenaVector<RensaHandEdge> edges) :
         edges_(std::move(edges)) {}
 
-    const std::vector<RensaHandEdge>& edges() const { return edges_; }
+    const ArenaVector<RensaHandEdge>& edges() const { return edges_; }
 
 private:
-    std::vector<RensaHandEdge> edges_;
+    ArenaVector<RensaHandEdge> edges_;
 };
 
 // ----------------------------------------------------------------------
@@ -146,6 +151,7 @@ struct RensaHandCandidate {
 
 class RensaHandNodeMaker {
 public:
+    // |kumipuyoSeq| should be alive while the maker is used.
     RensaHandNodeMaker(int restIteration, const KumipuyoSeq& kumipuyoSeq);
     ~RensaHandNodeMaker();
 
@@ -157,12 +163,12 @@ public:
                     const PuyoSet& usedPuyoSet);
     void addCandidate(const RensaHandCandidate& candidate) { data_.push_back(candidate); }
 
-    RensaHandNode makeNode();
+    RensaHandNode makeNode(const Deadline* deadline = nullptr);
 
 private:
     const int restIteration_;
-    const KumipuyoSeq kumipuyoSeq_;
-    std::vector<RensaHandCandidate> data_;
+    const KumipuyoSeq& kumipuyoSeq_;
+    ArenaVector<RensaHandCandidate> data_;
 };
 
 struct SortByTotalFrames {
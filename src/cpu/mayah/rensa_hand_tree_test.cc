@@ -34,8 +34,8 @@ TEST(RensaHandTreeTest, eval_empty)
 
 TEST(RensaHandTreeTest, eval_5rensa)
 {
-    std::vector<RensaHandEdge> myEdges { RensaHandEdge(makePlainRensaHand(5), RensaHandTree()) };
-    std::vector<RensaHandNode> myNodes { RensaHandNode(myEdges) };
+    ArenaVector<RensaHandEdge> myEdges { RensaHandEdge(makePlainRensaHand(5), RensaHandTree()) };
+    ArenaVector<RensaHandNode> myNodes { RensaHandNode(myEdges) };
     RensaHandTree myTree(myNodes);
 
     const RensaHandTree enemyTree;
@@ -51,13 +51,13 @@ TEST(RensaHandTreeTest, eval_5rensa)
 TEST(RensaHandTreeTest, eval_saisoku)
 {
     // 1P has 10 rensa.
-    std::vector<RensaHandEdge> myEdges { RensaHandEdge(makePlainRensaHand(8), RensaHandTree()) };
-    std::vector<RensaHandNode> myNodes { RensaHandNode(myEdges) };
+    ArenaVector<RensaHandEdge> myEdges { RensaHandEdge(makePlainRensaHand(8), RensaHandTree()) };
+    ArenaVector<RensaHandNode> myNodes { RensaHandNode(myEdges) };
     RensaHandTree myTree(myNodes);
 
     // 2P has 11 rensa.
-    std::vector<RensaHandEdge> enemyEdges { RensaHandEdge(makePlainRensaHand(11), RensaHandTree()) };
-    std::vector<RensaHandNode> enemyNodes { RensaHandNode(enemyEdges) };
+    ArenaVector<RensaHandEdge> enemyEdges { RensaHandEdge(makePlainRensaHand(11), RensaHandTree()) };
+    ArenaVector<RensaHandNode> enemyNodes { RensaHandNode(enemyEdges) };
     RensaHandTree enemyTree(enemyNodes);
 
     // Eval after 1P has fired 2-double.
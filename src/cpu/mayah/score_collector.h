@@ -24,18 +24,14 @@ public:
 
     void addScore(EvaluationRensaFeatureKey key, double v)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            mainRensaScore_.scoreMap[ordinal(mode)] += mainRensaParamSet_.param(mode, key) * v;
-            sideRensaScore_.scoreMap[ordinal(mode)] += sideRensaParamSet_.param(mode, key) * v;
-        }
+        mainRensaParamSet_.addScores(key, v, mainRensaScore_.scoreMap.data());
+        sideRensaParamSet_.addScores(key, v, sideRensaScore_.scoreMap.data());
     }
 
     void addScore(EvaluationRensaSparseFeatureKey key, int idx, int n = 1)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            mainRensaScore_.scoreMap[ordinal(mode)] += mainRensaParamSet_.param(mode, key, idx) * n;
-            sideRensaScore_.scoreMap[ordinal(mode)] += sideRensaParamSet_.param(mode, key, idx) * n;
-        }
+        mainRensaParamSet_.addScores(key, idx, n, mainRensaScore_.scoreMap.data());
+        sideRensaParamSet_.addScores(key, idx, n, sideRensaScore_.scoreMap.data());
     }
 
     void setBookname(const std::string&) {}
@@ -66,16 +62,12 @@ public:
 
     void addScore(EvaluationMoveFeatureKey key, double v)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            collectedSimpleScore_.moveScore.scoreMap[ordinal(mode)] += moveParamSet().param(mode, key) * v;
-        }
+        moveParamSet().addScores(key, v, collectedSimpleScore_.moveScore.scoreMap.data());
     }
 
     void addScore(EvaluationMoveSparseFeatureKey key, int idx, int n = 1)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            collectedSimpleScore_.moveScore.scoreMap[ordinal(mode)] += moveParamSet().param(mode, key, idx) * n;
-        }
+        moveParamSet().addScores(key, idx, n, collectedSimpleScore_.moveScore.scoreMap.data());
     }
 
     void mergeMainRensaScore(const CollectedSimpleRensaScore& rensaScore)
@@ -120,10 +112,8 @@ public:
 
     void addScore(EvaluationRensaFeatureKey key, double v)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            mainRensaScore_.simpleScore.scoreMap[ordinal(mode)] += mainRensaParamSet_.param(mode, key) * v;
-            sideRensaScore_.simpleScore.scoreMap[ordinal(mode)] += sideRensaParamSet_.param(mode, key) * v;
-        }
+        mainRensaParamSet_.addScores(key, v, mainRensaScore_.simpleScore.scoreMap.data());
+        sideRensaParamSet_.addScores(key, v, sideRensaScore_.simpleScore.scoreMap.data());
 
         mainRensaScore_.collectedFeatures[key] += v;
         sideRensaScore_.collectedFeatures[key] += v;
@@ -131,10 +121,8 @@ public:
 
     void addScore(EvaluationRensaSparseFeatureKey key, int idx, int n = 1)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            mainRensaScore_.simpleScore.scoreMap[ordinal(mode)] += mainRensaParamSet_.param(mode, key, idx) * n;
-            sideRensaScore_.simpleScore.scoreMap[ordinal(mode)] += sideRensaParamSet_.param(mode, key, idx) * n;
-        }
+        mainRensaParamSet_.addScores(key, idx, n, mainRensaScore_.simpleScore.scoreMap.data());
+        sideRensaParamSet_.addScores(key, idx, n, sideRensaScore_.simpleScore.scoreMap.data());
         for (int i = 0; i < n; ++i) {
             mainRensaScore_.collectedSparseFeatures[key].push_back(idx);
             sideRensaScore_.collectedSparseFeatures[key].push_back(idx);
@@ -174,17 +162,13 @@ public:
 
     void addScore(EvaluationMoveFeatureKey key, double v)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            collectedFeatureScore_.moveScore.simpleScore.scoreMap[ordinal(mode)] += moveParamSet().param(mode, key) * v;
-        }
+        moveParamSet().addScores(key, v, collectedFeatureScore_.moveScore.simpleScore.scoreMap.data());
         collectedFeatureScore_.moveScore.collectedFeatures[key] += v;
     }
 
     void addScore(EvaluationMoveSparseFeatureKey key, int idx, int n = 1)
     {
-        for (const auto& mode : ALL_EVALUATION_MODES) {
-            collectedFeatureScore_.moveScore.simpleScore.scoreMap[ordinal(mode)] += moveParamSet().param(mode, key, idx) * n;
-        }
+        moveParamSet().addScores(key, idx, n, collectedFeatureScore_.moveScore.simpleScore.scoreMap.data());
         for (int i = 0; i < n; ++i)
             collectedFeatureScore_.moveScore.collectedSparseFeatures[key].push_back(idx);
     }
@@ -16,3 +16,23 @@ TEST(ScoreCollectorTest, score)
     EXPECT_EQ(50.0, collector.collectedScore().score(EvaluationMode::EARLY));
     EXPECT_EQ(30.0, collector.collectedScore().score(EvaluationMode::MIDDLE));
 }
+
+TEST(ScoreCollectorTest, sparseScore)
+{
+    EvaluationParameterMap m;
+    m.mutableMoveParamSet()->setDefault(VALLEY_DEPTH, 2, 3.0);
+    m.mutableMoveParamSet()->setParam(EvaluationMode::LATE, VALLEY_DEPTH, 2, 7.0);
+    m.mutableMainRensaParamSet()->setDefault(MAX_CHAINS, 5, 11.0);
+    m.mutableSideRensaParamSet()->setDefault(MAX_CHAINS, 5, 13.0);
+
+    SimpleScoreCollector collector(m);
+    collector.addScore(VALLEY_DEPTH, 2, 2);
+
+    SimpleRensaScoreCollector rensaCollector(m.mainRensaParamSet(), m.sideRensaParamSet());
+    rensaCollector.addScore(MAX_CHAINS, 5);
+    collector.mergeMainRensaScore(rensaCollector.mainRensaScore());
+    collector.mergeSideRensaScore(rensaCollector.sideRensaScore());
+
+    EXPECT_EQ(6.0 + 11.0 + 13.0, collector.collectedScore().score(EvaluationMode::EARLY));
+    EXPECT_EQ(14.0 + 11.0 + 13.0, collector.collectedScore().score(EvaluationMode::LATE));
+}
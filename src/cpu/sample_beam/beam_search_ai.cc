@@ -219,7 +219,7 @@ SearchState BeamSearchAI::search(
 
   q_states[0].push_back(init_state);
   for (int t = 0; t < search_turns; ++t) {
-    std::unordered_set<uint64> visited;
+    std::unordered_set<CoreField> visited;
     const auto& que = q_states[t];
     std::vector<SearchState>& next_states = q_states[t + 1];
     for (size_t i = 0; i < que.size(); ++i)
@@ -284,14 +284,13 @@ SearchState BeamSearchAI::search(
 
 void BeamSearchAI::generateNextStates(
     const SearchState& state, int from, const Kumipuyo& kumi,
-    std::unordered_set<uint64>& visited, std::vector<SearchState>& states) const {
+    std::unordered_set<CoreField>& visited, std::vector<SearchState>& states) const {
   const BeamSearchAI* th = this;
   auto callback = [&th, &state, &from, &visited, &states](const RefPlan& plan) {
     const CoreField field = plan.field();
     RensaResult result = plan.rensaResult();
 
-    uint64 h = field.hash();
-    if (!visited.insert(h).second)
+    if (!visited.insert(field).second)
       return;
 
     if (plan.isRensaPlan()) {
@@ -33,7 +33,7 @@ class BeamSearchAI : public AI {
   SearchState search(const CoreField& field, const KumipuyoSeq& vseq, int search_turns) const;
 
   void generateNextStates(const SearchState& state, int from, const Kumipuyo& kumi,
-                          std::unordered_set<uint64>& visited,
+                          std::unordered_set<CoreField>& visited,
                           std::vector<SearchState>& states) const;
 
   // pure virtual methods to change the behavior.
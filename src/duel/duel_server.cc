@@ -8,6 +8,7 @@
 
 #include <gflags/gflags.h>
 
+#include "base/trace.h"
 #include "core/decision.h"
 #include "core/frame_response.h"
 #include "core/kumipuyo_seq_generator.h"
@@ -148,9 +149,15 @@ void DuelServer::runDuelLoop()
     int p1_lose = 0;
     int num_match = 0;
 
+    Tracer::setThreadName("duel-server");
+
     while (!shouldStop_) {
         GameResult gameResult = runGame(manager_);
 
+        // The trace is written per game.
+        if (Tracer::isEnabled())
+            Tracer::flush("duel-game" + to_string(num_match + 1));
+
         string result = "";
         switch (gameResult) {
         case GameResult::P1_WIN:
@@ -209,6 +216,7 @@ GameResult DuelServer::runGame(ConnectorManager* manager)
 
     GameResult gameResult = GameResult::GAME_HAS_STOPPED;
     while (!shouldStop_) {
+        TRACE_SCOPE("DuelServer::frame");
         auto curr_time = std::chrono::steady_clock::now();
         auto timeout_time = curr_time + std::chrono::microseconds(1000000 / FPS);
 
@@ -225,7 +233,12 @@ GameResult DuelServer::runGame(ConnectorManager* manager)
         // --- Reads the response of the current frame information.
         // It takes up to 1/FPS [s] to finish this section.
         vector<FrameResponse> data[2];
-        if (!manager->receive(frameId, data, timeout_time)) {
+        bool received;
+        {
+            TRACE_SCOPE("DuelServer::receive");
+            received = manager->receive(frameId, data, timeout_time);
+        }
+        if (!received) {
             if (manager->connector(0)->isClosed()) {
                 gameResult = GameResult::P2_WIN_WITH_CONNECTION_ERROR;
                 break;
@@ -236,10 +249,13 @@ GameResult DuelServer::runGame(ConnectorManager* manager)
         }
 
         // --- Play with input.
-        play(&duelState, data);
-        gameState = duelState.toGameState();
-        for (GameStateObserver* observer : observers_)
-            observer->onUpdate(gameState);
+        {
+            TRACE_SCOPE("DuelServer::play");
+            play(&duelState, data);
+            gameState = duelState.toGameState();
+            for (GameStateObserver* observer : observers_)
+                observer->onUpdate(gameState);
+        }
 
         // --- Check the result
         gameResult = gameState.gameResult();